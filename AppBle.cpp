@@ -1,6 +1,8 @@
 #include "AppBle.h"
 #include "AppTime.h"
+#include "AppBoot.h"
 #include <WiFi.h>
+#include <atomic>
 
 static NimBLEUUID UUID_SERVICE("00001000-bed0-0080-aa55-4265644a6574");
 static NimBLEUUID UUID_STATUS ("00002000-bed0-0080-aa55-4265644a6574");
@@ -22,7 +24,8 @@ static NimBLEClient* g_client = nullptr;
 static NimBLERemoteCharacteristic* g_chrCmd = nullptr;
 static NimBLERemoteCharacteristic* g_chrStatus = nullptr;
 static bool g_bleConnected = false;
-static bool g_bleBusy = false;
+static String g_target;                     // BedJet MAC (bleSetTarget)
+static std::atomic<bool> g_linkUp(false);   // for other tasks, see bleLinkUp()
 
 // Status snapshot (raw)
 static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
@@ -61,10 +64,25 @@ static bool getStatusSnapshotInternal(uint8_t* out, uint16_t& outLen, uint32_t&
   return outLen > 0;
 }
 
+static void clearStatus() {
+  portENTER_CRITICAL(&g_mux);
+  g_statusLen = 0;
+  g_statusValid = false;
+  portEXIT_CRITICAL(&g_mux);
+}
+
 bool bleGetStatusSnapshot(uint8_t* out, uint16_t& outLen, uint32_t& ageMs, bool& valid) {
   return getStatusSnapshotInternal(out, outLen, ageMs, valid);
 }
 
+// Temperature decode: matches common community reverse-engineering & your Python script.
+static int decodeTempF(uint8_t b) {
+  int x = (int)b - 0x26;
+  // F ~= (x + 66) - (x/9)
+  float f = (float)(x + 66) - ((float)x / 9.0f);
+  return (int)lroundf(f);
+}
+
 // --------------------------- Notify Callback (no callback classes) ---------------------------
 static void onStatusNotify(NimBLERemoteCharacteristic* chr, uint8_t* data, size_t length, bool isNotify) {
   (void)chr; (void)isNotify;
@@ -111,6 +129,14 @@ static bool isDry(uint8_t btn) {
 }
 
 static bool tryGetCurrentButton(uint8_t& outBtn) {
+  // Avoid acting on stale status; during reconnects we may have an old snapshot.
+  BedjetStatus st;
+  if (!bleGetStatus(st, 5000)) return false;
+  outBtn = st.modeButton;
+  return true;
+}
+
+bool bleGetStatus(BedjetStatus& out, uint32_t maxAgeMs) {
   uint8_t snap[96];
   uint16_t slen = 0;
   uint32_t ageMs = 0;
@@ -118,12 +144,16 @@ static bool tryGetCurrentButton(uint8_t& outBtn) {
 
   if (!bleGetStatusSnapshot(snap, slen, ageMs, valid)) return false;
   if (!valid) return false;
-  // mode index is observed at [9] in the 20-byte status frame (see bleStatusSummary())
-  if (slen <= 9) return false;
-  // Avoid acting on stale status; during reconnects we may have an old snapshot.
-  if (ageMs > 5000) return false;
-
-  outBtn = modeIdxToButton(snap[9]);
+  // fan step is the last field we need, observed at [10] in the 20-byte status frame
+  if (slen <= 10) return false;
+  if (ageMs > maxAgeMs) return false;
+
+  out.modeButton   = modeIdxToButton(snap[9]);
+  out.fanStep      = snap[10];
+  out.targetF      = decodeTempF(snap[8]);
+  out.airF         = decodeTempF(snap[7]);
+  out.remainingMin = (uint16_t)(snap[4] * 60 + snap[5]);
+  out.ageMs        = ageMs;
   return true;
 }
 
@@ -187,16 +217,12 @@ bool bedjetSetTemp(float tempF) {
   return bedjetSetTempF(tempF);
 }
 bool bleDisconnect() {
-  if (g_bleBusy) return false;
-  g_bleBusy = true;
-
   bool ok = true;
   if (g_client && g_client->isConnected()) ok = g_client->disconnect();
 
   g_bleConnected = false;
+  g_linkUp = false;
   bleClearHandles();
-
-  g_bleBusy = false;
   return ok;
 }
 
@@ -230,7 +256,7 @@ static bool bleResolveAddress(NimBLEAddress& outAddr) {
     delay(250);
   }
 
-  String target = g_cfg.bedjetMac;
+  String target = g_target;
   target.toUpperCase();
 
   BLELOG("scan: %d results (target=%s)", results.getCount(), target.c_str());
@@ -283,13 +309,10 @@ static bool bleResolveAddress(NimBLEAddress& outAddr) {
 }
 
 static bool bleConnect() {
-  if (g_bleBusy) return false;
-  g_bleBusy = true;
-
   // Fast path
   if (g_client && g_client->isConnected() && g_chrCmd) {
     g_bleConnected = true;
-    g_bleBusy = false;
+    g_linkUp = true;
     return true;
   }
 
@@ -321,7 +344,7 @@ static bool bleConnect() {
     bool connected = false;
 
     // Prefer discovered address/type from scan
-    NimBLEAddress addr(std::string(g_cfg.bedjetMac.c_str()), BLE_ADDR_PUBLIC);
+    NimBLEAddress addr(std::string(g_target.c_str()), BLE_ADDR_PUBLIC);
     if (bleResolveAddress(addr)) {
       BLELOG("connect: trying resolved %s (type=%d)", addr.toString().c_str(), (int)addr.getType());
       connected = g_client->connect(addr);
@@ -331,7 +354,7 @@ static bool bleConnect() {
     if (!connected) {
       for (int t = 0; t < 2 && !connected; t++) {
         uint8_t addrType = (t == 0) ? BLE_ADDR_PUBLIC : BLE_ADDR_RANDOM;
-        NimBLEAddress a(std::string(g_cfg.bedjetMac.c_str()), addrType);
+        NimBLEAddress a(std::string(g_target.c_str()), addrType);
         BLELOG("connect: fallback try %s type=%d", a.toString().c_str(), (int)addrType);
         connected = g_client->connect(a);
         if (!connected) delay(350);
@@ -374,6 +397,7 @@ static bool bleConnect() {
     g_bleConnected = true;
     bedjetSetClockNow();
     ok = true;
+    bootMark(BOOT_BLE_CONNECTED);
     BLELOG("connect: OK");
   }
 
@@ -383,17 +407,10 @@ static bool bleConnect() {
     bleClearHandles();
   }
 
-  g_bleBusy = false;
+  g_linkUp = ok;
   return ok;
 }
 bool bleEnsureConnected() {
-  const uint32_t waitMs = 4000;
-
-  // If another BLE operation is in progress, wait briefly rather than failing immediately.
-  uint32_t start = millis();
-  while (g_bleBusy && (millis() - start) < waitMs) {
-    delay(25);
-  }
   return bleConnect();
 }
 
@@ -402,17 +419,30 @@ bool bleIsConnected() {
   return (g_client && g_client->isConnected() && g_chrCmd != nullptr);
 }
 
+bool bleLinkUp() {
+  return g_linkUp;
+}
+
+void bleSetTarget(const String& mac) {
+  if (mac == g_target) return;
+  bool first = g_target.length() == 0;
+  g_target = mac;
+  if (first) return;
+
+  // The link and the last status belong to the old BedJet; the next command connects anew
+  BLELOG("BedJet MAC changed to %s, dropping the current link", mac.c_str());
+  bleDisconnect();
+  clearStatus();
+}
+
 void bleLoop() {
   // Keep BLE state honest: clear handles if the underlying connection dropped.
   if (g_client && g_bleConnected && !g_client->isConnected()) {
     g_bleConnected = false;
+    g_linkUp = false;
     bleClearHandles();
   }
 }
-static uint16_t activeScheduleId() {
-  if (g_activeIndex < 0 || g_activeIndex >= g_schedCount) return 0;
-  return g_sched[g_activeIndex].id;
-}
 static String statusSummary() {
   uint8_t snap[96];
   uint16_t slen;
@@ -429,14 +459,6 @@ static String statusSummary() {
   uint8_t modeIdx = (slen > 9)  ? snap[9]  : 0;
   uint8_t fanStep = (slen > 10) ? snap[10] : 0;
 
-  // Temperature decode: matches common community reverse-engineering & your Python script.
-  auto decodeTempF = [](uint8_t b) -> int {
-    int x = (int)b - 0x26;
-    // F ~= (x + 66) - (x/9)
-    float f = (float)(x + 66) - ((float)x / 9.0f);
-    return (int)lroundf(f);
-  };
-
   int airF = (slen > 7) ? decodeTempF(snap[7]) : 0;
   int tgtF = (slen > 8) ? decodeTempF(snap[8]) : 0;
 
@@ -4,26 +4,17 @@
 #include "AppState.h"
 #include <NimBLEDevice.h>
 
-// BedJet commands/buttons
-enum BedjetButton : uint8_t {
-  BTN_OFF   = 0x01,
-  BTN_COOL  = 0x02,
-  BTN_HEAT  = 0x03,
-  BTN_TURBO = 0x04,
-  BTN_DRY   = 0x05,
-  BTN_EXTHT = 0x06
-};
+// BedjetButton, FAN_MIN/FAN_MAX and BedjetStatus are defined in SchedulerCore.h
 
-// Fan steps (BedJet reports 0..19)
-static constexpr uint8_t FAN_MIN = 0;
-static constexpr uint8_t FAN_MAX = 19;
-
-// BLE lifecycle
+// BLE lifecycle. Everything except bleLinkUp() and the status snapshot getters runs on the
+// control task only (AppControl.h).
 void setupBle();
 bool bleEnsureConnected();
 bool bleDisconnect();
 bool bleIsConnected();
 void bleLoop();
+void bleSetTarget(const String& mac);   // BedJet MAC; a change drops the current link
+bool bleLinkUp();                       // last known link state, safe from any task
 
 // Device commands
 bool bedjetButton(uint8_t btn);
@@ -39,5 +30,8 @@ bool bedjetSetRuntimeMinutes(uint16_t minutes);
 // Raw status snapshot (thread-safe copy)
 bool bleGetStatusSnapshot(uint8_t* out, uint16_t& outLen, uint32_t& ageMs, bool& valid);
 
+// Decoded view of the latest status frame. Returns false if there is no valid frame or it is older than maxAgeMs.
+bool bleGetStatus(BedjetStatus& out, uint32_t maxAgeMs = 5000);
+
 // Status summary string (human-friendly)
 String bleStatusSummary();
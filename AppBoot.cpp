@@ -0,0 +1,23 @@
+#include "AppBoot.h"
+
+static volatile uint32_t s_bootMs[BOOT_PHASE_COUNT] = {};
+
+static const char* const kPhaseNames[BOOT_PHASE_COUNT] = {
+  "rtc_restored", "config_loaded", "wifi_begin", "schedule_loaded", "ble_init", "fs_mounted",
+  "ble_connected", "first_tick", "first_command", "wifi_connected", "web_ready", "ntp_synced"
+};
+
+void bootMark(BootPhase p) {
+  if (p >= BOOT_PHASE_COUNT || s_bootMs[p]) return;
+  uint32_t now = millis();
+  s_bootMs[p] = now ? now : 1;   // 0 means "not reached"
+  Serial.printf("[BOOT] %s at %lu ms\n", kPhaseNames[p], (unsigned long)s_bootMs[p]);
+}
+
+uint32_t bootPhaseMs(BootPhase p) {
+  return p < BOOT_PHASE_COUNT ? s_bootMs[p] : 0;
+}
+
+const char* bootPhaseName(BootPhase p) {
+  return p < BOOT_PHASE_COUNT ? kPhaseNames[p] : "?";
+}
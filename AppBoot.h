@@ -0,0 +1,27 @@
+#pragma once
+#include "AppCommon.h"
+
+// Boot phase timestamps (millis() when each phase was first reached, 0 = not yet), exposed
+// at /api/boot. setup() starts Wi-Fi association first and, while the station connects,
+// loads storage and starts the control task (AppControl.h), which does NimBLE init, the first
+// BedJet connect and the first scheduler tick, so a warm reboot (clock restored from RTC
+// memory) can send its first command before Wi-Fi is even up.
+enum BootPhase : uint8_t {
+  BOOT_RTC_RESTORED = 0,   // rtcClockRestore() done (whether or not it set the clock)
+  BOOT_CONFIG_LOADED,
+  BOOT_WIFI_BEGIN,         // association started
+  BOOT_SCHEDULE_LOADED,
+  BOOT_BLE_INIT,           // NimBLE stack up
+  BOOT_FS_MOUNTED,
+  BOOT_BLE_CONNECTED,      // first BedJet link (may be after boot)
+  BOOT_FIRST_TICK,         // first scheduler tick
+  BOOT_FIRST_COMMAND,      // first command the scheduler sent to the BedJet
+  BOOT_WIFI_CONNECTED,
+  BOOT_WEB_READY,          // HTTP server listening
+  BOOT_NTP_SYNCED,
+  BOOT_PHASE_COUNT
+};
+
+void bootMark(BootPhase p);       // first call per phase wins; safe from any task
+uint32_t bootPhaseMs(BootPhase p);
+const char* bootPhaseName(BootPhase p);
@@ -1,4 +1,5 @@
 #include "AppConfig.h"
+#include "AppStorage.h"   // storageCrc32, g_nvsMutex
 
 // Configuration storage (separate from schedules)
 // --------------------------- User Config (Defaults) ---------------------------
@@ -19,6 +20,11 @@ const char* DEFAULT_BEDJET_MAC  = "AA:BB:CC:DD:EE:FF";
 const char* DEFAULT_DEVICE_NAME = "BedJetDeviceName";
 const char* DEFAULT_HOSTNAME   = "BedJetDeviceName";
 const char* DEFAULT_TZ         = "EST5EDT,M3.2.0/2,M11.1.0/2";
+const char* DEFAULT_NTP_SERVER = "pool.ntp.org";
+const uint8_t DEFAULT_RAMP_STEP_MIN = 5;
+const uint16_t DEFAULT_RECONCILE_SEC = 60;
+const uint8_t DEFAULT_RECONCILE_TOL_F = 1;
+const uint8_t DEFAULT_RECONCILE_HYST = 2;
 // ------------------------------------------------------------------
 
 RuntimeConfig g_cfg;
@@ -119,17 +125,155 @@ static void setDefaults() {
   g_cfg.deviceName = DEFAULT_DEVICE_NAME;
   g_cfg.hostName   = DEFAULT_HOSTNAME;
   g_cfg.tz        = DEFAULT_TZ;
+  g_cfg.ntpServer = DEFAULT_NTP_SERVER;
   g_cfg.schedulesPaused = false;
+  g_cfg.rampStepMin = DEFAULT_RAMP_STEP_MIN;
+  g_cfg.reconcileSec = DEFAULT_RECONCILE_SEC;
+  g_cfg.reconcileTolF = DEFAULT_RECONCILE_TOL_F;
+  g_cfg.reconcileHyst = DEFAULT_RECONCILE_HYST;
 }
-bool loadConfig() {
-  setDefaults();
+// Persisted layout (namespace "cfg"):
+//   "rec"   one binary A/B record ("recA"/"recB", see abWrite()) with everything set from
+//           the config page
+//   "flags" uint8 runtime flags toggled from the main UI (bit0 = schedules paused), so a
+//           pause toggle rewrites one byte instead of the whole record
+// Record (little endian):
+//   [0..3] magic "BJCF"  [4] version  [5] flags (bit0 DHCP)  [6..7] total length
+//   [8..11] CRC-32 of bytes [0..7] + [12..]
+//   [12..31] ip, gateway, subnet, dns1, dns2 (4 bytes each)
+//   [32] rampStepMin  [33..34] reconcileSec  [35] reconcileTolF  [36] reconcileHyst
+//   [37..] ssid, pass, mac, name, host, tz, ntp server as (uint8 length, bytes)
+//          (version 1 records end after tz)
+// Older firmware stored the record unslotted under "rec", and before that one string/bool
+// key per field; loadConfig() migrates either once.
+static const uint32_t CFG_REC_MAGIC = 0x46434A42; // "BJCF" little endian
+static const uint8_t  CFG_REC_VERSION = 2;
+static const size_t   CFG_REC_HDR = 12;
+static const size_t   CFG_REC_FIXED = 25;
+static const size_t   CFG_REC_MAX = CFG_REC_HDR + CFG_REC_FIXED + 7 * (1 + CFG_STR_MAX);
+static const uint8_t  CFG_REC_F_DHCP = 0x01;
+static const uint8_t  CFG_FLAG_PAUSED = 0x01;
 
-  prefsCfg.begin("cfg", true);
+static AbState s_cfgAb;
+
+static const char* const LEGACY_CFG_KEYS[] = {
+  "rec", "ssid", "pass", "dhcp", "ip", "gw", "sn", "dns1", "dns2", "mac", "name", "host", "tz",
+  "schedPaused", "rampStep", "recSec", "recTol", "recHyst"
+};
+
+static void putIp(uint8_t* p, const IPAddress& ip) {
+  for (int i = 0; i < 4; i++) p[i] = ip[i];
+}
+
+static IPAddress getIp(const uint8_t* p) {
+  return IPAddress(p[0], p[1], p[2], p[3]);
+}
+
+// Longer strings are refused by applyConfigFromRequest(); the clamp only keeps the record
+// inside CFG_REC_MAX.
+static size_t putStr(uint8_t* p, const String& s) {
+  size_t n = s.length();
+  if (n > CFG_STR_MAX) n = CFG_STR_MAX;
+  p[0] = (uint8_t)n;
+  memcpy(p + 1, s.c_str(), n);
+  return 1 + n;
+}
+
+static bool getStr(const uint8_t* rec, size_t len, size_t& pos, String& out) {
+  if (pos >= len) return false;
+  size_t n = rec[pos++];
+  if (pos + n > len) return false;
+  char tmp[CFG_STR_MAX + 1];
+  if (n > CFG_STR_MAX) return false;
+  memcpy(tmp, rec + pos, n);
+  tmp[n] = 0;
+  out = tmp;
+  pos += n;
+  return true;
+}
+
+static uint32_t cfgRecordCrc(const uint8_t* rec, size_t len) {
+  uint32_t crc = storageCrc32(rec, 8);
+  return storageCrc32(rec + CFG_REC_HDR, len - CFG_REC_HDR, crc);
+}
+
+static size_t encodeConfigRecord(const RuntimeConfig& cfg, uint8_t* rec) {
+  memset(rec, 0, CFG_REC_HDR + CFG_REC_FIXED);
+  memcpy(&rec[0], &CFG_REC_MAGIC, sizeof(uint32_t));
+  rec[4] = CFG_REC_VERSION;
+  rec[5] = cfg.useDhcp ? CFG_REC_F_DHCP : 0;
+
+  uint8_t* f = rec + CFG_REC_HDR;
+  putIp(f + 0,  cfg.localIp);
+  putIp(f + 4,  cfg.gateway);
+  putIp(f + 8,  cfg.subnet);
+  putIp(f + 12, cfg.dns1);
+  putIp(f + 16, cfg.dns2);
+  f[20] = cfg.rampStepMin;
+  f[21] = (uint8_t)(cfg.reconcileSec & 0xFF);
+  f[22] = (uint8_t)(cfg.reconcileSec >> 8);
+  f[23] = cfg.reconcileTolF;
+  f[24] = cfg.reconcileHyst;
+
+  size_t len = CFG_REC_HDR + CFG_REC_FIXED;
+  len += putStr(rec + len, cfg.wifiSsid);
+  len += putStr(rec + len, cfg.wifiPass);
+  len += putStr(rec + len, cfg.bedjetMac);
+  len += putStr(rec + len, cfg.deviceName);
+  len += putStr(rec + len, cfg.hostName);
+  len += putStr(rec + len, cfg.tz);
+  len += putStr(rec + len, cfg.ntpServer);
+
+  rec[6] = (uint8_t)(len & 0xFF);
+  rec[7] = (uint8_t)(len >> 8);
+  uint32_t crc = cfgRecordCrc(rec, len);
+  memcpy(&rec[8], &crc, sizeof(uint32_t));
+  return len;
+}
+
+// Decodes into cfg only if the whole record is valid.
+static bool decodeConfigRecord(const uint8_t* rec, size_t len, RuntimeConfig& cfg) {
+  if (len < CFG_REC_HDR + CFG_REC_FIXED) return false;
+
+  uint32_t magic, crc;
+  memcpy(&magic, &rec[0], sizeof(uint32_t));
+  memcpy(&crc, &rec[8], sizeof(uint32_t));
+  if (magic != CFG_REC_MAGIC || rec[4] < 1 || rec[4] > CFG_REC_VERSION) return false;
+  if (((size_t)rec[6] | ((size_t)rec[7] << 8)) != len) return false;
+  if (cfgRecordCrc(rec, len) != crc) return false;
+
+  RuntimeConfig c = cfg;
+  c.useDhcp = (rec[5] & CFG_REC_F_DHCP) != 0;
+
+  const uint8_t* f = rec + CFG_REC_HDR;
+  c.localIp = getIp(f + 0);
+  c.gateway = getIp(f + 4);
+  c.subnet  = getIp(f + 8);
+  c.dns1    = getIp(f + 12);
+  c.dns2    = getIp(f + 16);
+  c.rampStepMin = f[20];
+  c.reconcileSec = (uint16_t)f[21] | ((uint16_t)f[22] << 8);
+  c.reconcileTolF = f[23];
+  c.reconcileHyst = f[24];
+
+  size_t pos = CFG_REC_HDR + CFG_REC_FIXED;
+  if (!getStr(rec, len, pos, c.wifiSsid))   return false;
+  if (!getStr(rec, len, pos, c.wifiPass))   return false;
+  if (!getStr(rec, len, pos, c.bedjetMac))  return false;
+  if (!getStr(rec, len, pos, c.deviceName)) return false;
+  if (!getStr(rec, len, pos, c.hostName))   return false;
+  if (!getStr(rec, len, pos, c.tz))         return false;
+  if (rec[4] >= 2 && !getStr(rec, len, pos, c.ntpServer)) return false;
+  if (c.ntpServer.length() == 0) c.ntpServer = DEFAULT_NTP_SERVER;
+
+  cfg = c;
+  return true;
+}
+
+// Pre-record layout: one key per field
+static bool loadLegacyConfig() {
   String ssid = prefsCfg.getString("ssid", "");
-  if (ssid.length() == 0) {
-    prefsCfg.end();
-    return false; // not configured
-  }
+  if (ssid.length() == 0) return false;
 
   g_cfg.wifiSsid = ssid;
   g_cfg.wifiPass = prefsCfg.getString("pass", g_cfg.wifiPass);
@@ -153,34 +297,117 @@ bool loadConfig() {
 
   g_cfg.tz        = prefsCfg.getString("tz", g_cfg.tz);
   g_cfg.schedulesPaused = prefsCfg.getBool("schedPaused", g_cfg.schedulesPaused);
+  g_cfg.rampStepMin = prefsCfg.getUChar("rampStep", g_cfg.rampStepMin);
+  g_cfg.reconcileSec = (uint16_t)prefsCfg.getUInt("recSec", g_cfg.reconcileSec);
+  g_cfg.reconcileTolF = prefsCfg.getUChar("recTol", g_cfg.reconcileTolF);
+  g_cfg.reconcileHyst = prefsCfg.getUChar("recHyst", g_cfg.reconcileHyst);
+  return true;
+}
+
+bool loadConfig() {
+  setDefaults();
+
+  uint8_t rec[CFG_REC_MAX];
+  bool migrate = false;
+
+  g_nvsMutex.lock();
+  prefsCfg.begin("cfg", true);
+  size_t n = abReadNewest(prefsCfg, "rec", rec, sizeof(rec), s_cfgAb);
+  bool loaded = n > 0 && decodeConfigRecord(rec, n, g_cfg);
+  if (!loaded && n > 0) {
+    // Same fallback as loadSchedule(): the older slot before the legacy keys
+    AbState older;
+    size_t m = abReadNewest(prefsCfg, "rec", rec, sizeof(rec), older, s_cfgAb.slot);
+    loaded = m > 0 && decodeConfigRecord(rec, m, g_cfg);
+    if (loaded) {
+      Serial.printf("[CFG] config slot %c invalid (version); loaded slot %c\n", s_cfgAb.slot, older.slot);
+      s_cfgAb.slot = older.slot;
+    }
+  }
+  if (loaded) {
+    g_cfg.schedulesPaused = (prefsCfg.getUChar("flags", 0) & CFG_FLAG_PAUSED) != 0;
+  } else {
+    if (n > 0) Serial.println("[CFG] config record invalid (version); trying legacy keys");
+    size_t m = prefsCfg.isKey("rec") ? prefsCfg.getBytes("rec", rec, sizeof(rec)) : 0;
+    if (m > 0 && decodeConfigRecord(rec, m, g_cfg)) {
+      g_cfg.schedulesPaused = (prefsCfg.getUChar("flags", 0) & CFG_FLAG_PAUSED) != 0;
+      migrate = true;
+    } else {
+      migrate = loadLegacyConfig();
+    }
+    if (!migrate) {
+      prefsCfg.end();
+      g_nvsMutex.unlock();
+      return false; // not configured
+    }
+  }
   prefsCfg.end();
+  g_nvsMutex.unlock();
+
+  if (g_cfg.rampStepMin < 1 || g_cfg.rampStepMin > 60) g_cfg.rampStepMin = DEFAULT_RAMP_STEP_MIN;
+  if (g_cfg.reconcileHyst < 1) g_cfg.reconcileHyst = 1;
 
   g_cfg.bedjetMac = normalizeMac(g_cfg.bedjetMac);
   g_cfg.hostName = normalizeHost(g_cfg.hostName);
-  // TZ and schedulesPaused already loaded above; nothing to read after prefs end.
+
+  if (migrate) {
+    Serial.println("[CFG] migrating legacy config keys to A/B record");
+    // Until the record is written the legacy keys hold the only copy of the Wi-Fi credentials
+    if (!saveConfigToNvs(g_cfg, false)) {
+      Serial.println("[CFG] migration write failed; legacy config keys kept");
+      return true;
+    }
+    g_nvsMutex.lock();
+    prefsCfg.begin("cfg", false);
+    for (const char* k : LEGACY_CFG_KEYS) prefsCfg.remove(k);
+    prefsCfg.end();
+    g_nvsMutex.unlock();
+  }
   return true;
 }
-void saveConfigToNvs(const RuntimeConfig& cfg, bool keepPasswordIfBlank) {
-  prefsCfg.begin("cfg", false);
-  prefsCfg.putString("ssid", cfg.wifiSsid);
 
-  if (!keepPasswordIfBlank || cfg.wifiPass.length() > 0) {
-    prefsCfg.putString("pass", cfg.wifiPass);
+static bool ipDiffers(const IPAddress& a, const IPAddress& b) {
+  return (uint32_t)a != (uint32_t)b;
+}
+
+uint8_t configChanges(const RuntimeConfig& o, const RuntimeConfig& n) {
+  uint8_t m = CFG_APPLY_NONE;
+  if (n.wifiSsid != o.wifiSsid || (n.wifiPass.length() && n.wifiPass != o.wifiPass) || n.useDhcp != o.useDhcp) {
+    m |= CFG_APPLY_RESTART;
+  }
+  if (!n.useDhcp && (ipDiffers(n.localIp, o.localIp) || ipDiffers(n.gateway, o.gateway) ||
+                     ipDiffers(n.subnet, o.subnet) || ipDiffers(n.dns1, o.dns1) || ipDiffers(n.dns2, o.dns2))) {
+    m |= CFG_APPLY_RESTART;
   }
+  if (n.tz != o.tz) m |= CFG_APPLY_TZ;
+  if (n.ntpServer != o.ntpServer) m |= CFG_APPLY_NTP;
+  if (normalizeHost(n.hostName) != normalizeHost(o.hostName)) m |= CFG_APPLY_MDNS;
+  if (normalizeMac(n.bedjetMac) != normalizeMac(o.bedjetMac)) m |= CFG_APPLY_BLE;
+  return m;
+}
 
-  prefsCfg.putBool("dhcp", cfg.useDhcp);
+bool saveConfigToNvs(const RuntimeConfig& cfg, bool keepPasswordIfBlank) {
+  RuntimeConfig c = cfg;
+  // Blank password from the config form means "unchanged": keep the one in use.
+  if (keepPasswordIfBlank && c.wifiPass.length() == 0) c.wifiPass = g_cfg.wifiPass;
 
-  prefsCfg.putString("ip",   cfg.localIp.toString());
-  prefsCfg.putString("gw",   cfg.gateway.toString());
-  prefsCfg.putString("sn",   cfg.subnet.toString());
-  prefsCfg.putString("dns1", cfg.dns1.toString());
-  prefsCfg.putString("dns2", cfg.dns2.toString());
+  uint8_t rec[CFG_REC_MAX];
+  size_t len = encodeConfigRecord(c, rec);
 
-  prefsCfg.putString("mac",  cfg.bedjetMac);
-  prefsCfg.putString("name", cfg.deviceName);
-  prefsCfg.putString("host", cfg.hostName);
+  g_nvsMutex.lock();
+  prefsCfg.begin("cfg", false);
+  bool ok = abWrite(prefsCfg, "rec", rec, len, s_cfgAb);
+  if (!ok) Serial.println("[CFG] config save FAILED");
+  prefsCfg.putUChar("flags", c.schedulesPaused ? CFG_FLAG_PAUSED : 0);
+  prefsCfg.end();
+  g_nvsMutex.unlock();
+  return ok;
+}
 
-  prefsCfg.putString("tz",   cfg.tz);
-  prefsCfg.putBool("schedPaused", cfg.schedulesPaused);
+void saveConfigFlagsToNvs(const RuntimeConfig& cfg) {
+  g_nvsMutex.lock();
+  prefsCfg.begin("cfg", false);
+  prefsCfg.putUChar("flags", cfg.schedulesPaused ? CFG_FLAG_PAUSED : 0);
   prefsCfg.end();
+  g_nvsMutex.unlock();
 }
@@ -17,11 +17,19 @@ struct RuntimeConfig {
   String   deviceName;    // used in UI/state JSON
   String   hostName;      // hostname / mDNS name (e.g., BEDJETWEB)
   String   tz;           // POSIX TZ string (e.g., EST5EDT,M3.2.0/2,M11.1.0/2)
+  String   ntpServer;    // NTP server host name or IP (router / local server is fastest)
   bool     schedulesPaused;  // pause automation (do not execute schedules)
+  uint8_t  rampStepMin;      // minimum minutes between ramp setpoint changes (1..60)
+  uint16_t reconcileSec;     // seconds between status-vs-schedule checks (0 = off)
+  uint8_t  reconcileTolF;    // allowed target temperature difference (°F) before correcting
+  uint8_t  reconcileHyst;    // consecutive drifted checks required before correcting
 };
 
 extern RuntimeConfig g_cfg;
 
+// Longest string field the config record stores; the config form rejects longer values.
+static const size_t CFG_STR_MAX = 100;
+
 // Helpers (used by config portal + WiFi setup)
 bool parseIp(const String& s, IPAddress& out);
 String normalizeMac(String mac);
@@ -30,7 +38,23 @@ bool isMacLikelyValid(const String& mac);
 
 // Load/Save configuration from NVS
 bool loadConfig();
-void saveConfigToNvs(const RuntimeConfig& cfg, bool keepPasswordIfBlank = true);
+// false if the config record write failed (the previous save is still the one loaded)
+bool saveConfigToNvs(const RuntimeConfig& cfg, bool keepPasswordIfBlank = true);
+// Only the small runtime-flags key (schedulesPaused); used by the pause toggle.
+void saveConfigFlagsToNvs(const RuntimeConfig& cfg);
+
+// What a config change takes to apply (bit mask from configChanges()). Fields not listed
+// (device name, ramp / reconcile tuning, pause) are read on use and apply immediately.
+enum ConfigApply : uint8_t {
+  CFG_APPLY_NONE    = 0,
+  CFG_APPLY_TZ      = 0x01,   // tzset + timeSetTz
+  CFG_APPLY_NTP     = 0x02,   // ntpBegin with the new server
+  CFG_APPLY_MDNS    = 0x04,   // host name: re-register mDNS
+  CFG_APPLY_BLE     = 0x08,   // BedJet MAC: the control task drops the link on the new config
+  CFG_APPLY_RESTART = 0x80    // SSID / password / DHCP / static IP: reboot
+};
+// newCfg.wifiPass blank = unchanged (as from the config form)
+uint8_t configChanges(const RuntimeConfig& oldCfg, const RuntimeConfig& newCfg);
 
 // Defaults (only used if no saved config exists)
 extern const char* DEFAULT_WIFI_SSID;
@@ -47,3 +71,8 @@ extern const char* DEFAULT_DEVICE_NAME;
 extern const char* DEFAULT_HOSTNAME;
 
 extern const char* DEFAULT_TZ;
+extern const char* DEFAULT_NTP_SERVER;
+extern const uint8_t DEFAULT_RAMP_STEP_MIN;
+extern const uint16_t DEFAULT_RECONCILE_SEC;
+extern const uint8_t DEFAULT_RECONCILE_TOL_F;
+extern const uint8_t DEFAULT_RECONCILE_HYST;
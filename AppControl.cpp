@@ -0,0 +1,273 @@
+#include "AppControl.h"
+#include "AppBle.h"
+#include "AppBoot.h"
+#include "AppTime.h"
+#include <atomic>
+
+// Single-writer / single-reader snapshot without locks (seqlock): the writer makes the
+// sequence odd while it copies, the reader retries on its next pass if it saw an odd or a
+// changed sequence. T must be plain data.
+template <typename T>
+class Snapshot {
+ public:
+  void publish(const T& v) {
+    uint32_t s = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&m_val, &v, sizeof(T));
+    m_seq.store(s + 2, std::memory_order_release);
+  }
+
+  // true (out filled) if something new was published since the last successful take()
+  bool take(T& out) {
+    uint32_t s = m_seq.load(std::memory_order_acquire);
+    if (s == m_seen || (s & 1)) return false;
+    memcpy(&out, &m_val, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_seq.load(std::memory_order_relaxed) != s) return false;
+    m_seen = s;
+    return true;
+  }
+
+ private:
+  std::atomic<uint32_t> m_seq{0};
+  uint32_t m_seen = 0;   // reader side
+  T m_val;
+};
+
+struct SchedSnap {
+  ScheduleItem items[MAX_SCHEDULE];
+  int      count;
+  uint32_t keepIfSameGen;   // bumped per SCHED_KEEP_IF_SAME publish
+  uint32_t resetGen;        // bumped per SCHED_RESET publish
+};
+
+struct CfgSnap {
+  char        mac[18];
+  SchedParams params;
+};
+
+struct CtlMsg {
+  uint32_t   seq;
+  uint32_t   queuedMs;
+  CtlCommand cmd;
+};
+
+struct CtlReply {
+  uint32_t seq;
+  bool     ok;
+};
+
+struct CtlSlot {
+  uint32_t  seq;
+  CtlResult state;
+};
+
+static Snapshot<SchedSnap> s_schedSnap;
+static Snapshot<CfgSnap>   s_cfgSnap;
+static QueueHandle_t s_cmdQ = nullptr;     // web -> control
+static QueueHandle_t s_replyQ = nullptr;   // control -> web (the web task is the only caller)
+static TaskHandle_t  s_task = nullptr;
+static CtlStats      s_stats = {};
+
+// Web side
+static SchedSnap s_schedOut;
+static uint32_t  s_reqSeq = 0;
+static CtlSlot   s_results[CTL_RESULT_SLOTS];   // indexed by seq % CTL_RESULT_SLOTS
+
+// Control task side
+static SchedSnap s_schedIn;
+static uint32_t  s_keepIfSameSeen = 0;
+static uint32_t  s_resetSeen = 0;
+static uint32_t  s_lastTickMs = 0;
+
+// --------------------------- Web side ---------------------------
+void ctlPublishSchedule(SchedActivePolicy policy) {
+  s_schedOut.count = g_schedCount;
+  for (int i = 0; i < g_schedCount; i++) s_schedOut.items[i] = g_sched[i];
+  // Generations rather than the policy itself: edits the control task has not picked up yet
+  // still count (a reset followed by a rename must still reset).
+  if (policy == SCHED_KEEP_IF_SAME) s_schedOut.keepIfSameGen++;
+  if (policy == SCHED_RESET) s_schedOut.resetGen++;
+  s_schedSnap.publish(s_schedOut);
+}
+
+void ctlPublishConfig() {
+  CfgSnap c = {};
+  strncpy(c.mac, g_cfg.bedjetMac.c_str(), sizeof(c.mac) - 1);
+  c.params.paused = g_cfg.schedulesPaused;
+  c.params.rampStepMin = g_cfg.rampStepMin;
+  c.params.reconcileSec = g_cfg.reconcileSec;
+  c.params.reconcileTolF = g_cfg.reconcileTolF;
+  c.params.reconcileHyst = g_cfg.reconcileHyst;
+  s_cfgSnap.publish(c);
+}
+
+static void noteReply(const CtlReply& r) {
+  CtlSlot& slot = s_results[r.seq % CTL_RESULT_SLOTS];
+  if (slot.seq == r.seq) slot.state = r.ok ? CTL_OK : CTL_FAILED;
+  // else: evicted by newer requests, nobody can ask for it any more
+}
+
+static void drainReplies() {
+  CtlReply r;
+  while (xQueueReceive(s_replyQ, &r, 0) == pdTRUE) noteReply(r);
+}
+
+// Short commands (disconnect, a button on a live link) still answer in the same request;
+// anything slower returns PENDING with *reqId for ctlResult() so loop() keeps serving HTTP.
+CtlResult ctlRequest(const CtlCommand& cmd, uint32_t* reqId) {
+  if (!s_task) return CTL_FAILED;
+  drainReplies();
+
+  CtlMsg m;
+  m.seq = ++s_reqSeq;
+  m.queuedMs = millis();
+  m.cmd = cmd;
+  if (xQueueSend(s_cmdQ, &m, 0) != pdTRUE) {
+    s_stats.busy++;
+    return CTL_BUSY;
+  }
+  if (reqId) *reqId = m.seq;
+
+  CtlSlot& slot = s_results[m.seq % CTL_RESULT_SLOTS];
+  slot.seq = m.seq;
+  slot.state = CTL_PENDING;
+  for (;;) {
+    uint32_t waited = millis() - m.queuedMs;
+    if (slot.state != CTL_PENDING || waited >= CTL_REPLY_WAIT_MS) break;
+    CtlReply r;
+    if (xQueueReceive(s_replyQ, &r, pdMS_TO_TICKS(CTL_REPLY_WAIT_MS - waited)) != pdTRUE) break;
+    noteReply(r);
+  }
+  if (slot.state == CTL_PENDING) s_stats.pending++;
+  return slot.state;
+}
+
+CtlResult ctlResult(uint32_t reqId) {
+  if (!s_task || reqId == 0) return CTL_UNKNOWN;
+  drainReplies();
+  const CtlSlot& slot = s_results[reqId % CTL_RESULT_SLOTS];
+  return slot.seq == reqId ? slot.state : CTL_UNKNOWN;
+}
+
+// --------------------------- Control task ---------------------------
+static void adoptSnapshots() {
+  CfgSnap c;
+  if (s_cfgSnap.take(c)) {
+    bleSetTarget(String(c.mac));
+    schedulerSetParams(c.params);
+  }
+
+  if (s_schedSnap.take(s_schedIn)) {
+    SchedActivePolicy policy = SCHED_KEEP_BY_ID;
+    if (s_schedIn.keepIfSameGen != s_keepIfSameSeen) policy = SCHED_KEEP_IF_SAME;
+    if (s_schedIn.resetGen != s_resetSeen) policy = SCHED_RESET;
+    s_keepIfSameSeen = s_schedIn.keepIfSameGen;
+    s_resetSeen = s_schedIn.resetGen;
+    schedulerSetSchedule(s_schedIn.items, s_schedIn.count, policy);
+  }
+}
+
+static bool runCommand(const CtlCommand& c) {
+  switch (c.op) {
+    case CTL_OP_CONNECT:
+      return bleEnsureConnected();
+
+    case CTL_OP_DISCONNECT:
+      return bleDisconnect();
+
+    case CTL_OP_BUTTON: {
+      schedulerNoteManualCommand();
+      bool ok = bleEnsureConnected();
+      if (ok) ok = bedjetButton(c.btn);
+      // Tiny delays help BLE reliability
+      if (ok && c.hasTemp) { delay(60); ok = bedjetSetTempF(c.tempF); }
+      if (ok && c.hasFan) { delay(60); ok = bedjetSetFan(c.fan); }
+      if (ok && c.runMins > 0) { delay(60); ok = bedjetSetRuntimeMinutes(c.runMins); }
+      return ok;
+    }
+
+    case CTL_OP_RUN_ITEM: {
+      schedulerNoteManualCommand();
+      if (!bleEnsureConnected()) return false;
+      bedjetSetClockNow();
+      delay(40);
+
+      const ScheduleItem& it = c.item;
+      if (it.modeButton == BTN_OFF) return bedjetButton(BTN_OFF);
+      bool ok = bedjetSetModeSmart(it.modeButton);
+      if (ok) { delay(80); bedjetSetFan(it.fanStep); delay(60); bedjetSetTempF(it.tempF); delay(60); bedjetSetRuntimeMinutes(c.runMins); }
+      return ok;
+    }
+
+    default:
+      return false;
+  }
+}
+
+static void tick() {
+  s_lastTickMs = millis();
+  schedulerTick();
+}
+
+static void ctlTask(void*) {
+  setupBle();
+  bootMark(BOOT_BLE_INIT);
+  adoptSnapshots();
+
+  // Tick at once when the clock survived the reset (RTC memory / external RTC), otherwise
+  // once NTP has set it. A warm boot resumes the running block without BLE at all; a block
+  // that needs applying connects from the tick. Only then the idle connect (scan + retries
+  // take seconds when the BedJet is absent), while Wi-Fi is still associating.
+  if (timeValid()) tick();
+  if (!bleIsConnected()) bleEnsureConnected();
+
+  for (;;) {
+    uint32_t sinceTick = millis() - s_lastTickMs;
+    uint32_t waitMs = sinceTick >= CTL_TICK_MS ? 0 : CTL_TICK_MS - sinceTick;
+
+    CtlMsg m;
+    if (xQueueReceive(s_cmdQ, &m, pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+      adoptSnapshots();   // e.g. Run Now right after an edit
+      CtlReply r;
+      r.seq = m.seq;
+      r.ok = runCommand(m.cmd);
+      xQueueSend(s_replyQ, &r, 0);
+
+      uint32_t ms = millis() - m.queuedMs;
+      s_stats.commands++;
+      s_stats.cmdMsLast = ms;
+      if (ms > s_stats.cmdMsMax) s_stats.cmdMsMax = ms;
+    }
+
+    adoptSnapshots();
+    bleLoop();   // keep BLE state honest (and clear handles if the link dropped)
+    if (millis() - s_lastTickMs >= CTL_TICK_MS) tick();
+    s_stats.stackFree = uxTaskGetStackHighWaterMark(nullptr);
+  }
+}
+
+void ctlStart() {
+  if (s_task) return;
+  s_cmdQ = xQueueCreate(CTL_QUEUE_LEN, sizeof(CtlMsg));
+  s_replyQ = xQueueCreate(CTL_QUEUE_LEN + 1, sizeof(CtlReply));   // never blocks the sender
+  ctlPublishConfig();
+  ctlPublishSchedule(SCHED_RESET);
+
+  if (!s_cmdQ || !s_replyQ ||
+      xTaskCreatePinnedToCore(ctlTask, "control", CTL_TASK_STACK, nullptr, CTL_TASK_PRIO, &s_task, CTL_TASK_CORE) != pdPASS) {
+    s_task = nullptr;
+    Serial.println("[CTL] failed to start the control task; BLE and scheduler are off");
+    return;
+  }
+  Serial.printf("[CTL] control task on core %d\n", (int)CTL_TASK_CORE);
+}
+
+bool ctlRunning() {
+  return s_task != nullptr;
+}
+
+const CtlStats& ctlStats() {
+  return s_stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "AppCommon.h"
+#include "AppState.h"
+#include "AppConfig.h"
+#include "AppScheduler.h"
+
+// Tasks and cores:
+// - loop() (Arduino loopTask, core 1): web server, Wi-Fi scan / test, NTP, LittleFS history,
+//   NVS write-behind. Owns the editable g_sched and g_cfg.
+// - control task (core 0, next to the NimBLE host): every BLE call and the scheduler. Owns
+//   the BLE client and the scheduler's copy of the schedule / running block.
+// HTTP handlers therefore never make a BLE call themselves, and the tick does not wait for
+// the web loop (latency under load is unmeasured, see test/web_latency.py).
+// The two sides share no mutable globals: web handlers send commands over a queue, schedule
+// and config changes are published as lock-free snapshots, and the control task publishes
+// link state (bleLinkUp) and the running block (schedulerActiveId) as atomics.
+static const BaseType_t CTL_TASK_CORE = 0;
+static const UBaseType_t CTL_TASK_PRIO = 2;         // above loopTask (1), below NimBLE / Wi-Fi
+static const uint32_t CTL_TASK_STACK = 8192;
+static const uint32_t CTL_TICK_MS = 2000;           // scheduler tick period
+static const uint8_t  CTL_QUEUE_LEN = 4;
+static const uint32_t CTL_REPLY_WAIT_MS = 100;      // web handler wait, then 202 + request id
+static const uint8_t  CTL_RESULT_SLOTS = 8;         // recent request results kept for polling
+
+enum CtlOp : uint8_t {
+  CTL_OP_CONNECT = 1,
+  CTL_OP_DISCONNECT,
+  CTL_OP_BUTTON,      // Quick Controls: button + optional temp / fan / runtime
+  CTL_OP_RUN_ITEM     // Run Now: apply item for runMins
+};
+
+struct CtlCommand {
+  uint8_t  op;
+  uint8_t  btn;
+  bool     hasTemp;
+  bool     hasFan;
+  float    tempF;
+  uint8_t  fan;
+  uint16_t runMins;    // BUTTON: 0 = leave the runtime alone
+  ScheduleItem item;   // RUN_ITEM
+};
+
+enum CtlResult : uint8_t {
+  CTL_FAILED = 0,
+  CTL_OK,
+  CTL_BUSY,      // queue full
+  CTL_PENDING,   // still queued / running when the web handler stopped waiting
+  CTL_UNKNOWN    // ctlResult(): not one of the last CTL_RESULT_SLOTS requests
+};
+
+struct CtlStats {
+  uint32_t commands;     // executed on the control task
+  uint32_t pending;      // answered 202 before the command finished (result polled later)
+  uint32_t busy;         // rejected, queue full
+  uint32_t cmdMsLast;    // queue -> reply for the last command
+  uint32_t cmdMsMax;
+  uint32_t stackFree;    // control task stack high-water mark (bytes)
+};
+
+void ctlStart();   // setup(), after loadSchedule() / loadConfig(): BLE init, first connect + tick
+bool ctlRunning();
+
+// Web side (loop()) only
+CtlResult ctlRequest(const CtlCommand& cmd, uint32_t* reqId = nullptr);   // waits at most CTL_REPLY_WAIT_MS
+CtlResult ctlResult(uint32_t reqId);   // PENDING / OK / FAILED, or UNKNOWN once evicted
+void ctlPublishSchedule(SchedActivePolicy policy = SCHED_KEEP_BY_ID);   // after editing g_sched
+void ctlPublishConfig();                                                // after changing g_cfg
+
+const CtlStats& ctlStats();
@@ -0,0 +1,454 @@
+#include "AppFs.h"
+#include "AppStorage.h"
+#include "AppTime.h"
+#include "AppBle.h"
+#include <LittleFS.h>
+
+static bool s_mounted = false;
+
+static void noteRead(size_t bytes, uint32_t t0) {
+  g_metrics.fsReadBytes += bytes;
+  g_metrics.fsReadUs += micros() - t0;
+}
+
+// Rewrites go to <tmp> and are renamed over <path> (LittleFS replaces the target atomically,
+// so there is always one complete file). A <tmp> found at mount is an interrupted rewrite:
+// drop it, unless <path> is missing (firmware that removed <path> before renaming was cut
+// off in between), in which case <tmp> is the only copy.
+static void fsRecoverTmp(const char* path, const char* tmp) {
+  if (!LittleFS.exists(tmp)) return;
+  if (LittleFS.exists(path)) {
+    LittleFS.remove(tmp);
+    Serial.printf("[FS] removed leftover %s\n", tmp);
+  } else if (LittleFS.rename(tmp, path)) {
+    Serial.printf("[FS] recovered %s from %s\n", path, tmp);
+  }
+}
+
+// --------------------------- Schedule profiles ---------------------------
+// Record (little endian):
+//   [0] type (1 = put, 2 = delete)  [1] name length  [2..3] profile id  [4..5] body length
+//   [6..7] reserved  [8..11] CRC-32 of bytes [0..7] + body
+//   body = name bytes + schedule payload (encodeScheduleBlob())
+// The last record for an id wins. A torn tail (power loss during append) fails the CRC;
+// scanning stops there and the next write compacts the file, which drops it.
+static const char* PROFILES_PATH = "/profiles.log";
+static const char* PROFILES_TMP  = "/profiles.tmp";
+static const size_t PROF_HDR = 12;
+static const uint8_t PROF_PUT = 1;
+static const uint8_t PROF_DEL = 2;
+
+struct ProfileIndex {
+  ProfileInfo info;
+  uint32_t    offset;    // record start in the file
+  uint16_t    bodyLen;
+};
+
+static ProfileIndex s_prof[MAX_PROFILES];
+static int      s_profCount = 0;
+static uint16_t s_profNextId = 1;
+static uint32_t s_profFileSize = 0;   // bytes of valid records
+static bool     s_profTailBad = false;
+
+static uint32_t profRecordCrc(const uint8_t* hdr, const uint8_t* body, size_t bodyLen) {
+  uint32_t crc = storageCrc32(hdr, 8);
+  return storageCrc32(body, bodyLen, crc);
+}
+
+static size_t profRecordSize(const ProfileIndex& p) {
+  return PROF_HDR + p.bodyLen;
+}
+
+static int profFind(uint16_t id) {
+  for (int i = 0; i < s_profCount; i++) if (s_prof[i].info.id == id) return i;
+  return -1;
+}
+
+static void profIndexRemove(int i) {
+  for (int k = i; k < s_profCount - 1; k++) s_prof[k] = s_prof[k + 1];
+  s_profCount--;
+}
+
+static void profIndexApply(uint8_t type, uint16_t id, const uint8_t* body, uint8_t nameLen, uint16_t bodyLen, uint32_t offset) {
+  int i = profFind(id);
+  if (id >= s_profNextId) s_profNextId = id + 1;
+
+  if (type == PROF_DEL) {
+    if (i >= 0) profIndexRemove(i);
+    return;
+  }
+
+  if (i < 0) {
+    if (s_profCount >= MAX_PROFILES) return;
+    i = s_profCount++;
+  }
+  ProfileIndex& p = s_prof[i];
+  p.info.id = id;
+  memcpy(p.info.name, body, nameLen);
+  p.info.name[nameLen] = 0;
+  p.info.count = (bodyLen >= nameLen + 7) ? body[nameLen + 6] : 0;   // payload [6] = count
+  p.offset = offset;
+  p.bodyLen = bodyLen;
+}
+
+static void profScan() {
+  s_profCount = 0;
+  s_profNextId = 1;
+  s_profFileSize = 0;
+  s_profTailBad = false;
+
+  fsRecoverTmp(PROFILES_PATH, PROFILES_TMP);
+  if (!LittleFS.exists(PROFILES_PATH)) return;
+  File f = LittleFS.open(PROFILES_PATH, "r");
+  if (!f) return;
+
+  size_t size = f.size();
+  uint8_t hdr[PROF_HDR];
+  uint8_t body[PROFILE_NAME_MAX + SCHED_BLOB_MAX];
+  uint32_t pos = 0;
+  while (pos < size) {
+    if (f.read(hdr, PROF_HDR) != PROF_HDR) { s_profTailBad = true; break; }
+    uint8_t type = hdr[0];
+    uint8_t nameLen = hdr[1];
+    uint16_t id = (uint16_t)hdr[2] | ((uint16_t)hdr[3] << 8);
+    uint16_t bodyLen = (uint16_t)hdr[4] | ((uint16_t)hdr[5] << 8);
+    uint32_t crc;
+    memcpy(&crc, &hdr[8], sizeof(uint32_t));
+
+    if ((type != PROF_PUT && type != PROF_DEL) || nameLen > PROFILE_NAME_MAX ||
+        bodyLen > sizeof(body) || nameLen > bodyLen ||
+        f.read(body, bodyLen) != bodyLen || profRecordCrc(hdr, body, bodyLen) != crc) {
+      s_profTailBad = true;
+      break;
+    }
+
+    profIndexApply(type, id, body, nameLen, bodyLen, pos);
+    pos += PROF_HDR + bodyLen;
+  }
+  f.close();
+  s_profFileSize = pos;
+  if (s_profTailBad) Serial.printf("[FS] %s: invalid record at %lu, will compact\n", PROFILES_PATH, (unsigned long)pos);
+}
+
+// Rewrites only the live records; on failure the old file stays in place.
+static bool profCompact() {
+  File src;
+  if (LittleFS.exists(PROFILES_PATH)) src = LittleFS.open(PROFILES_PATH, "r");
+  File dst = LittleFS.open(PROFILES_TMP, "w");
+  if (!dst) { if (src) src.close(); return false; }
+
+  uint8_t buf[PROF_HDR + PROFILE_NAME_MAX + SCHED_BLOB_MAX];
+  uint32_t pos = 0;
+  bool ok = true;
+  for (int i = 0; i < s_profCount && ok; i++) {
+    size_t n = profRecordSize(s_prof[i]);
+    ok = src && src.seek(s_prof[i].offset) && src.read(buf, n) == n && dst.write(buf, n) == n;
+    s_prof[i].offset = pos;
+    pos += n;
+  }
+  if (src) src.close();
+  dst.close();
+
+  if (!ok) {
+    LittleFS.remove(PROFILES_TMP);
+    profScan();   // offsets were rewritten above
+    return false;
+  }
+
+  if (!LittleFS.rename(PROFILES_TMP, PROFILES_PATH)) {
+    LittleFS.remove(PROFILES_TMP);
+    profScan();
+    return false;
+  }
+  Serial.printf("[FS] %s compacted: %lu -> %lu bytes\n", PROFILES_PATH, (unsigned long)s_profFileSize, (unsigned long)pos);
+  s_profFileSize = pos;
+  s_profTailBad = false;
+  return true;
+}
+
+static bool profAppend(uint8_t type, uint16_t id, const char* name, uint8_t nameLen, const uint8_t* payload, size_t payloadLen) {
+  if (s_profTailBad && !profCompact()) return false;
+
+  uint8_t body[PROFILE_NAME_MAX + SCHED_BLOB_MAX];
+  if (nameLen) memcpy(body, name, nameLen);
+  if (payloadLen) memcpy(body + nameLen, payload, payloadLen);
+  uint16_t bodyLen = (uint16_t)(nameLen + payloadLen);
+
+  uint8_t hdr[PROF_HDR] = {0};
+  hdr[0] = type;
+  hdr[1] = nameLen;
+  hdr[2] = (uint8_t)(id & 0xFF);
+  hdr[3] = (uint8_t)(id >> 8);
+  hdr[4] = (uint8_t)(bodyLen & 0xFF);
+  hdr[5] = (uint8_t)(bodyLen >> 8);
+  uint32_t crc = profRecordCrc(hdr, body, bodyLen);
+  memcpy(&hdr[8], &crc, sizeof(uint32_t));
+
+  File f = LittleFS.open(PROFILES_PATH, "a");
+  if (!f) return false;
+  bool ok = f.write(hdr, PROF_HDR) == PROF_HDR && f.write(body, bodyLen) == bodyLen;
+  f.close();
+  if (!ok) { profScan(); return false; }
+
+  uint32_t offset = s_profFileSize;
+  s_profFileSize += PROF_HDR + bodyLen;
+  profIndexApply(type, id, body, nameLen, bodyLen, offset);
+
+  // Compact once dead records outweigh live ones
+  uint32_t live = 0;
+  for (int i = 0; i < s_profCount; i++) live += profRecordSize(s_prof[i]);
+  if (s_profFileSize > 2 * live + 4096) profCompact();
+  return true;
+}
+
+int profileList(ProfileInfo* out, int cap) {
+  int n = 0;
+  for (int i = 0; i < s_profCount && n < cap; i++) out[n++] = s_prof[i].info;
+  return n;
+}
+
+bool profileSaveCurrent(uint16_t id, const String& name, uint16_t& outId, String& err) {
+  if (!s_mounted) { err = "filesystem not mounted"; return false; }
+
+  String nm = name;
+  nm.trim();
+  if (nm.length() == 0) { err = "missing name"; return false; }
+  if (nm.length() > (size_t)PROFILE_NAME_MAX) { err = "name too long"; return false; }
+
+  if (id == 0) {
+    if (s_profCount >= MAX_PROFILES) { err = "too many profiles"; return false; }
+    id = s_profNextId;
+  } else if (profFind(id) < 0) {
+    err = "profile not found";
+    return false;
+  }
+
+  uint8_t payload[SCHED_BLOB_MAX];
+  size_t len = encodeScheduleBlob(g_sched, g_schedCount, g_nextId, payload);
+  if (!profAppend(PROF_PUT, id, nm.c_str(), (uint8_t)nm.length(), payload, len)) {
+    err = "write failed";
+    return false;
+  }
+  outId = id;
+  return true;
+}
+
+bool profileLoad(uint16_t id, ScheduleItem* items, int& count, uint16_t& nextId, String& err) {
+  int i = profFind(id);
+  if (i < 0) { err = "profile not found"; return false; }
+
+  const ProfileIndex& p = s_prof[i];
+  uint8_t body[PROFILE_NAME_MAX + SCHED_BLOB_MAX];
+
+  uint32_t t0 = micros();
+  File f = LittleFS.open(PROFILES_PATH, "r");
+  bool ok = f && f.seek(p.offset + PROF_HDR) && f.read(body, p.bodyLen) == p.bodyLen;
+  if (f) f.close();
+  noteRead(p.bodyLen, t0);
+
+  size_t nameLen = strlen(p.info.name);
+  if (!ok || !decodeScheduleBlob(body + nameLen, p.bodyLen - nameLen, items, count, nextId)) {
+    err = "profile unreadable";
+    return false;
+  }
+  return true;
+}
+
+bool profileDelete(uint16_t id) {
+  if (profFind(id) < 0) return false;
+  return profAppend(PROF_DEL, id, "", 0, nullptr, 0);
+}
+
+// --------------------------- Status history ---------------------------
+// 8-byte samples: [0..3] epoch  [4] mode  [5] fan  [6] target °F  [7] air °F.
+// s_histIdx holds the epoch of every HIST_IDX_STRIDE-th sample, so a time lookup is a
+// binary search in RAM plus one seek and at most one stride of sequential reads.
+static const char* HISTORY_PATH = "/history.bin";
+static const char* HISTORY_TMP  = "/history.tmp";
+static const size_t HIST_REC = 8;
+static const uint32_t HIST_IDX_STRIDE = 64;
+
+static uint32_t s_histIdx[HISTORY_MAX_SAMPLES / HIST_IDX_STRIDE];
+static uint32_t s_histCount = 0;
+static uint32_t s_lastSampleMs = 0;
+static bool     s_sampledOnce = false;
+
+static void histEncode(const HistorySample& s, uint8_t* rec) {
+  memcpy(&rec[0], &s.epoch, sizeof(uint32_t));
+  rec[4] = s.mode;
+  rec[5] = s.fan;
+  rec[6] = s.targetF;
+  rec[7] = s.airF;
+}
+
+static void histDecode(const uint8_t* rec, HistorySample& s) {
+  memcpy(&s.epoch, &rec[0], sizeof(uint32_t));
+  s.mode = rec[4];
+  s.fan = rec[5];
+  s.targetF = rec[6];
+  s.airF = rec[7];
+}
+
+static void histBuildIndex(File& f) {
+  for (uint32_t i = 0; i < s_histCount; i += HIST_IDX_STRIDE) {
+    uint8_t rec[HIST_REC];
+    if (!f.seek(i * HIST_REC) || f.read(rec, HIST_REC) != HIST_REC) { s_histCount = i; break; }
+    memcpy(&s_histIdx[i / HIST_IDX_STRIDE], &rec[0], sizeof(uint32_t));
+  }
+}
+
+// Copies samples [from, s_histCount) to a fresh file (drops the oldest / a torn tail).
+static bool histRewriteFrom(uint32_t from) {
+  File src = LittleFS.open(HISTORY_PATH, "r");
+  File dst = LittleFS.open(HISTORY_TMP, "w");
+  if (!src || !dst) { if (src) src.close(); if (dst) dst.close(); return false; }
+
+  uint8_t buf[HIST_REC * 32];
+  bool ok = src.seek(from * HIST_REC);
+  uint32_t left = (s_histCount - from) * HIST_REC;
+  while (ok && left > 0) {
+    size_t n = left < sizeof(buf) ? left : sizeof(buf);
+    ok = src.read(buf, n) == n && dst.write(buf, n) == n;
+    left -= n;
+  }
+  src.close();
+  dst.close();
+  if (!ok) { LittleFS.remove(HISTORY_TMP); return false; }
+
+  if (!LittleFS.rename(HISTORY_TMP, HISTORY_PATH)) { LittleFS.remove(HISTORY_TMP); return false; }
+  s_histCount -= from;
+
+  File f = LittleFS.open(HISTORY_PATH, "r");
+  if (f) { histBuildIndex(f); f.close(); }
+  return true;
+}
+
+static void histOpen() {
+  s_histCount = 0;
+  fsRecoverTmp(HISTORY_PATH, HISTORY_TMP);
+  if (!LittleFS.exists(HISTORY_PATH)) return;
+  File f = LittleFS.open(HISTORY_PATH, "r");
+  if (!f) return;
+  size_t size = f.size();
+  s_histCount = size / HIST_REC;
+  if (s_histCount > HISTORY_MAX_SAMPLES) s_histCount = HISTORY_MAX_SAMPLES;
+  histBuildIndex(f);
+  f.close();
+
+  // Torn append: appending after a partial record would misalign everything that follows
+  if (size != s_histCount * HIST_REC) {
+    Serial.printf("[FS] %s: dropping %u trailing byte(s)\n", HISTORY_PATH, (unsigned)(size - s_histCount * HIST_REC));
+    histRewriteFrom(0);
+  }
+}
+
+static bool histAppend(const HistorySample& s) {
+  if (s_histCount >= HISTORY_MAX_SAMPLES && !histRewriteFrom(HISTORY_MAX_SAMPLES / 2)) return false;
+
+  uint8_t rec[HIST_REC];
+  histEncode(s, rec);
+  File f = LittleFS.open(HISTORY_PATH, "a");
+  if (!f) return false;
+  bool ok = f.write(rec, HIST_REC) == HIST_REC;
+  f.close();
+  if (!ok) return false;
+
+  if (s_histCount % HIST_IDX_STRIDE == 0) s_histIdx[s_histCount / HIST_IDX_STRIDE] = s.epoch;
+  s_histCount++;
+  return true;
+}
+
+uint32_t historyCount() {
+  return s_histCount;
+}
+
+int historyRead(uint32_t sinceEpoch, HistorySample* out, int cap) {
+  if (!s_mounted || s_histCount == 0 || cap <= 0) return 0;
+
+  // Last indexed block starting before sinceEpoch
+  uint32_t blocks = (s_histCount + HIST_IDX_STRIDE - 1) / HIST_IDX_STRIDE;
+  uint32_t lo = 0, hi = blocks;
+  while (hi - lo > 1) {
+    uint32_t mid = (lo + hi) / 2;
+    if (s_histIdx[mid] < sinceEpoch) lo = mid; else hi = mid;
+  }
+
+  uint32_t t0 = micros();
+  File f = LittleFS.open(HISTORY_PATH, "r");
+  if (!f) return 0;
+
+  int n = 0;
+  size_t bytes = 0;
+  uint32_t i = lo * HIST_IDX_STRIDE;
+  bool ok = f.seek(i * HIST_REC);
+  uint8_t buf[HIST_REC * 32];
+  while (ok && i < s_histCount && n < cap) {
+    uint32_t want = s_histCount - i;
+    if (want > 32) want = 32;
+    size_t got = f.read(buf, want * HIST_REC);
+    bytes += got;
+    if (got != want * HIST_REC) break;
+    for (uint32_t k = 0; k < want && n < cap; k++) {
+      HistorySample s;
+      histDecode(buf + k * HIST_REC, s);
+      if (s.epoch >= sinceEpoch) out[n++] = s;
+    }
+    i += want;
+  }
+  f.close();
+  noteRead(bytes, t0);
+  return n;
+}
+
+static void historySample() {
+  if (!timeValid()) return;
+
+  BedjetStatus st;
+  if (!bleGetStatus(st, 10000)) return;   // only record fresh frames
+
+  HistorySample s;
+  s.epoch = (uint32_t)time(nullptr);
+  s.mode = st.modeButton;
+  s.fan = st.fanStep;
+  s.targetF = (uint8_t)constrain(st.targetF, 0, 255);
+  s.airF = (uint8_t)constrain(st.airF, 0, 255);
+  if (!histAppend(s)) Serial.println("[FS] history append failed");
+}
+
+// --------------------------- Mount ---------------------------
+bool fsBegin() {
+  uint32_t t0 = micros();
+  // Partition label "fs" from partitions.csv; format on first boot (or after corruption).
+  s_mounted = LittleFS.begin(true, "/littlefs", 4, "fs");
+  g_metrics.fsMountUs = micros() - t0;
+  if (!s_mounted) {
+    Serial.println("[FS] LittleFS mount failed (check partition scheme); profiles/history disabled");
+    return false;
+  }
+
+  uint32_t t1 = micros();
+  profScan();
+  histOpen();
+  g_metrics.fsIndexUs = micros() - t1;
+
+  Serial.printf("[FS] mounted in %lu us, indexed %d profile(s) + %lu history sample(s) in %lu us (%u/%u KB used)\n",
+                (unsigned long)g_metrics.fsMountUs, s_profCount, (unsigned long)s_histCount,
+                (unsigned long)g_metrics.fsIndexUs,
+                (unsigned)(LittleFS.usedBytes() / 1024), (unsigned)(LittleFS.totalBytes() / 1024));
+  return true;
+}
+
+bool fsMounted() {
+  return s_mounted;
+}
+
+void fsLoop() {
+  if (!s_mounted) return;
+  uint32_t now = millis();
+  if (s_sampledOnce && now - s_lastSampleMs < HISTORY_SAMPLE_MS) return;
+  if (!timeValid()) return;
+
+  s_sampledOnce = true;
+  s_lastSampleMs = now;
+  historySample();
+}
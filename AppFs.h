@@ -0,0 +1,49 @@
+#pragma once
+#include "AppCommon.h"
+#include "AppState.h"
+
+// LittleFS on the "fs" partition (partitions.csv) for data that does not belong in the
+// 20 KB NVS: named schedule profiles and BedJet status history. NVS keeps only the small
+// hot records (active schedule, config, runtime flags, resume state).
+//
+// Both stores are append-only files with an in-RAM index built once at mount, so lookups
+// seek straight to the record instead of scanning the file.
+
+bool fsBegin();    // mount (formats on first use) + build indexes; false = FS features off
+bool fsMounted();
+void fsLoop();     // history sampling; call from loop()
+
+// --------------------------- Schedule profiles ---------------------------
+// "/profiles.log": keyed records (put / delete); compacted when dead records pile up.
+static const int MAX_PROFILES = 32;
+static const int PROFILE_NAME_MAX = 32;
+
+struct ProfileInfo {
+  uint16_t id;
+  uint8_t  count;     // schedule items in the profile
+  char     name[PROFILE_NAME_MAX + 1];
+};
+
+int  profileList(ProfileInfo* out, int cap);
+// Saves the current schedule. id = 0 creates a new profile, otherwise overwrites.
+bool profileSaveCurrent(uint16_t id, const String& name, uint16_t& outId, String& err);
+// Replaces the current schedule with the profile (caller persists / resets active block).
+bool profileLoad(uint16_t id, ScheduleItem* items, int& count, uint16_t& nextId, String& err);
+bool profileDelete(uint16_t id);
+
+// --------------------------- Status history ---------------------------
+// "/history.bin": fixed-size samples in time order, oldest half dropped when full.
+static const uint32_t HISTORY_SAMPLE_MS = 5UL * 60UL * 1000UL;
+static const uint32_t HISTORY_MAX_SAMPLES = 16384;   // 128 KB
+
+struct HistorySample {
+  uint32_t epoch;     // UTC seconds
+  uint8_t  mode;      // BedjetButton equivalent (0 = off / unknown)
+  uint8_t  fan;
+  uint8_t  targetF;
+  uint8_t  airF;
+};
+
+uint32_t historyCount();
+// Samples with epoch >= sinceEpoch, oldest first, at most cap.
+int historyRead(uint32_t sinceEpoch, HistorySample* out, int cap);
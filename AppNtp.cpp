@@ -0,0 +1,170 @@
+#include "AppNtp.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <sys/time.h>
+
+static const uint32_t NTP_FIRST_RETRY_MS = 1000;
+static const uint32_t NTP_FIRST_RETRY_MAX_MS = 8000;
+
+// Firmware adapter for the packet / clock math in NtpCore.cpp
+class SystemNtpClock : public NtpClock {
+ public:
+  int64_t wallUs() override {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+  }
+  uint32_t monoMs() override { return millis(); }
+  void stepUs(int64_t offsetUs) override {
+    int64_t us = wallUs() + offsetUs;
+    struct timeval tv;
+    tv.tv_sec = (time_t)(us / 1000000LL);
+    tv.tv_usec = (suseconds_t)(us % 1000000LL);
+    settimeofday(&tv, nullptr);
+  }
+  void slewUs(int64_t offsetUs) override {
+    struct timeval delta;
+    delta.tv_sec = (time_t)(offsetUs / 1000000LL);
+    delta.tv_usec = (suseconds_t)(offsetUs % 1000000LL);
+    adjtime(&delta, nullptr);
+  }
+};
+
+static WiFiUDP        s_udp;
+static String         s_server;
+static IPAddress      s_serverIp;
+static bool           s_haveIp = false;     // s_serverIp holds a usable address
+static bool           s_resolveDue = true;  // look the name up again before the next request
+static uint8_t        s_failStreak = 0;
+static bool           s_started = false;
+static bool           s_waiting = false;
+static uint32_t       s_sentMs = 0;
+static uint32_t       s_nextMs = 0;
+static uint32_t       s_retryMs = NTP_FIRST_RETRY_MS;
+static NtpStats       s_stats = {};
+static SystemNtpClock s_clock;
+static NtpCore        s_core(s_clock, s_stats);
+
+static void scheduleNext(bool ok) {
+  uint32_t now = millis();
+  if (ok) {
+    s_retryMs = NTP_FIRST_RETRY_MS;
+    s_nextMs = now + NTP_SYNC_INTERVAL_MS;
+  } else if (!ntpSynced()) {
+    s_nextMs = now + s_retryMs;
+    s_retryMs = (s_retryMs * 2 > NTP_FIRST_RETRY_MAX_MS) ? NTP_FIRST_RETRY_MAX_MS : s_retryMs * 2;
+  } else {
+    s_nextMs = now + NTP_RETRY_MS;
+  }
+}
+
+static void fail(const char* why) {
+  s_stats.failures++;
+  // Keep the address through a few lost packets; the lookup blocks loop(), see AppNtp.h
+  if (++s_failStreak >= NTP_RERESOLVE_FAILS) {
+    s_failStreak = 0;
+    s_resolveDue = true;
+  }
+  Serial.printf("[NTP] %s (%s)\n", why, s_server.c_str());
+  scheduleNext(false);
+}
+
+static void sendRequest() {
+  if (s_resolveDue) {
+    IPAddress ip;
+    if (ip.fromString(s_server.c_str()) || WiFi.hostByName(s_server.c_str(), ip)) {
+      s_serverIp = ip;
+      s_haveIp = true;
+      s_resolveDue = false;
+    } else if (!s_haveIp) {
+      fail("DNS lookup failed");
+      return;
+    }
+    // else: keep using the previous address, look up again next time
+  }
+
+  uint8_t pkt[NTP_PACKET_SIZE];
+  s_core.buildRequest(pkt);
+  if (!s_udp.beginPacket(s_serverIp, 123) || s_udp.write(pkt, sizeof(pkt)) != sizeof(pkt) || !s_udp.endPacket()) {
+    fail("send failed");
+    return;
+  }
+  s_stats.requests++;
+  s_sentMs = millis();
+  s_waiting = true;
+}
+
+static void handleReply(const uint8_t* pkt, size_t len) {
+  switch (s_core.handleReply(pkt, len)) {
+    case NTP_REPLY_OK:
+      s_failStreak = 0;
+      s_resolveDue = true;   // pick up DNS changes at the next periodic sync
+      Serial.printf("[NTP] sync #%lu offset=%ld ms rtt=%lu ms stratum=%u drift=%.1f ppm\n",
+                    (unsigned long)s_stats.syncs, (long)s_stats.lastOffsetMs, (unsigned long)s_stats.lastRttMs,
+                    (unsigned)s_stats.stratum, (double)s_stats.driftPpm);
+      scheduleNext(true);
+      break;
+
+    case NTP_REPLY_KOD:
+      // Server asks us to go away ("RATE", "DENY", ...): no fast first-sync retries, and a
+      // fresh lookup (pool names rotate) before the next try.
+      Serial.printf("[NTP] kiss-o'-death %s\n", s_core.lastKiss());
+      s_stats.failures++;
+      s_failStreak = 0;
+      s_resolveDue = true;
+      s_nextMs = millis() + NTP_RETRY_MS;
+      break;
+
+    default:
+      fail("reply rejected");
+      break;
+  }
+}
+
+void ntpBegin(const String& server) {
+  s_server = server;
+  s_server.trim();
+  if (s_server.length() == 0) s_server = "pool.ntp.org";
+  s_resolveDue = true;
+  s_haveIp = false;
+  s_failStreak = 0;
+  s_waiting = false;
+  s_retryMs = NTP_FIRST_RETRY_MS;
+  s_nextMs = millis();
+  if (!s_started) s_started = s_udp.begin(0) != 0;   // any local port
+}
+
+void ntpSyncNow() {
+  if (!s_waiting) s_nextMs = millis();
+}
+
+void ntpLoop() {
+  if (!s_started || !WiFi.isConnected()) return;
+
+  uint32_t now = millis();
+  if (s_waiting) {
+    int n = s_udp.parsePacket();
+    if (n >= (int)NTP_PACKET_SIZE) {
+      uint8_t pkt[NTP_PACKET_SIZE];
+      s_waiting = false;
+      if (s_udp.read(pkt, sizeof(pkt)) == (int)sizeof(pkt)) handleReply(pkt, sizeof(pkt));
+      else fail("short read");
+      return;
+    }
+    if (now - s_sentMs >= NTP_REPLY_TIMEOUT_MS) {
+      s_waiting = false;
+      fail("no reply");
+    }
+    return;
+  }
+
+  if ((int32_t)(now - s_nextMs) >= 0) sendRequest();
+}
+
+bool ntpSynced() {
+  return s_core.synced();
+}
+
+const NtpStats& ntpStats() {
+  return s_stats;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "AppCommon.h"
+#include "NtpCore.h"
+
+// Small SNTP client (replaces configTime()) so each sync can be measured: offset applied,
+// round-trip time, drift between syncs, time to first sync. One request in flight, polled
+// from loop(); the packet and clock math is in NtpCore.cpp. Until the first sync it retries
+// quickly (1 s doubling to 8 s), afterwards every NTP_SYNC_INTERVAL_MS.
+// Not fully non-blocking: resolving a host name (WiFi.hostByName()) blocks loop() for the
+// DNS round trip. The address is therefore kept across lost replies and looked up again only
+// at the next periodic sync, after NTP_RERESOLVE_FAILS failures in a row, or after a
+// kiss-o'-death; an IP address as server never blocks.
+static const uint32_t NTP_SYNC_INTERVAL_MS = 60UL * 60UL * 1000UL;
+static const uint32_t NTP_RETRY_MS = 60UL * 1000UL;      // after a failed periodic sync
+static const uint32_t NTP_REPLY_TIMEOUT_MS = 1500;
+static const uint8_t  NTP_RERESOLVE_FAILS = 4;           // consecutive failures before a new lookup
+
+void ntpBegin(const String& server);   // (re)start with a server host name or IP
+void ntpLoop();
+void ntpSyncNow();                     // request a sync on the next ntpLoop()
+bool ntpSynced();                      // at least one sync since boot
+const NtpStats& ntpStats();
@@ -0,0 +1,159 @@
+#include "AppRtc.h"
+#include "AppStorage.h"   // storageCrc32
+#include "AppTime.h"
+#include "AppNtp.h"
+#include <sys/time.h>
+#if USE_EXT_RTC
+#include <Wire.h>
+#endif
+
+// Checkpoint kept in RTC slow memory (not cleared by software / watchdog resets)
+struct RtcClockState {
+  int64_t  epochUs;    // wall clock at the checkpoint
+  uint32_t magic;
+  uint32_t uptimeMs;   // millis() of the previous boot at the checkpoint (diagnostics)
+  uint32_t crc;        // CRC-32 of the fields above
+};
+static const uint32_t RTC_CLOCK_MAGIC = 0x4B434A42; // "BJCK"
+RTC_NOINIT_ATTR static RtcClockState s_rtcClock;
+
+static TimeSource s_source = TIME_SRC_NONE;
+static uint32_t   s_lastCheckpointMs = 0;
+static uint32_t   s_seenSyncs = 0;
+
+static uint32_t rtcStateCrc(const RtcClockState& s) {
+  return storageCrc32((const uint8_t*)&s, offsetof(RtcClockState, crc));
+}
+
+static int64_t wallUs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void setWallUs(int64_t us) {
+  struct timeval tv;
+  tv.tv_sec = (time_t)(us / 1000000LL);
+  tv.tv_usec = (suseconds_t)(us % 1000000LL);
+  settimeofday(&tv, nullptr);
+}
+
+#if USE_EXT_RTC
+// DS3231 at 0x68, kept in UTC, 24 h mode.
+static const uint8_t DS3231_ADDR = 0x68;
+
+static uint8_t bcd2bin(uint8_t v) { return (uint8_t)((v >> 4) * 10 + (v & 0x0F)); }
+static uint8_t bin2bcd(uint8_t v) { return (uint8_t)(((v / 10) << 4) | (v % 10)); }
+
+static bool extRtcRead(time_t& out) {
+  Wire.beginTransmission(DS3231_ADDR);
+  Wire.write(0x0F);   // status: OSF (bit7) = oscillator stopped, time not trustworthy
+  if (Wire.endTransmission() != 0 || Wire.requestFrom(DS3231_ADDR, (size_t)1) != 1) return false;
+  if (Wire.read() & 0x80) return false;
+
+  Wire.beginTransmission(DS3231_ADDR);
+  Wire.write(0x00);
+  if (Wire.endTransmission() != 0 || Wire.requestFrom(DS3231_ADDR, (size_t)7) != 7) return false;
+  uint8_t r[7];
+  for (int i = 0; i < 7; i++) r[i] = (uint8_t)Wire.read();
+
+  int sec = bcd2bin(r[0] & 0x7F);
+  int min = bcd2bin(r[1] & 0x7F);
+  int hour = bcd2bin(r[2] & 0x3F);
+  int day = bcd2bin(r[4] & 0x3F);
+  int month = bcd2bin(r[5] & 0x1F);
+  int year = 2000 + bcd2bin(r[6]) + ((r[5] & 0x80) ? 100 : 0);
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || min > 59 || sec > 59) return false;
+
+  out = (time_t)daysFromCivil(year, month, day) * 86400 + hour * 3600 + min * 60 + sec;
+  return true;
+}
+
+static void extRtcWrite(time_t t) {
+  struct tm u;
+  gmtime_r(&t, &u);
+  int yy = (u.tm_year + 1900) - 2000;
+  if (yy < 0 || yy > 199) return;
+
+  Wire.beginTransmission(DS3231_ADDR);
+  Wire.write(0x00);
+  Wire.write(bin2bcd((uint8_t)u.tm_sec));
+  Wire.write(bin2bcd((uint8_t)u.tm_min));
+  Wire.write(bin2bcd((uint8_t)u.tm_hour));
+  Wire.write((uint8_t)(u.tm_wday + 1));
+  Wire.write(bin2bcd((uint8_t)u.tm_mday));
+  Wire.write((uint8_t)(bin2bcd((uint8_t)(u.tm_mon + 1)) | (yy >= 100 ? 0x80 : 0)));
+  Wire.write(bin2bcd((uint8_t)(yy % 100)));
+  Wire.endTransmission();
+
+  // Clear OSF so the next cold boot trusts the value
+  Wire.beginTransmission(DS3231_ADDR);
+  Wire.write(0x0F);
+  Wire.write(0x00);
+  Wire.endTransmission();
+}
+#endif
+
+bool rtcClockRestore() {
+  // RTC memory holds garbage after power-on; magic + CRC reject it either way.
+  bool warm = esp_reset_reason() != ESP_RST_POWERON;
+  if (warm && s_rtcClock.magic == RTC_CLOCK_MAGIC && s_rtcClock.crc == rtcStateCrc(s_rtcClock) &&
+      s_rtcClock.epochUs > 1700000000LL * 1000000LL) {
+    // The gap between the last checkpoint and the reset is unknown (< 1 s; ~0 for planned
+    // restarts, which checkpoint right before ESP.restart()). Add the time since this boot.
+    setWallUs(s_rtcClock.epochUs + (int64_t)millis() * 1000LL);
+    s_source = TIME_SRC_RTC_MEM;
+    Serial.printf("[TIME] restored from RTC memory (checkpoint at uptime %lu ms of previous boot)\n",
+                  (unsigned long)s_rtcClock.uptimeMs);
+    return true;
+  }
+
+#if USE_EXT_RTC
+  Wire.begin();
+  time_t t;
+  if (extRtcRead(t) && t > 1700000000) {
+    setWallUs((int64_t)t * 1000000LL);
+    s_source = TIME_SRC_EXT_RTC;
+    Serial.println("[TIME] restored from external RTC");
+    return true;
+  }
+#endif
+  return false;
+}
+
+void rtcClockSaveNow() {
+  if (!timeValid()) return;
+  s_rtcClock.epochUs = wallUs();
+  s_rtcClock.magic = RTC_CLOCK_MAGIC;
+  s_rtcClock.uptimeMs = millis();
+  s_rtcClock.crc = rtcStateCrc(s_rtcClock);
+}
+
+void rtcClockCheckpoint() {
+  uint32_t syncs = ntpStats().syncs;
+  if (syncs != s_seenSyncs) {
+    s_seenSyncs = syncs;
+    s_source = TIME_SRC_NTP;
+#if USE_EXT_RTC
+    extRtcWrite(time(nullptr));
+#endif
+  }
+
+  uint32_t now = millis();
+  if (now - s_lastCheckpointMs < 1000) return;
+  s_lastCheckpointMs = now;
+  rtcClockSaveNow();
+}
+
+TimeSource timeSource() {
+  return s_source;
+}
+
+const char* timeSourceName() {
+  switch (s_source) {
+    case TIME_SRC_RTC_MEM: return "rtc_mem";
+    case TIME_SRC_EXT_RTC: return "ext_rtc";
+    case TIME_SRC_NTP:     return "ntp";
+    default:               return "none";
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "AppCommon.h"
+
+// Wall-clock carry-over so the scheduler has valid time immediately after a reboot instead
+// of waiting for Wi-Fi + NTP:
+// - RTC slow memory (survives ESP.restart(), watchdog/panic resets): the last known epoch
+//   is checkpointed every second from loop() and right before a planned restart.
+// - Optional DS3231 on the default I2C pins (build with USE_EXT_RTC=1): read on cold boot,
+//   written after each NTP sync.
+// NTP still corrects the restored time; its first offset shows how far off the restore was.
+#ifndef USE_EXT_RTC
+#define USE_EXT_RTC 0
+#endif
+
+enum TimeSource : uint8_t {
+  TIME_SRC_NONE = 0,
+  TIME_SRC_RTC_MEM,   // restored from RTC memory after a warm reset
+  TIME_SRC_EXT_RTC,   // restored from the external RTC
+  TIME_SRC_NTP
+};
+
+bool rtcClockRestore();      // call first in setup(); true if the system clock was set
+void rtcClockCheckpoint();   // call from loop(); cheap, writes at most once per second
+void rtcClockSaveNow();      // before a planned restart
+TimeSource timeSource();
+const char* timeSourceName();
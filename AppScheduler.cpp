@@ -1,72 +1,99 @@
 #include "AppScheduler.h"
+#include "AppBoot.h"
+#include <atomic>
 
-static bool withinBlock(uint16_t nowMin, uint16_t startMin, uint16_t stopMin) {
-  if (startMin == stopMin) return false;
-  if (startMin < stopMin) return (nowMin >= startMin && nowMin < stopMin);
-  return (nowMin >= startMin) || (nowMin < stopMin); // wraps midnight
-}
+// Firmware adapters for the scheduler core (SchedulerCore.cpp): wall clock from the
+// ESP32 system time, commands over NimBLE, resume state in RTC memory / NVS.
 
-static uint16_t durationMinutes(uint16_t startMin, uint16_t stopMin) {
-  int d = (int)stopMin - (int)startMin;
-  if (d <= 0) d += 1440;
-  return (uint16_t)d;
+class ArduinoSchedClock : public SchedClock {
+ public:
+  bool timeValid() override { return ::timeValid(); }
+  bool localNow(uint16_t& minOfDay, uint8_t& wday, uint16_t& dayNum) override {
+    return localDateTime(minOfDay, wday, dayNum);
+  }
+  uint32_t epochNow() override { return (uint32_t)time(nullptr); }
+  uint32_t monoMs() override { return millis(); }
+};
+
+// First successful command after boot -> /api/boot "first_command"
+static bool sent(bool ok) {
+  if (ok) bootMark(BOOT_FIRST_COMMAND);
+  return ok;
 }
 
-static int pickActiveIndex(uint16_t nowMin) {
-  for (int i = 0; i < g_schedCount; i++) {
-    if (!g_sched[i].enabled) continue;
-    if (withinBlock(nowMin, g_sched[i].startMin, g_sched[i].stopMin)) return i;
-  }
-  return -1;
+class BleSchedActuator : public SchedActuator {
+ public:
+  bool ensureConnected() override { return bleEnsureConnected(); }
+  bool isConnected() override { return bleIsConnected(); }
+  bool getStatus(BedjetStatus& out) override { return bleGetStatus(out, 5000); }
+  bool setClockNow() override { return bedjetSetClockNow(); }
+  bool button(uint8_t btn) override { return sent(bedjetButton(btn)); }
+  bool setModeSmart(uint8_t btn) override { return sent(bedjetSetModeSmart(btn)); }
+  bool setFan(uint8_t step) override { return sent(bedjetSetFan(step)); }
+  bool setTempF(float tempF) override { return sent(bedjetSetTempF(tempF)); }
+  bool setRuntimeMinutes(uint16_t minutes) override { return sent(bedjetSetRuntimeMinutes(minutes)); }
+  void pauseMs(uint32_t ms) override { delay(ms); }
+  void log(const char* msg) override { Serial.println(msg); }
+};
+
+class NvsSchedPersist : public SchedPersist {
+ public:
+  bool loadResume(SchedResume& out) override { return loadResumeState(out); }
+  void saveResume(const SchedResume& r) override { saveResumeState(r); }
+};
+
+static ArduinoSchedClock s_clock;
+static BleSchedActuator s_actuator;
+static NvsSchedPersist s_persist;
+static SchedulerCore s_core(s_clock, s_actuator, s_persist, g_metrics.sched);
+
+// Control task only, except s_activeId
+static ScheduleItem s_items[MAX_SCHEDULE];
+static int s_count = 0;
+static int s_activeIndex = -1;   // applied block in s_items (-1 = none)
+static SchedParams s_params = {};
+static std::atomic<uint16_t> s_activeId(0);
+
+static void publishActive() {
+  s_activeId = (s_activeIndex >= 0 && s_activeIndex < s_count) ? s_items[s_activeIndex].id : 0;
 }
 
-static bool applySchedule(const ScheduleItem& it) {
-  if (!bleEnsureConnected()) return false;
+void schedulerSetSchedule(const ScheduleItem* items, int count, SchedActivePolicy policy) {
+  bool haveActive = s_activeIndex >= 0 && s_activeIndex < s_count;
+  ScheduleItem active = haveActive ? s_items[s_activeIndex] : ScheduleItem{};
 
-  bedjetSetClockNow();
-  delay(40);
+  if (count > MAX_SCHEDULE) count = MAX_SCHEDULE;
+  for (int i = 0; i < count; i++) s_items[i] = items[i];
+  s_count = count;
 
-  if (it.modeButton == BTN_OFF) {
-    return bedjetButton(BTN_OFF);
+  s_activeIndex = -1;
+  for (int i = 0; haveActive && policy != SCHED_RESET && i < count; i++) {
+    if (s_items[i].id != active.id) continue;
+    if (policy == SCHED_KEEP_BY_ID || scheduleItemRev(s_items[i]) == scheduleItemRev(active)) s_activeIndex = i;
+    break;
   }
-
-  // Use "smart" mode switching to improve reliability when crossing COOL <-> HEAT-family modes.
-  if (!bedjetSetModeSmart(it.modeButton)) return false;
-  delay(80);
-
-  bedjetSetFan(it.fanStep);
-  delay(60);
-
-  bedjetSetTempF(it.tempF);
-  delay(60);
-
-  // Full block duration (recommended later: remaining duration if mid-block reboot)
-  uint16_t runMins = durationMinutes(it.startMin, it.stopMin);
-  bedjetSetRuntimeMinutes(runMins);
-
-  return true;
+  publishActive();
 }
-void schedulerTick() {
-  if (!timeValid()) return;
-
-  // Pause = do not execute schedules; BedJet remains in its current state until resumed.
-  if (g_cfg.schedulesPaused) return;
 
-  uint16_t nowMin = minutesSinceMidnight();
-  int desired = pickActiveIndex(nowMin);
+void schedulerSetParams(const SchedParams& p) {
+  s_params = p;
+}
 
-  if (desired == g_activeIndex) return;
+uint16_t schedulerActiveId() {
+  return s_activeId;
+}
 
-  if (desired < 0) {
-    if (g_activeIndex >= 0) {
-      bleEnsureConnected();
-      bedjetButton(BTN_OFF);
-    }
-    g_activeIndex = -1;
-    return;
-  }
+void schedulerNoteManualCommand() {
+  s_core.noteManualCommand(s_activeIndex);
+}
 
-  if (applySchedule(g_sched[desired])) {
-    g_activeIndex = desired;
-  }
+void schedulerTick() {
+  uint32_t t0 = micros();
+  s_core.tick(s_items, s_count, s_activeIndex, s_params);
+  uint32_t us = micros() - t0;
+  publishActive();
+
+  g_metrics.tickUsLast = us;
+  if (us > g_metrics.tickUsMax) g_metrics.tickUsMax = us;
+  bootMark(BOOT_FIRST_TICK);
 }
@@ -5,5 +5,22 @@
 #include "AppStorage.h"
 #include "AppTime.h"
 #include "AppConfig.h"
+#include "SchedulerCore.h"
+
+// The scheduler runs on the control task (AppControl.h) with its own copy of the schedule,
+// the running block and the tuning parameters; the web side edits g_sched / g_cfg and the
+// control task hands the new snapshots in here.
+enum SchedActivePolicy : uint8_t {
+  SCHED_KEEP_BY_ID = 0,   // running block stays active if its id is still there
+  SCHED_KEEP_IF_SAME,     // ...and unchanged (otherwise the next tick re-applies)
+  SCHED_RESET             // new schedule altogether
+};
+void schedulerSetSchedule(const ScheduleItem* items, int count, SchedActivePolicy policy);
+void schedulerSetParams(const SchedParams& p);
+uint16_t schedulerActiveId();   // running block, 0 = none; safe from any task
 
 void schedulerTick();
+
+// Called before manual commands (Quick Controls / Run Now, see AppControl) so the reconciler
+// does not undo them for the rest of the current block.
+void schedulerNoteManualCommand();
@@ -1,21 +1,33 @@
 #pragma once
 #include "AppCommon.h"
+#include "SchedulerCore.h"
 
-static const int MAX_SCHEDULE = 16;
-
-struct ScheduleItem {
-  uint16_t id;
-  uint8_t  modeButton;   // BedjetButton
-  uint8_t  fanStep;      // 0..19
-  float    tempF;
-  uint16_t startMin;     // minutes from midnight local (0..1439)
-  uint16_t stopMin;      // minutes from midnight local (0..1439)
-  bool     enabled;
-};
 
+// The editable schedule, owned by the web side (loop()); the scheduler works on the copy
+// published after each edit (ctlPublishSchedule, AppControl.h).
 extern ScheduleItem g_sched[MAX_SCHEDULE];
 extern int g_schedCount;
 extern uint16_t g_nextId;
 
-extern int g_activeIndex;
-extern uint32_t g_lastSchedulerTickMs;
+// Schedule revision: changes on every edit (random start per boot, so a browser holding a
+// revision from before a reboot never matches by accident). See /api/state?rev=.
+extern uint32_t g_schedRev;
+
+// Counters exposed at /api/metrics
+struct AppMetrics {
+  SchedStats sched;       // transitions + reconciler counters (owned by SchedulerCore)
+  uint32_t   tickUsLast;  // duration of the last schedulerTick() (includes BLE writes)
+  uint32_t   tickUsMax;
+  uint32_t   schedSaves;       // saveSchedule() calls (NVS writes of the schedule blob)
+  uint32_t   schedSaveUsLast;  // duration of the last saveSchedule()
+  uint32_t   schedSaveUsMax;
+  uint32_t   persistFlushes;      // write-behind flushes (see persistLoop())
+  uint32_t   persistFlushUsLast;  // duration of the last flush (schedule + config)
+  uint32_t   persistDelayMsLast;  // first change -> flush for the last flush
+  uint32_t   fsMountUs;     // LittleFS mount at boot
+  uint32_t   fsIndexUs;     // building the profile / history indexes at boot
+  uint32_t   fsReadBytes;   // bytes read for profile loads + history queries
+  uint32_t   fsReadUs;      // time spent on those reads
+  uint32_t   webLoopUsMax;  // longest gap between two loop() passes (HTTP responsiveness)
+};
+extern AppMetrics g_metrics;
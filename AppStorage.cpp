@@ -1,42 +1,242 @@
 #include "AppStorage.h"
+#include "AppConfig.h"
 
-static Preferences prefs;
+std::mutex g_nvsMutex;
 
-void saveSchedule() {
-  prefs.begin("bedjet", false);
-  prefs.putUInt("count", (uint32_t)g_schedCount);
-  prefs.putUInt("nextId", (uint32_t)g_nextId);
+static Preferences prefs;         // loop(): schedule
+static Preferences prefsResume;   // control task: resume state
 
-  for (int i = 0; i < g_schedCount; i++) {
-    char key[16];
-    snprintf(key, sizeof(key), "s%02d", i);
+// RTC slow memory is not cleared by software resets, watchdog resets or brownouts.
+static const uint32_t RESUME_MAGIC = 0x424A5253; // "BJRS"
+RTC_NOINIT_ATTR static uint32_t s_rtcResumeMagic;
+RTC_NOINIT_ATTR static SchedResume s_rtcResume;
+
+// Packed 22-byte item record (little endian):
+//   [0..1] id  [2] mode  [3] fan  [4..7] tempF (float)  [8..9] startMin  [10..11] stopMin
+//   [12] flags (bit0 enabled, bit1 override)  [13] days mask
+//   [14..15] fromDay  [16..17] toDay
+//   [18] ramp temp °F  [19] ramp fan step  [20..21] ramp minutes
+// Records written before weekly schedules had zeros in [13..17] and 0/1 in [12], which
+// decode as "every day, no date limits" (a zero days mask is treated as DAYS_ALL).
+// Records written before ramps are 18 bytes long and decode as "no ramp".
+static const size_t SCHED_REC_SIZE = 22;
+static const size_t SCHED_REC_SIZE_V1 = 18;
+static const uint8_t REC_F_ENABLED  = 0x01;
+static const uint8_t REC_F_OVERRIDE = 0x02;
+
+static void packScheduleItem(const ScheduleItem& it, uint8_t* blob) {
+  memset(blob, 0, SCHED_REC_SIZE);
+  blob[0] = (uint8_t)(it.id & 0xFF);
+  blob[1] = (uint8_t)(it.id >> 8);
+  blob[2] = it.modeButton;
+  blob[3] = it.fanStep;
+  memcpy(&blob[4], &it.tempF, sizeof(float));
+  blob[8]  = (uint8_t)(it.startMin & 0xFF);
+  blob[9]  = (uint8_t)(it.startMin >> 8);
+  blob[10] = (uint8_t)(it.stopMin & 0xFF);
+  blob[11] = (uint8_t)(it.stopMin >> 8);
+  blob[12] = (it.enabled ? REC_F_ENABLED : 0) | (it.isOverride ? REC_F_OVERRIDE : 0);
+  blob[13] = it.daysMask & DAYS_ALL;
+  blob[14] = (uint8_t)(it.fromDay & 0xFF);
+  blob[15] = (uint8_t)(it.fromDay >> 8);
+  blob[16] = (uint8_t)(it.toDay & 0xFF);
+  blob[17] = (uint8_t)(it.toDay >> 8);
+  blob[18] = it.rampToTempF;
+  blob[19] = it.rampToFan;
+  blob[20] = (uint8_t)(it.rampMinutes & 0xFF);
+  blob[21] = (uint8_t)(it.rampMinutes >> 8);
+}
 
-    uint8_t blob[18];
-    memset(blob, 0, sizeof(blob));
-    blob[0] = (uint8_t)(g_sched[i].id & 0xFF);
-    blob[1] = (uint8_t)(g_sched[i].id >> 8);
-    blob[2] = g_sched[i].modeButton;
-    blob[3] = g_sched[i].fanStep;
-    memcpy(&blob[4], &g_sched[i].tempF, sizeof(float));
-    blob[8]  = (uint8_t)(g_sched[i].startMin & 0xFF);
-    blob[9]  = (uint8_t)(g_sched[i].startMin >> 8);
-    blob[10] = (uint8_t)(g_sched[i].stopMin & 0xFF);
-    blob[11] = (uint8_t)(g_sched[i].stopMin >> 8);
-    blob[12] = g_sched[i].enabled ? 1 : 0;
-
-    prefs.putBytes(key, blob, sizeof(blob));
+static void unpackScheduleItem(const uint8_t* blob, size_t len, ScheduleItem& it) {
+  it = ScheduleItem{};
+  it.id = (uint16_t)blob[0] | ((uint16_t)blob[1] << 8);
+  it.modeButton = blob[2];
+  it.fanStep = blob[3];
+  memcpy(&it.tempF, &blob[4], sizeof(float));
+  it.startMin = (uint16_t)blob[8]  | ((uint16_t)blob[9]  << 8);
+  it.stopMin  = (uint16_t)blob[10] | ((uint16_t)blob[11] << 8);
+  it.enabled    = (blob[12] & REC_F_ENABLED) != 0;
+  it.isOverride = (blob[12] & REC_F_OVERRIDE) != 0;
+  it.daysMask = blob[13] & DAYS_ALL;
+  if (it.daysMask == 0) it.daysMask = DAYS_ALL;
+  it.fromDay = (uint16_t)blob[14] | ((uint16_t)blob[15] << 8);
+  it.toDay   = (uint16_t)blob[16] | ((uint16_t)blob[17] << 8);
+  it.rampToFan = RAMP_FAN_NONE;
+  if (len >= SCHED_REC_SIZE) {
+    it.rampToTempF = blob[18];
+    it.rampToFan   = blob[19];
+    it.rampMinutes = (uint16_t)blob[20] | ((uint16_t)blob[21] << 8);
   }
+}
 
-  for (int i = g_schedCount; i < MAX_SCHEDULE; i++) {
-    char key[16];
-    snprintf(key, sizeof(key), "s%02d", i);
-    prefs.remove(key);
+// --------------------------- A/B records ---------------------------
+// A record is written alternately to "<key>A" and "<key>B"; each slot is
+//   [0..3] sequence number  [4..7] CRC-32 of seq + payload  [8..] payload
+// A save only ever overwrites the older slot, so an interrupted write leaves the previous
+// copy intact, and boot picks the valid slot with the highest sequence number.
+static const size_t AB_HDR = 8;
+static const size_t AB_PAYLOAD_MAX = 800;
+static uint8_t s_abBuf[AB_HDR + AB_PAYLOAD_MAX];
+
+static void abKey(char* out, size_t cap, const char* key, char slot) {
+  snprintf(out, cap, "%s%c", key, slot);
+}
+
+static uint32_t abCrc(const uint8_t* slot, size_t len) {
+  uint32_t crc = storageCrc32(slot, 4);
+  return storageCrc32(slot + AB_HDR, len - AB_HDR, crc);
+}
+
+size_t abReadNewest(Preferences& p, const char* key, uint8_t* payload, size_t cap, AbState& st, char skipSlot) {
+  st = AbState{};
+  size_t found = 0;
+  for (char slot = 'A'; slot <= 'B'; slot++) {
+    if (slot == skipSlot) continue;
+    char k[16];
+    abKey(k, sizeof(k), key, slot);
+    if (!p.isKey(k)) continue;
+    size_t n = p.getBytes(k, s_abBuf, sizeof(s_abBuf));
+    if (n <= AB_HDR || n - AB_HDR > cap) continue;
+
+    uint32_t seq, crc;
+    memcpy(&seq, &s_abBuf[0], sizeof(uint32_t));
+    memcpy(&crc, &s_abBuf[4], sizeof(uint32_t));
+    if (abCrc(s_abBuf, n) != crc) {
+      Serial.printf("[NVS] %s: bad CRC, ignoring slot\n", k);
+      continue;
+    }
+    if (st.slot && (int32_t)(seq - st.seq) <= 0) continue;
+
+    st.seq = seq;
+    st.slot = slot;
+    found = n - AB_HDR;
+    memcpy(payload, s_abBuf + AB_HDR, found);
+  }
+  return found;
+}
+
+bool abWrite(Preferences& p, const char* key, const uint8_t* payload, size_t len, AbState& st) {
+  if (len > AB_PAYLOAD_MAX) return false;
+
+  char slot = (st.slot == 'A') ? 'B' : 'A';
+  uint32_t seq = st.seq + 1;
+  memcpy(&s_abBuf[0], &seq, sizeof(uint32_t));
+  memcpy(s_abBuf + AB_HDR, payload, len);
+  uint32_t crc = abCrc(s_abBuf, AB_HDR + len);
+  memcpy(&s_abBuf[4], &crc, sizeof(uint32_t));
+
+  char k[16];
+  abKey(k, sizeof(k), key, slot);
+  if (p.putBytes(k, s_abBuf, AB_HDR + len) != AB_HDR + len) return false;
+
+  st.seq = seq;
+  st.slot = slot;
+  return true;
+}
+
+// Whole schedule = one A/B record under "sched" (one putBytes per save):
+//   [0..3] magic "BJSC"  [4] version  [5] record size  [6] count  [7] reserved
+//   [8..9] nextId  [10..11] reserved  [12..15] CRC-32 of bytes [0..11] + records
+//   [16..] count * record
+// Older firmware stored the same payload unslotted under "sched", and before that "count",
+// "nextId" and one key per item ("s00".."s15"); loadSchedule() migrates either once.
+static const uint32_t SCHED_BLOB_MAGIC = 0x43534A42; // "BJSC" little endian
+static const uint8_t  SCHED_BLOB_VERSION = 1;
+static const size_t   SCHED_BLOB_HDR = 16;
+static_assert(SCHED_BLOB_MAX == SCHED_BLOB_HDR + MAX_SCHEDULE * SCHED_REC_SIZE, "SCHED_BLOB_MAX");
+
+uint32_t storageCrc32(const uint8_t* data, size_t len, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+static uint32_t schedBlobCrc(const uint8_t* blob, size_t len) {
+  uint32_t crc = storageCrc32(blob, 12);
+  return storageCrc32(blob + SCHED_BLOB_HDR, len - SCHED_BLOB_HDR, crc);
+}
+
+size_t encodeScheduleBlob(const ScheduleItem* items, int count, uint16_t nextId, uint8_t* blob) {
+  memset(blob, 0, SCHED_BLOB_HDR);
+  memcpy(&blob[0], &SCHED_BLOB_MAGIC, sizeof(uint32_t));
+  blob[4] = SCHED_BLOB_VERSION;
+  blob[5] = (uint8_t)SCHED_REC_SIZE;
+  blob[6] = (uint8_t)count;
+  blob[8] = (uint8_t)(nextId & 0xFF);
+  blob[9] = (uint8_t)(nextId >> 8);
+
+  size_t len = SCHED_BLOB_HDR;
+  for (int i = 0; i < count; i++) {
+    packScheduleItem(items[i], blob + len);
+    len += SCHED_REC_SIZE;
+  }
+
+  uint32_t crc = schedBlobCrc(blob, len);
+  memcpy(&blob[12], &crc, sizeof(uint32_t));
+  return len;
+}
+
+bool decodeScheduleBlob(const uint8_t* blob, size_t len, ScheduleItem* items, int& outCount, uint16_t& outNextId) {
+  if (len < SCHED_BLOB_HDR) return false;
+
+  uint32_t magic, crc;
+  memcpy(&magic, &blob[0], sizeof(uint32_t));
+  memcpy(&crc, &blob[12], sizeof(uint32_t));
+  if (magic != SCHED_BLOB_MAGIC || blob[4] != SCHED_BLOB_VERSION) return false;
+
+  size_t recSize = blob[5];
+  int count = blob[6];
+  if (recSize < SCHED_REC_SIZE_V1 || count > MAX_SCHEDULE) return false;
+  if (len != SCHED_BLOB_HDR + (size_t)count * recSize) return false;
+  if (schedBlobCrc(blob, len) != crc) return false;
+
+  uint16_t nextId = (uint16_t)blob[8] | ((uint16_t)blob[9] << 8);
+  if (nextId == 0) nextId = 1;
+  for (int i = 0; i < count; i++) {
+    unpackScheduleItem(blob + SCHED_BLOB_HDR + (size_t)i * recSize, recSize, items[i]);
+    if (items[i].id >= nextId) nextId = items[i].id + 1;
   }
+  outCount = count;
+  outNextId = nextId;
+  return true;
+}
+
+static AbState s_schedAb;
 
+uint32_t scheduleItemRev(const ScheduleItem& it) {
+  uint8_t rec[SCHED_REC_SIZE];
+  packScheduleItem(it, rec);
+  return storageCrc32(rec, sizeof(rec));
+}
+
+bool saveSchedule() {
+  uint32_t t0 = micros();
+
+  uint8_t blob[SCHED_BLOB_MAX];
+  size_t len = encodeScheduleBlob(g_sched, g_schedCount, g_nextId, blob);
+
+  g_nvsMutex.lock();
+  prefs.begin("bedjet", false);
+  bool ok = abWrite(prefs, "sched", blob, len, s_schedAb);
   prefs.end();
+  g_nvsMutex.unlock();
+  if (!ok) Serial.println("[NVS] schedule save FAILED");
+
+  uint32_t us = micros() - t0;
+  g_metrics.schedSaveUsLast = us;
+  if (us > g_metrics.schedSaveUsMax) g_metrics.schedSaveUsMax = us;
+  g_metrics.schedSaves++;
+  Serial.printf("[NVS] schedule saved (%u items, %u bytes) in %lu us\n",
+                (unsigned)g_schedCount, (unsigned)len, (unsigned long)us);
+  return ok;
 }
-void loadSchedule() {
-  prefs.begin("bedjet", true);
+
+// Legacy per-slot layout: "count", "nextId", "s00".."s15"
+static bool loadLegacySchedule() {
+  if (!prefs.isKey("count")) return false;
 
   g_schedCount = (int)prefs.getUInt("count", 0);
   if (g_schedCount < 0) g_schedCount = 0;
@@ -44,26 +244,171 @@ void loadSchedule() {
 
   g_nextId = (uint16_t)prefs.getUInt("nextId", 1);
 
+  int loaded = 0;
   for (int i = 0; i < g_schedCount; i++) {
     char key[16];
     snprintf(key, sizeof(key), "s%02d", i);
 
-    uint8_t blob[18];
+    uint8_t blob[SCHED_REC_SIZE];
     size_t n = prefs.getBytes(key, blob, sizeof(blob));
-    if (n != sizeof(blob)) continue;
+    if (n != sizeof(blob) && n != SCHED_REC_SIZE_V1) continue;
 
     ScheduleItem it{};
-    it.id = (uint16_t)blob[0] | ((uint16_t)blob[1] << 8);
-    it.modeButton = blob[2];
-    it.fanStep = blob[3];
-    memcpy(&it.tempF, &blob[4], sizeof(float));
-    it.startMin = (uint16_t)blob[8]  | ((uint16_t)blob[9]  << 8);
-    it.stopMin  = (uint16_t)blob[10] | ((uint16_t)blob[11] << 8);
-    it.enabled  = blob[12] ? true : false;
-
-    g_sched[i] = it;
+    unpackScheduleItem(blob, n, it);
+
+    g_sched[loaded++] = it;
     if (it.id >= g_nextId) g_nextId = it.id + 1;
   }
+  g_schedCount = loaded;
+  return true;
+}
+
+static void removeLegacyScheduleKeys() {
+  g_nvsMutex.lock();
+  prefs.begin("bedjet", false);
+  prefs.remove("sched");
+  prefs.remove("count");
+  prefs.remove("nextId");
+  for (int i = 0; i < MAX_SCHEDULE; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "s%02d", i);
+    prefs.remove(key);
+  }
+  prefs.end();
+  g_nvsMutex.unlock();
+}
+
+void loadSchedule() {
+  g_schedCount = 0;
+  g_nextId = 1;
 
+  uint8_t blob[SCHED_BLOB_MAX];
+  g_nvsMutex.lock();
+  prefs.begin("bedjet", true);
+  size_t n = abReadNewest(prefs, "sched", blob, sizeof(blob), s_schedAb);
+  bool migrate = false;
+  bool loaded = n > 0 && decodeScheduleBlob(blob, n, g_sched, g_schedCount, g_nextId);
+  if (!loaded && n > 0) {
+    // Newest slot is intact but does not decode (e.g. left by newer firmware): the other
+    // slot still holds the save before it.
+    AbState older;
+    size_t m = abReadNewest(prefs, "sched", blob, sizeof(blob), older, s_schedAb.slot);
+    loaded = m > 0 && decodeScheduleBlob(blob, m, g_sched, g_schedCount, g_nextId);
+    if (loaded) {
+      Serial.printf("[NVS] schedule slot %c invalid (version); loaded slot %c\n", s_schedAb.slot, older.slot);
+      s_schedAb.slot = older.slot;   // next save overwrites the bad slot, not this one
+    }
+  }
+  if (!loaded) {
+    if (n > 0) Serial.println("[NVS] schedule record invalid (version); trying legacy keys");
+    // Unslotted blob (pre-A/B), then per-item keys
+    size_t m = prefs.isKey("sched") ? prefs.getBytes("sched", blob, sizeof(blob)) : 0;
+    migrate = (m > 0 && decodeScheduleBlob(blob, m, g_sched, g_schedCount, g_nextId)) || loadLegacySchedule();
+  }
   prefs.end();
+  g_nvsMutex.unlock();
+
+  if (migrate) {
+    Serial.printf("[NVS] migrating %d legacy schedule item(s) to A/B record\n", g_schedCount);
+    // The legacy keys are the only copy until the A/B record is written; retried next boot
+    if (saveSchedule()) removeLegacyScheduleKeys();
+    else Serial.println("[NVS] migration write failed; legacy schedule keys kept");
+  }
+}
+
+// --------------------------- Write-behind ---------------------------
+static bool s_schedDirty = false;
+static bool s_cfgDirty = false;
+static bool s_flagsDirty = false;
+static uint32_t s_dirtySinceMs = 0;   // first change since the last flush
+static uint32_t s_lastChangeMs = 0;   // most recent change
+
+static void noteDirty() {
+  uint32_t now = millis();
+  if (!persistPending()) s_dirtySinceMs = now;
+  s_lastChangeMs = now;
+}
+
+void markScheduleDirty() {
+  noteDirty();
+  s_schedDirty = true;
+}
+
+void markConfigDirty() {
+  noteDirty();
+  s_cfgDirty = true;
+}
+
+void markConfigFlagsDirty() {
+  noteDirty();
+  s_flagsDirty = true;
+}
+
+bool persistPending() {
+  return s_schedDirty || s_cfgDirty || s_flagsDirty;
+}
+
+void persistFlush() {
+  if (!persistPending()) return;
+
+  uint32_t t0 = micros();
+  if (s_schedDirty) { s_schedDirty = false; saveSchedule(); }
+  if (s_cfgDirty)        { s_cfgDirty = false; s_flagsDirty = false; saveConfigToNvs(g_cfg, true); }
+  else if (s_flagsDirty) { s_flagsDirty = false; saveConfigFlagsToNvs(g_cfg); }
+  uint32_t us = micros() - t0;
+
+  g_metrics.persistFlushes++;
+  g_metrics.persistFlushUsLast = us;
+  g_metrics.persistDelayMsLast = millis() - s_dirtySinceMs;
+  Serial.printf("[NVS] flushed pending state in %lu us (%lu ms after first change)\n",
+                (unsigned long)us, (unsigned long)g_metrics.persistDelayMsLast);
+}
+
+void persistLoop() {
+  if (!persistPending()) return;
+
+  uint32_t now = millis();
+  if (now - s_lastChangeMs >= PERSIST_QUIET_MS || now - s_dirtySinceMs >= PERSIST_MAX_DELAY_MS) {
+    persistFlush();
+  }
+}
+
+void saveResumeState(const SchedResume& r) {
+  s_rtcResume = r;
+  s_rtcResumeMagic = RESUME_MAGIC;
+
+  uint8_t blob[10];
+  blob[0] = (uint8_t)(r.schedId & 0xFF);
+  blob[1] = (uint8_t)(r.schedId >> 8);
+  memcpy(&blob[2], &r.itemHash, sizeof(uint32_t));
+  memcpy(&blob[6], &r.appliedEpoch, sizeof(uint32_t));
+
+  g_nvsMutex.lock();
+  prefsResume.begin("bedjet", false);
+  prefsResume.putBytes("resume", blob, sizeof(blob));
+  prefsResume.end();
+  g_nvsMutex.unlock();
+}
+bool loadResumeState(SchedResume& out) {
+  // Prefer RTC memory (no flash read); fall back to NVS after a cold power-up.
+  if (s_rtcResumeMagic == RESUME_MAGIC) {
+    out = s_rtcResume;
+    return true;
+  }
+
+  uint8_t blob[10];
+  g_nvsMutex.lock();
+  prefsResume.begin("bedjet", true);
+  size_t n = prefsResume.getBytes("resume", blob, sizeof(blob));
+  prefsResume.end();
+  g_nvsMutex.unlock();
+  if (n != sizeof(blob)) return false;
+
+  out.schedId = (uint16_t)blob[0] | ((uint16_t)blob[1] << 8);
+  memcpy(&out.itemHash, &blob[2], sizeof(uint32_t));
+  memcpy(&out.appliedEpoch, &blob[6], sizeof(uint32_t));
+
+  s_rtcResume = out;
+  s_rtcResumeMagic = RESUME_MAGIC;
+  return true;
 }
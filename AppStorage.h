@@ -2,6 +2,56 @@
 #include "AppCommon.h"
 #include "AppState.h"
 #include <Preferences.h>
+#include <mutex>
 
-void saveSchedule();
+// NVS is used from loop() (schedule, config, Wi-Fi hint) and from the control task (resume
+// state, see AppControl.h). Each user has its own Preferences object and holds this lock
+// from begin() to end(), so the two tasks never interleave.
+extern std::mutex g_nvsMutex;
+
+bool saveSchedule();   // false if the NVS write failed (previous save still loads)
 void loadSchedule();
+
+// Schedule payload codec (also used for schedule profiles on LittleFS, see AppFs.h).
+// decode validates magic/version/length/CRC and writes nothing on failure.
+static const size_t SCHED_BLOB_MAX = 16 + MAX_SCHEDULE * 22;
+size_t encodeScheduleBlob(const ScheduleItem* items, int count, uint16_t nextId, uint8_t* blob);
+// Content revision of one item (CRC of its packed record); changes whenever any field does.
+uint32_t scheduleItemRev(const ScheduleItem& it);
+bool decodeScheduleBlob(const uint8_t* blob, size_t len, ScheduleItem* items, int& outCount, uint16_t& outNextId);
+
+// Double-buffered ("<key>A" / "<key>B") records with sequence numbers; see AppStorage.cpp.
+struct AbState {
+  uint32_t seq;   // sequence number of the newest valid slot
+  char     slot;  // 'A', 'B' or 0 = none
+};
+// Copies the newest valid payload into `payload` and returns its length (0 = none).
+// skipSlot ('A' / 'B') leaves that slot out, to fall back to the older copy when the newest
+// one passes the CRC but its contents do not decode.
+size_t abReadNewest(Preferences& p, const char* key, uint8_t* payload, size_t cap, AbState& st, char skipSlot = 0);
+// Writes over the older slot; updates st on success.
+bool abWrite(Preferences& p, const char* key, const uint8_t* payload, size_t len, AbState& st);
+
+// CRC-32 (IEEE 802.3) used by the persisted records; chain calls by passing the previous result.
+uint32_t storageCrc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+// Write-behind persistence: HTTP handlers mark state dirty and return immediately;
+// persistLoop() (called from loop()) writes it once edits have been quiet for
+// PERSIST_QUIET_MS, or at the latest PERSIST_MAX_DELAY_MS after the first change.
+// persistFlush() writes synchronously (used before a restart).
+static const uint32_t PERSIST_QUIET_MS = 1500;
+static const uint32_t PERSIST_MAX_DELAY_MS = 10000;
+
+void markScheduleDirty();
+void markConfigDirty();      // g_cfg -> NVS (password kept if blank)
+void markConfigFlagsDirty(); // only g_cfg runtime flags (schedulesPaused)
+void persistLoop();
+void persistFlush();
+bool persistPending();
+
+// Last schedule block actually applied to the BedJet (SchedResume). Kept in RTC memory
+// (survives soft resets / brownouts) and mirrored to NVS (survives power loss) so a reboot
+// in the middle of a block can resume without re-sending identical commands.
+
+void saveResumeState(const SchedResume& r);
+bool loadResumeState(SchedResume& out);
@@ -5,26 +5,371 @@ bool timeValid() {
   return now > 1700000000; // sanity threshold
 }
 
+// --------------------------- Cached local time ---------------------------
+// The POSIX TZ string ("EST5EDT,M3.2.0/2,M11.1.0/2") is parsed once by timeSetTz().
+// For any instant we cache the UTC offset together with the UTC window [from, until) in
+// which it holds (between two DST transitions), so converting time() to local minute /
+// weekday / date is integer arithmetic until the next transition. TZ strings this parser
+// does not understand fall back to libc localtime_r().
+struct TzRule {
+  char    kind;     // 'M' (Mm.w.d), 'J' (Jn, 1..365 without Feb 29), 'N' (n, 0..365)
+  int     month, week, wday, day;
+  int32_t timeSec;  // local wall time of the transition (default 02:00)
+};
+
+struct TzInfo {
+  bool    parsed;
+  bool    hasDst;
+  int32_t stdOff;   // seconds east of UTC
+  int32_t dstOff;
+  TzRule  start;    // std -> dst (expressed in standard time)
+  TzRule  end;      // dst -> std (expressed in daylight time)
+};
+
+// UTC offset valid for [from, until)
+struct TzWindow {
+  int64_t from;
+  int64_t until;
+  int32_t off;
+  bool    dst;
+};
+static const TzWindow TZ_WINDOW_EMPTY = { 1, 0, 0, false };
+
+// Read from loop() and the control task, written on a hot TZ change; the 64-bit window
+// bounds are not written atomically on the ESP32. Callers copy under s_tzMux and do the
+// arithmetic on their copy.
+static portMUX_TYPE s_tzMux = portMUX_INITIALIZER_UNLOCKED;
+static TzInfo   s_tz = { false, false, 0, 0, {}, {} };
+static TzWindow s_cache = TZ_WINDOW_EMPTY;
+static uint32_t s_tzGen = 0;   // bumped by timeSetTz(); a window for an older TZ is dropped
+
+static long daysFromCivilL(long year, int month, int day) {
+  year -= month <= 2;
+  long era = (year >= 0 ? year : year - 399) / 400;
+  long yoe = year - era * 400;
+  long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static void civilFromDaysL(long dayNum, int& year, int& month, int& day) {
+  long z = dayNum + 719468;
+  long era = (z >= 0 ? z : z - 146096) / 146097;
+  long doe = z - era * 146097;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  day = (int)(doy - (153 * mp + 2) / 5 + 1);
+  month = (int)(mp < 10 ? mp + 3 : mp - 9);
+  year = (int)(yoe + era * 400 + (month <= 2));
+}
+
+static bool isLeap(long y) {
+  return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+static int daysInMonth(long y, int m) {
+  static const uint8_t kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return (m == 2 && isLeap(y)) ? 29 : kDays[m - 1];
+}
+
+static long floorDiv(int64_t a, long b) {
+  return (long)(a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+static bool tzParseName(const char*& p) {
+  if (*p == '<') {
+    const char* e = strchr(p, '>');
+    if (!e || e - p < 4) return false;
+    p = e + 1;
+    return true;
+  }
+  const char* b = p;
+  while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z')) p++;
+  return p - b >= 3;
+}
+
+// [+-]hh[:mm[:ss]] -> seconds (sign as written)
+static bool tzParseHms(const char*& p, int32_t& out, int maxHours) {
+  int sign = 1;
+  if (*p == '+' || *p == '-') { if (*p == '-') sign = -1; p++; }
+  if (!isDigit((unsigned char)*p)) return false;
+  long v[3] = {0, 0, 0};
+  for (int i = 0; i < 3; i++) {
+    if (i > 0) {
+      if (*p != ':') break;
+      p++;
+    }
+    if (!isDigit((unsigned char)*p)) return false;
+    v[i] = strtol(p, (char**)&p, 10);
+  }
+  if (v[0] > maxHours || v[1] > 59 || v[2] > 59) return false;
+  out = sign * (int32_t)(v[0] * 3600 + v[1] * 60 + v[2]);
+  return true;
+}
+
+static bool tzParseRule(const char*& p, TzRule& r) {
+  r = TzRule{};
+  if (*p == 'M') {
+    p++;
+    r.kind = 'M';
+    r.month = (int)strtol(p, (char**)&p, 10);
+    if (*p++ != '.') return false;
+    r.week = (int)strtol(p, (char**)&p, 10);
+    if (*p++ != '.') return false;
+    r.wday = (int)strtol(p, (char**)&p, 10);
+    if (r.month < 1 || r.month > 12 || r.week < 1 || r.week > 5 || r.wday < 0 || r.wday > 6) return false;
+  } else if (*p == 'J') {
+    p++;
+    r.kind = 'J';
+    r.day = (int)strtol(p, (char**)&p, 10);
+    if (r.day < 1 || r.day > 365) return false;
+  } else if (isDigit((unsigned char)*p)) {
+    r.kind = 'N';
+    r.day = (int)strtol(p, (char**)&p, 10);
+    if (r.day > 365) return false;
+  } else {
+    return false;
+  }
+  r.timeSec = 2 * 3600;
+  if (*p == '/') {
+    p++;
+    if (!tzParseHms(p, r.timeSec, 167)) return false;
+  }
+  return true;
+}
+
+static bool tzParse(const char* p, TzInfo& tz) {
+  tz = TzInfo{};
+  int32_t off;
+  if (!tzParseName(p) || !tzParseHms(p, off, 24)) return false;
+  tz.stdOff = -off;   // POSIX offsets are west-positive
+  tz.dstOff = tz.stdOff;
+
+  if (*p == 0) { tz.parsed = true; return true; }
+
+  if (!tzParseName(p)) return false;
+  tz.hasDst = true;
+  tz.dstOff = tz.stdOff + 3600;
+  if (*p != ',' && *p != 0) {
+    if (!tzParseHms(p, off, 24)) return false;
+    tz.dstOff = -off;
+  }
+  // DST without explicit rules: libc applies its built-in default, leave that to libc
+  if (*p != ',') return false;
+  p++;
+  if (!tzParseRule(p, tz.start) || *p++ != ',' || !tzParseRule(p, tz.end) || *p != 0) return false;
+
+  tz.parsed = true;
+  return true;
+}
+
+// Local date (days since epoch) a rule falls on in `year`
+static long tzRuleDay(const TzRule& r, int year) {
+  long jan1 = daysFromCivilL(year, 1, 1);
+  if (r.kind == 'J') return jan1 + r.day - 1 + ((isLeap(year) && r.day >= 60) ? 1 : 0);
+  if (r.kind == 'N') return jan1 + r.day;
+
+  long first = daysFromCivilL(year, r.month, 1);
+  long next = (r.month == 12) ? daysFromCivilL(year + 1, 1, 1) : daysFromCivilL(year, r.month + 1, 1);
+  int firstWday = (int)(((first % 7) + 11) % 7);   // 1970-01-01 was a Thursday (4)
+  long d = first + (r.wday - firstWday + 7) % 7 + (long)(r.week - 1) * 7;
+  while (d >= next) d -= 7;   // week 5 = last
+  return d;
+}
+
+static void tzRecompute(const TzInfo& tz, int64_t t, TzWindow& w) {
+  if (!tz.hasDst) {
+    w.off = tz.stdOff;
+    w.dst = false;
+    w.from = INT64_MIN;
+    w.until = INT64_MAX;
+    return;
+  }
+
+  int year, month, day;
+  civilFromDaysL(floorDiv(t + tz.stdOff, 86400), year, month, day);
+
+  // Transitions of the surrounding years in UTC, in time order
+  int64_t at[6];
+  bool    toDst[6];
+  int n = 0;
+  for (int y = year - 1; y <= year + 1; y++) {
+    int64_t s = (int64_t)tzRuleDay(tz.start, y) * 86400 + tz.start.timeSec - tz.stdOff;
+    int64_t e = (int64_t)tzRuleDay(tz.end, y) * 86400 + tz.end.timeSec - tz.dstOff;
+    at[n] = s; toDst[n++] = true;
+    at[n] = e; toDst[n++] = false;
+  }
+  for (int i = 1; i < n; i++) {
+    for (int k = i; k > 0 && at[k] < at[k - 1]; k--) {
+      int64_t ta = at[k]; at[k] = at[k - 1]; at[k - 1] = ta;
+      bool tb = toDst[k]; toDst[k] = toDst[k - 1]; toDst[k - 1] = tb;
+    }
+  }
+
+  int last = -1;
+  for (int i = 0; i < n; i++) if (at[i] <= t) last = i;
+
+  w.dst = (last >= 0) ? toDst[last] : !toDst[0];
+  w.off = w.dst ? tz.dstOff : tz.stdOff;
+  w.from = (last >= 0) ? at[last] : INT64_MIN;
+  w.until = (last + 1 < n) ? at[last + 1] : INT64_MAX;
+}
+
+void timeSetTz(const String& tz) {
+  TzInfo info = { false, false, 0, 0, {}, {} };
+  if (!tzParse(tz.c_str(), info)) info.parsed = false;
+
+  portENTER_CRITICAL(&s_tzMux);
+  s_tz = info;
+  s_cache = TZ_WINDOW_EMPTY;
+  s_tzGen++;
+  portEXIT_CRITICAL(&s_tzMux);
+
+  if (!info.parsed) Serial.printf("[TIME] TZ \"%s\" not parsed; using libc localtime\n", tz.c_str());
+}
+
+// libc path for TZ strings the parser does not handle
+static void localClockLibc(time_t t, LocalClock& out) {
+  struct tm lt{};
+  struct tm gt{};
+  localtime_r(&t, &lt);
+  gmtime_r(&t, &gt);
+
+  struct tm lt2 = lt;
+  struct tm gt2 = gt;
+  gt2.tm_isdst = 0;
+  lt2.tm_isdst = 0;
+  out.offsetSec = (int32_t)difftime(mktime(&lt2), mktime(&gt2));
+  out.isDst = lt.tm_isdst > 0;
+  out.year = (uint16_t)(1900 + lt.tm_year);
+  out.month = (uint8_t)(1 + lt.tm_mon);
+  out.day = (uint8_t)lt.tm_mday;
+  out.minOfDay = (uint16_t)(lt.tm_hour * 60 + lt.tm_min);
+  out.sec = (uint8_t)lt.tm_sec;
+  out.wday = (uint8_t)lt.tm_wday;
+  out.dayNum = daysFromCivil(out.year, out.month, out.day);
+}
+
+void localClockAt(time_t t, LocalClock& out) {
+  out.epoch = (int64_t)t;
+  int64_t tt = (int64_t)t;
+
+  portENTER_CRITICAL(&s_tzMux);
+  bool parsed = s_tz.parsed;
+  TzWindow w = s_cache;
+  portEXIT_CRITICAL(&s_tzMux);
+  if (!parsed) { localClockLibc(t, out); return; }
+
+  if (tt < w.from || tt >= w.until) {
+    portENTER_CRITICAL(&s_tzMux);
+    TzInfo tz = s_tz;
+    uint32_t gen = s_tzGen;
+    portEXIT_CRITICAL(&s_tzMux);
+
+    tzRecompute(tz, tt, w);
+
+    portENTER_CRITICAL(&s_tzMux);
+    if (gen == s_tzGen) s_cache = w;
+    portEXIT_CRITICAL(&s_tzMux);
+  }
+
+  int64_t local = tt + w.off;
+  long days = floorDiv(local, 86400);
+  int32_t secOfDay = (int32_t)(local - (int64_t)days * 86400);
+
+  int y, m, d;
+  civilFromDaysL(days, y, m, d);
+  out.offsetSec = w.off;
+  out.isDst = w.dst;
+  out.year = (uint16_t)y;
+  out.month = (uint8_t)m;
+  out.day = (uint8_t)d;
+  out.minOfDay = (uint16_t)(secOfDay / 60);
+  out.sec = (uint8_t)(secOfDay % 60);
+  out.wday = (uint8_t)(((days % 7) + 11) % 7);
+  out.dayNum = (days < 0) ? 0 : (days > 65535 ? 65535 : (uint16_t)days);
+}
+
+bool localClockNow(LocalClock& out) {
+  if (!timeValid()) return false;
+  localClockAt(time(nullptr), out);
+  return true;
+}
+
 bool getLocalTm(struct tm* out, uint32_t timeoutMs) {
-  return getLocalTime(out, timeoutMs);
+  (void)timeoutMs;   // cached clock: no waiting; false until NTP has set the time
+  LocalClock c;
+  if (!localClockNow(c)) return false;
+  *out = tm{};
+  out->tm_year = c.year - 1900;
+  out->tm_mon = c.month - 1;
+  out->tm_mday = c.day;
+  out->tm_hour = c.minOfDay / 60;
+  out->tm_min = c.minOfDay % 60;
+  out->tm_sec = c.sec;
+  out->tm_wday = c.wday;
+  out->tm_yday = (int)(daysFromCivilL(c.year, c.month, c.day) - daysFromCivilL(c.year, 1, 1));
+  out->tm_isdst = c.isDst ? 1 : 0;
+  return true;
 }
 
 uint16_t minutesSinceMidnight(uint32_t timeoutMs) {
-  struct tm t;
-  if (!getLocalTm(&t, timeoutMs)) return 0;
-  return (uint16_t)(t.tm_hour * 60 + t.tm_min);
+  (void)timeoutMs;
+  LocalClock c;
+  if (!localClockNow(c)) return 0;
+  return c.minOfDay;
+}
+
+bool localDateTime(uint16_t& minOfDay, uint8_t& wday, uint16_t& dayNum, uint32_t timeoutMs) {
+  (void)timeoutMs;
+  LocalClock c;
+  if (!localClockNow(c)) return false;
+  minOfDay = c.minOfDay;
+  wday = c.wday;
+  dayNum = c.dayNum;
+  return true;
 }
 
-static String fmt2(int v) {
-  char b[8];
-  snprintf(b, sizeof(b), "%02d", v);
-  return String(b);
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm).
+uint16_t daysFromCivil(int year, int month, int day) {
+  long days = daysFromCivilL(year, month, day);
+  if (days < 0) days = 0;
+  if (days > 65535) days = 65535;
+  return (uint16_t)days;
 }
+
+static void civilFromDays(uint16_t dayNum, int& year, int& month, int& day) {
+  civilFromDaysL(dayNum, year, month, day);
+}
+
+bool parseDateYmd(const String& s, uint16_t& outDayNum) {
+  int y = 0, m = 0, d = 0;
+  if (sscanf(s.c_str(), "%d-%d-%d", &y, &m, &d) != 3) return false;
+  if (y < 1970 || y > 2149 || m < 1 || m > 12) return false;
+  if (d < 1 || d > daysInMonth(y, m)) return false;   // no 2026-02-30 rolling into March
+  long days = daysFromCivilL(y, m, d);
+  if (days > 65535) return false;                     // past the uint16 day range (2149-06-06)
+  outDayNum = (uint16_t)days;
+  return true;
+}
+
+String fmtDateYmd(uint16_t dayNum) {
+  if (dayNum == 0) return "";
+  int y, m, d;
+  civilFromDays(dayNum, y, m, d);
+  char buf[12];
+  snprintf(buf, sizeof(buf), "%04d-%02d-%02d", y, m, d);
+  return String(buf);
+}
+
 String nowString() {
-  struct tm t;
-  if (!getLocalTm(&t)) return "NTP sync pending";
-  return String(1900 + t.tm_year) + "-" + fmt2(1 + t.tm_mon) + "-" + fmt2(t.tm_mday) +
-         " " + fmt2(t.tm_hour) + ":" + fmt2(t.tm_min) + ":" + fmt2(t.tm_sec);
+  LocalClock c;
+  if (!localClockNow(c)) return "NTP sync pending";
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%04u-%02u-%02u %02u:%02u:%02u", c.year, c.month, c.day,
+           c.minOfDay / 60, c.minOfDay % 60, c.sec);
+  return String(buf);
 }
 
 String fmtTime12(uint16_t minOfDay) {
@@ -38,23 +383,10 @@ String fmtTime12(uint16_t minOfDay) {
   return String(buf);
 }
 
-// Portable TZ offset (seconds) without tm_gmtoff
+// TZ offset (seconds) of the current instant from the cached clock
 int32_t tzOffsetSecondsNowPortable(int* outIsDst /* nullable */) {
-  time_t now = time(nullptr);
-
-  struct tm lt{};
-  struct tm gt{};
-  localtime_r(&now, &lt);
-  gmtime_r(&now, &gt);
-
-  if (outIsDst) *outIsDst = lt.tm_isdst;
-
-  // Convert broken-down structs back to epoch (interpreted as local time)
-  struct tm gt2 = gt;
-  gt2.tm_isdst = 0;
-
-  time_t localEpoch = mktime(&lt);
-  time_t gmEpoch    = mktime(&gt2);
-
-  return (int32_t)difftime(localEpoch, gmEpoch);
+  LocalClock c;
+  localClockAt(time(nullptr), c);
+  if (outIsDst) *outIsDst = c.isDst ? 1 : 0;
+  return c.offsetSec;
 }
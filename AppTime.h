@@ -6,10 +6,36 @@
 bool timeValid();
 String nowString();
 
-// Portable TZ offset (seconds) without tm_gmtoff
+// Cached local clock: the POSIX TZ is parsed once (timeSetTz, call after tzset) and the
+// UTC offset is reused until the next DST transition.
+struct LocalClock {
+  int64_t  epoch;       // UTC seconds
+  int32_t  offsetSec;   // local - UTC
+  bool     isDst;
+  uint16_t year;
+  uint8_t  month;       // 1..12
+  uint8_t  day;         // 1..31
+  uint16_t minOfDay;
+  uint8_t  sec;
+  uint8_t  wday;        // 0 = Sunday
+  uint16_t dayNum;      // days since 1970-01-01
+};
+void timeSetTz(const String& tz);
+void localClockAt(time_t t, LocalClock& out);
+bool localClockNow(LocalClock& out);   // false until time is valid
+
+// TZ offset (seconds) of the current instant (cached; no tm_gmtoff needed)
 int32_t tzOffsetSecondsNowPortable(int* outIsDst = nullptr);
 
-// Local time helpers (used by UI/JSON/scheduler)
+// Local time helpers (used by UI/JSON/scheduler); timeoutMs is kept for callers but the
+// cached clock never waits.
 bool getLocalTm(struct tm* out, uint32_t timeoutMs = 150);
 uint16_t minutesSinceMidnight(uint32_t timeoutMs = 150);
 String fmtTime12(uint16_t minOfDay);
+
+// Local calendar helpers (used by weekly/dated schedules).
+// dayNum = local date as days since 1970-01-01; wday = 0 (Sun) .. 6 (Sat).
+bool localDateTime(uint16_t& minOfDay, uint8_t& wday, uint16_t& dayNum, uint32_t timeoutMs = 150);
+uint16_t daysFromCivil(int year, int month, int day);
+bool parseDateYmd(const String& s, uint16_t& outDayNum);   // "YYYY-MM-DD"
+String fmtDateYmd(uint16_t dayNum);                         // "" for 0
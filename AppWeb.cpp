@@ -2,21 +2,60 @@
 #include "WebUiHtml.h"
 
 // Forward declarations for helpers used before their definitions
-static String buildStateJson();
+static String buildStateJson(bool includeSchedule);
+static void scheduleEdited(SchedActivePolicy policy = SCHED_KEEP_BY_ID);
+static String scheduleItemJson(const ScheduleItem& s);
 static void sendJson(int code, const String& json);
 static bool tryGetMinArg(const char* key, uint16_t& outMin);
+static bool tryGetCalendarArgs(ScheduleItem& it, String& outErr);
+static bool tryGetRampArgs(ScheduleItem& it, String& outErr);
 static String buildScheduleExportJson();
-static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int& outCount, uint16_t& outNextId, String& outErr);
+static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int& outCount, uint16_t& outNextId, String& outErr, bool assignIds = true);
 
 extern WebServer server;
 
+// CRC-32 of the UI page + service worker: the ETag for "/", the worker's cache version and
+// "ui_hash" in /api/state. Computed once; both only change with a firmware update.
+static uint32_t uiHash() {
+  static uint32_t h = 0;
+  if (h == 0) {
+    h = storageCrc32((const uint8_t*)INDEX_HTML, INDEX_HTML_LEN);
+    h = storageCrc32((const uint8_t*)SW_JS, strlen_P(SW_JS), h) | 1;
+  }
+  return h;
+}
+
+static String uiHashHex() {
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%08lx", (unsigned long)uiHash());
+  return String(buf);
+}
+
+// "/" is revalidated on every load (no-cache) but answered with a bodyless 304 while the
+// browser's copy is current.
 void handleRoot() {
-  server.sendHeader("Cache-Control", "no-store");
+  String etag = "\"" + uiHashHex() + "\"";
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
   server.sendHeader("Connection", "close");
+  if (server.header("If-None-Match") == etag) {
+    server.send(304);
+    return;
+  }
   server.send_P(200, "text/html", INDEX_HTML, INDEX_HTML_LEN);
 }
 
-static String jsonEscape(const String& in) {
+// GET /sw.js: the version line makes the script byte-different for every UI build, which
+// is what makes browsers install the new worker (and drop the old shell cache).
+void handleServiceWorker() {
+  String js = "const V=\"" + uiHashHex() + "\";\n";
+  js += FPSTR(SW_JS);
+  server.sendHeader("Cache-Control", "no-cache");
+  server.sendHeader("Connection", "close");
+  server.send(200, "application/javascript", js);
+}
+
+String jsonEscape(const String& in) {
   String out;
   out.reserve(in.length() + 16);
   for (size_t i = 0; i < in.length(); i++) {
@@ -53,56 +92,90 @@ static uint8_t modeToBtn(String s) {
   return BTN_OFF;
 }
 
+// GET /api/state[?rev=N]: the schedule array is omitted when N is the current revision
 void handleState() {
-  sendJson(200, buildStateJson());
+  bool include = true;
+  if (server.hasArg("rev")) include = strtoul(server.arg("rev").c_str(), nullptr, 10) != g_schedRev;
+  sendJson(200, buildStateJson(include));
+}
+
+// BLE work runs on the control task (AppControl.h). {"ok":..} as before when it finishes within
+// CTL_REPLY_WAIT_MS; otherwise 202 + "pending" + "req" (still runs; poll /api/cmd/result?req=),
+// 503 + "busy" when commands are already queued.
+static void sendCtlResult(CtlResult r, uint32_t reqId, const String& extra = String()) {
+  int code = 500;
+  String j = "{\"ok\":";
+  switch (r) {
+    case CTL_OK:      code = 200; j += "true"; break;
+    case CTL_PENDING: code = 202; j += "true,\"pending\":true,\"req\":" + String(reqId); break;
+    case CTL_BUSY:    code = 503; j += "false,\"busy\":true"; break;
+    default:          j += "false"; break;
+  }
+  sendJson(code, j + extra + "}");
+}
+
+static void sendCtlRequest(const CtlCommand& c, const String& extra = String()) {
+  uint32_t reqId = 0;
+  CtlResult r = ctlRequest(c, &reqId);
+  sendCtlResult(r, reqId, extra);
+}
+
+// GET /api/cmd/result?req=N: "pending", "ok", "failed" or "unknown" (too old / never issued)
+void handleCmdResult() {
+  if (!server.hasArg("req")) { server.send(400, "text/plain", "Missing req"); return; }
+  uint32_t reqId = strtoul(server.arg("req").c_str(), nullptr, 10);
+  const char* st = "unknown";
+  switch (ctlResult(reqId)) {
+    case CTL_PENDING: st = "pending"; break;
+    case CTL_OK:      st = "ok"; break;
+    case CTL_FAILED:  st = "failed"; break;
+    default: break;
+  }
+  sendJson(200, "{\"ok\":true,\"req\":" + String(reqId) + ",\"state\":\"" + st + "\"}");
 }
 
 void handleBleConnect() {
-  bool ok = bleEnsureConnected();
-  sendJson(ok ? 200 : 500, String("{\"ok\":") + (ok ? "true" : "false") + "}");
+  CtlCommand c = {};
+  c.op = CTL_OP_CONNECT;
+  sendCtlRequest(c);
 }
 
 void handleBleDisconnect() {
-  bool ok = bleDisconnect();
-  sendJson(ok ? 200 : 500, String("{\"ok\":") + (ok ? "true" : "false") + "}");
+  CtlCommand c = {};
+  c.op = CTL_OP_DISCONNECT;
+  sendCtlRequest(c);
 }
 
 void handleCmdButton() {
   // Quick Controls call this endpoint with optional fan/temp query params.
   // Example: /api/cmd/button?name=HEAT&fan=12&temp=92&runH=8&runM=0
-  uint8_t btn = modeToBtn(server.arg("name"));
+  CtlCommand c = {};
+  c.op = CTL_OP_BUTTON;
+  c.btn = modeToBtn(server.arg("name"));
 
-  bool ok = bleEnsureConnected();
-  if (ok) ok = bedjetButton(btn);
-
-  // If optional temp/fan provided, apply them too (tiny delays help BLE reliability).
-  if (ok && server.hasArg("temp")) {
-    float t = server.arg("temp").toFloat();
-    delay(60);
-    ok = bedjetSetTempF(t);
+  if (server.hasArg("temp")) {
+    c.hasTemp = true;
+    c.tempF = server.arg("temp").toFloat();
   }
-  if (ok && server.hasArg("fan")) {
-    int fan = server.arg("fan").toInt();
-    delay(60);
-    ok = bedjetSetFan((uint8_t)constrain(fan, (int)FAN_MIN, (int)FAN_MAX));
+  if (server.hasArg("fan")) {
+    c.hasFan = true;
+    c.fan = (uint8_t)constrain((int)server.arg("fan").toInt(), (int)FAN_MIN, (int)FAN_MAX);
   }
 
   // Optional run-time (hours/minutes). If either is provided and total > 0, set runtime.
-  if (ok && (server.hasArg("runH") || server.hasArg("runM"))) {
+  if (server.hasArg("runH") || server.hasArg("runM")) {
     int h = server.hasArg("runH") ? server.arg("runH").toInt() : 0;
     int m = server.hasArg("runM") ? server.arg("runM").toInt() : 0;
     h = constrain(h, 0, 11);
     m = constrain(m, 0, 59);
-    uint16_t total = (uint16_t)(h * 60 + m);
-    if (total > 0) {
-      delay(60);
-      ok = bedjetSetRuntimeMinutes(total);
-    }
+    c.runMins = (uint16_t)(h * 60 + m);
   }
 
-  sendJson(ok ? 200 : 500, String("{\"ok\":") + (ok ? "true" : "false") + "}");
+  sendCtlRequest(c);
 }
 
+// add/update/deleteOne reply with the stored item (or deleted id) and the new sched_rev,
+// so the UI can apply the edit locally instead of re-fetching /api/state.
 void handleScheduleAdd() {
   if (g_schedCount >= MAX_SCHEDULE) { server.send(400, "text/plain", "Schedule full"); return; }
 
@@ -125,9 +198,14 @@ void handleScheduleAdd() {
   it.stopMin = stopMin;
   it.enabled = enabled;
 
+  String err;
+  if (!tryGetCalendarArgs(it, err)) { server.send(400, "text/plain", err); return; }
+  it.rampToFan = RAMP_FAN_NONE;
+  if (!tryGetRampArgs(it, err)) { server.send(400, "text/plain", err); return; }
+
   g_sched[g_schedCount++] = it;
-  saveSchedule();
-  sendJson(200, "{\"ok\":true}");
+  scheduleEdited();
+  sendJson(200, "{\"ok\":true,\"sched_rev\":" + String(g_schedRev) + ",\"item\":" + scheduleItemJson(it) + "}");
 }
 
 void handleScheduleUpdate() {
@@ -152,6 +230,18 @@ void handleScheduleUpdate() {
   float temp = server.arg("temp").toFloat();
   bool enabled = server.arg("enabled").toInt() != 0;
 
+  ScheduleItem cal = g_sched[idx];
+  String err;
+  if (!tryGetCalendarArgs(cal, err)) { server.send(400, "text/plain", err); return; }
+  if (!tryGetRampArgs(cal, err)) { server.send(400, "text/plain", err); return; }
+
+  g_sched[idx].daysMask = cal.daysMask;
+  g_sched[idx].fromDay = cal.fromDay;
+  g_sched[idx].toDay = cal.toDay;
+  g_sched[idx].isOverride = cal.isOverride;
+  g_sched[idx].rampToTempF = cal.rampToTempF;
+  g_sched[idx].rampToFan = cal.rampToFan;
+  g_sched[idx].rampMinutes = cal.rampMinutes;
   g_sched[idx].modeButton = btn;
   g_sched[idx].fanStep = (uint8_t)constrain(fan, (int)FAN_MIN, (int)FAN_MAX);
   g_sched[idx].tempF = temp;
@@ -159,8 +249,8 @@ void handleScheduleUpdate() {
   g_sched[idx].stopMin = stopMin;
   g_sched[idx].enabled = enabled;
 
-  saveSchedule();
-  sendJson(200, "{\"ok\":true}");
+  scheduleEdited();
+  sendJson(200, "{\"ok\":true,\"sched_rev\":" + String(g_schedRev) + ",\"item\":" + scheduleItemJson(g_sched[idx]) + "}");
 }
 
 void handleScheduleDeleteOne() {
@@ -178,20 +268,11 @@ void handleScheduleDeleteOne() {
   for (int i = idx; i < g_schedCount - 1; i++) g_sched[i] = g_sched[i + 1];
   g_schedCount--;
 
-  if (g_activeIndex == idx) g_activeIndex = -1;
-  else if (g_activeIndex > idx) g_activeIndex--;
-
-  saveSchedule();
-  sendJson(200, "{\"ok\":true}");
+  scheduleEdited();
+  sendJson(200, "{\"ok\":true,\"sched_rev\":" + String(g_schedRev) + ",\"id\":" + String(id) + "}");
 }
 
 
-static uint16_t scheduleDurationMinutes(uint16_t startMin, uint16_t stopMin) {
-  int d = (int)stopMin - (int)startMin;
-  if (d <= 0) d += 1440;
-  return (uint16_t)d;
-}
-
 // POST /api/schedule/runOne (id=...)
 // Runs the schedule item immediately for its *configured full duration* (start->stop),
 // regardless of enabled/disabled status or global schedule pause.
@@ -205,53 +286,271 @@ void handleScheduleRunOne() {
   }
   if (idx < 0) { server.send(404, "text/plain", "Schedule item not found"); return; }
 
-  const ScheduleItem& it = g_sched[idx];
-  uint16_t runMins = scheduleDurationMinutes(it.startMin, it.stopMin);
-
-  bool ok = false;
-  if (bleEnsureConnected()) {
-    bedjetSetClockNow();
-    delay(40);
-
-    if (it.modeButton == BTN_OFF) {
-      ok = bedjetButton(BTN_OFF);
-    } else {
-      ok = bedjetSetModeSmart(it.modeButton);
-      if (ok) { delay(80); bedjetSetFan(it.fanStep); delay(60); bedjetSetTempF(it.tempF); delay(60); bedjetSetRuntimeMinutes(runMins); }
-    }
-  }
+  CtlCommand c = {};
+  c.op = CTL_OP_RUN_ITEM;
+  c.item = g_sched[idx];
+  c.runMins = schedDurationMinutes(c.item.startMin, c.item.stopMin);
 
-  sendJson(ok ? 200 : 500, String("{\"ok\":") + (ok ? "true" : "false") + String(",\"runMins\":") + String(runMins) + String(",\"id\":") + String(id) + String("}"));
+  sendCtlRequest(c, ",\"runMins\":" + String(c.runMins) + ",\"id\":" + String(id));
 }
 
 void handleScheduleExport() {
   sendJson(200, buildScheduleExportJson());
 }
 
+// Install a rebuilt schedule. Whether the running block survives is up to the policy passed
+// to scheduleEdited() (the scheduler's copy is remapped by id on the control task).
+static void replaceSchedule(const ScheduleItem* items, int count, uint16_t nextId) {
+  for (int i = 0; i < count; i++) g_sched[i] = items[i];
+  g_schedCount = count;
+  g_nextId = nextId;
+}
+
+// POST /api/schedule/import[?mode=merge[&prune=1]]
+// replace (default): the file becomes the schedule.
+// merge: upsert by id (items without an id, or with an unknown one, are added); prune=1 also
+// removes items missing from the file. Unchanged items keep their place and the running
+// block is kept if its record did not change. Nothing is written if nothing changed.
 void handleScheduleImport() {
   String body = server.arg("plain");
   body.trim();
   if (body.length() == 0) { server.send(400, "text/plain", "empty body"); return; }
 
+  bool merge = server.arg("mode") == "merge";
+  bool prune = merge && server.arg("prune").toInt() != 0;
+
   ScheduleItem items[MAX_SCHEDULE];
   int count = 0;
   uint16_t nextId = 1;
   String err;
-  if (!parseScheduleImport(body, items, count, nextId, err)) {
+  if (!parseScheduleImport(body, items, count, nextId, err, !merge)) {
     server.send(400, "text/plain", err.length() ? err : "parse failed");
     return;
   }
 
-  // Replace schedule
+  if (!merge) {
+    replaceSchedule(items, count, nextId);
+    scheduleEdited(SCHED_KEEP_IF_SAME);
+    sendJson(200, String("{\"ok\":true,\"count\":") + String(count) + ",\"sched_rev\":" + String(g_schedRev) + "}");
+    return;
+  }
+
+  ScheduleItem work[MAX_SCHEDULE];
+  bool seen[MAX_SCHEDULE] = {};
+  int n = g_schedCount;
+  for (int i = 0; i < n; i++) work[i] = g_sched[i];
+  uint16_t newNextId = (nextId > g_nextId) ? nextId : g_nextId;
+  int added = 0, changed = 0, removed = 0;
+
+  for (int k = 0; k < count; k++) {
+    ScheduleItem it = items[k];
+    int idx = -1;
+    for (int i = 0; it.id && i < n; i++) {
+      if (work[i].id == it.id) { idx = i; break; }
+    }
+    if (idx >= 0) {
+      if (scheduleItemRev(work[idx]) != scheduleItemRev(it)) { work[idx] = it; changed++; }
+      seen[idx] = true;
+      continue;
+    }
+    if (n >= MAX_SCHEDULE) { server.send(400, "text/plain", "too many items"); return; }
+    if (it.id == 0) it.id = newNextId++;
+    else if (it.id >= newNextId) newNextId = (uint16_t)(it.id + 1);
+    seen[n] = true;
+    work[n++] = it;
+    added++;
+  }
+
+  if (prune) {
+    int w = 0;
+    for (int i = 0; i < n; i++) {
+      if (seen[i]) work[w++] = work[i];
+      else removed++;
+    }
+    n = w;
+  }
+
+  if (added || changed || removed) {
+    replaceSchedule(work, n, newNextId);
+    scheduleEdited(SCHED_KEEP_IF_SAME);
+  }
+
+  String j = "{\"ok\":true,\"mode\":\"merge\"";
+  j += ",\"added\":" + String(added);
+  j += ",\"changed\":" + String(changed);
+  j += ",\"removed\":" + String(removed);
+  j += ",\"unchanged\":" + String(count - added - changed);
+  j += ",\"count\":" + String(n);
+  j += ",\"sched_rev\":" + String(g_schedRev) + "}";
+  sendJson(200, j);
+}
+
+void handleMetrics() {
+  String j = "{";
+  j += "\"uptime_ms\":" + String(millis()) + ",";
+  j += "\"heap_free\":" + String(ESP.getFreeHeap()) + ",";
+  j += "\"sched_transitions\":" + String(g_metrics.sched.transitions) + ",";
+  j += "\"sched_tick_us_last\":" + String(g_metrics.tickUsLast) + ",";
+  j += "\"sched_tick_us_max\":" + String(g_metrics.tickUsMax) + ",";
+  j += "\"sched_saves\":" + String(g_metrics.schedSaves) + ",";
+  j += "\"sched_save_us_last\":" + String(g_metrics.schedSaveUsLast) + ",";
+  j += "\"sched_save_us_max\":" + String(g_metrics.schedSaveUsMax) + ",";
+  j += "\"persist_pending\":" + String(persistPending() ? "true" : "false") + ",";
+  j += "\"persist_flushes\":" + String(g_metrics.persistFlushes) + ",";
+  j += "\"persist_flush_us_last\":" + String(g_metrics.persistFlushUsLast) + ",";
+  j += "\"persist_delay_ms_last\":" + String(g_metrics.persistDelayMsLast) + ",";
+  j += "\"fs_mounted\":" + String(fsMounted() ? "true" : "false") + ",";
+  j += "\"fs_mount_us\":" + String(g_metrics.fsMountUs) + ",";
+  j += "\"fs_index_us\":" + String(g_metrics.fsIndexUs) + ",";
+  j += "\"fs_read_bytes\":" + String(g_metrics.fsReadBytes) + ",";
+  j += "\"fs_read_us\":" + String(g_metrics.fsReadUs) + ",";
+  j += "\"fs_read_kbps\":" + String(g_metrics.fsReadUs ? (uint32_t)((uint64_t)g_metrics.fsReadBytes * 1000000ULL / 1024ULL / g_metrics.fsReadUs) : 0) + ",";
+  j += "\"history_samples\":" + String(historyCount()) + ",";
+  const CtlStats& ctl = ctlStats();
+  j += "\"ctl_commands\":" + String(ctl.commands) + ",";
+  j += "\"ctl_cmd_ms_last\":" + String(ctl.cmdMsLast) + ",";
+  j += "\"ctl_cmd_ms_max\":" + String(ctl.cmdMsMax) + ",";
+  j += "\"ctl_pending\":" + String(ctl.pending) + ",";
+  j += "\"ctl_busy\":" + String(ctl.busy) + ",";
+  j += "\"ctl_stack_free\":" + String(ctl.stackFree) + ",";
+  j += "\"web_loop_us_max\":" + String(g_metrics.webLoopUsMax) + ",";
+  const WifiConnectStats& wc = wifiConnectStats();
+  j += "\"wifi_connect_ms\":" + String(wc.connectMs) + ",";
+  j += "\"wifi_connect_directed\":" + String(wc.directed ? "true" : "false") + ",";
+  j += "\"wifi_connect_fallback\":" + String(wc.fallback ? "true" : "false") + ",";
+  j += "\"wifi_directed_ms\":" + String(wc.directedMs) + ",";
+  j += "\"wifi_lease_same\":" + String(wc.leaseSame ? "true" : "false") + ",";
+  j += "\"wifi_channel\":" + String(wc.channel) + ",";
+  j += "\"wifi_rssi\":" + String(WiFi.isConnected() ? (int)WiFi.RSSI() : 0) + ",";
+  const NtpStats& ntp = ntpStats();
+  j += "\"ntp_server\":\"" + jsonEscape(g_cfg.ntpServer) + "\",";
+  j += "\"ntp_requests\":" + String(ntp.requests) + ",";
+  j += "\"ntp_syncs\":" + String(ntp.syncs) + ",";
+  j += "\"ntp_failures\":" + String(ntp.failures) + ",";
+  j += "\"ntp_steps\":" + String(ntp.steps) + ",";
+  j += "\"ntp_last_offset_ms\":" + String(ntp.lastOffsetMs) + ",";
+  j += "\"ntp_last_rtt_ms\":" + String(ntp.lastRttMs) + ",";
+  j += "\"ntp_best_rtt_ms\":" + String(ntp.bestRttMs) + ",";
+  j += "\"ntp_drift_ppm\":" + String(ntp.driftPpm, 2) + ",";
+  j += "\"ntp_stratum\":" + String(ntp.stratum) + ",";
+  j += "\"ntp_first_sync_ms\":" + String(ntp.firstSyncMs) + ",";
+  j += "\"ntp_last_sync_age_ms\":" + String(ntpSynced() ? millis() - ntp.lastSyncMs : 0) + ",";
+  j += "\"reconcile_checks\":" + String(g_metrics.sched.reconcileChecks) + ",";
+  j += "\"reconcile_noops\":" + String(g_metrics.sched.reconcileNoops) + ",";
+  j += "\"reconcile_writes\":" + String(g_metrics.sched.reconcileWrites) + ",";
+  j += "\"reconcile_reapplies\":" + String(g_metrics.sched.reconcileReapplies);
+  j += "}";
+  sendJson(200, j);
+}
+
+static const char* resetReasonName(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_POWERON:   return "poweron";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    default:                return "other";
+  }
+}
+
+void handleBoot() {
+  String j = "{";
+  j += "\"reset_reason\":\"" + String(resetReasonName(esp_reset_reason())) + "\",";
+  j += "\"time_source\":\"" + String(timeSourceName()) + "\",";
+  j += "\"uptime_ms\":" + String(millis()) + ",";
+  // millis() at each phase; null = not reached (yet)
+  j += "\"phases\":{";
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    uint32_t ms = bootPhaseMs((BootPhase)i);
+    if (i) j += ",";
+    j += "\"" + String(bootPhaseName((BootPhase)i)) + "\":" + (ms ? String(ms) : String("null"));
+  }
+  j += "}}";
+  sendJson(200, j);
+}
+
+// GET /api/profiles
+void handleProfiles() {
+  ProfileInfo list[MAX_PROFILES];
+  int n = profileList(list, MAX_PROFILES);
+
+  String j;
+  j.reserve(64 + n * 64);
+  j += "{\"mounted\":";
+  j += fsMounted() ? "true" : "false";
+  j += ",\"profiles\":[";
+  for (int i = 0; i < n; i++) {
+    if (i) j += ",";
+    j += "{\"id\":" + String(list[i].id);
+    j += ",\"name\":\"" + jsonEscape(list[i].name) + "\"";
+    j += ",\"count\":" + String(list[i].count) + "}";
+  }
+  j += "]}";
+  sendJson(200, j);
+}
+
+// POST /api/profiles/save (name, optional id to overwrite)
+void handleProfileSave() {
+  uint16_t id = server.hasArg("id") ? (uint16_t)server.arg("id").toInt() : 0;
+  uint16_t outId = 0;
+  String err;
+  if (!profileSaveCurrent(id, server.arg("name"), outId, err)) { server.send(400, "text/plain", err); return; }
+  sendJson(200, String("{\"ok\":true,\"id\":") + String(outId) + "}");
+}
+
+// POST /api/profiles/load (id): replaces the current schedule
+void handleProfileLoad() {
+  if (!server.hasArg("id")) { server.send(400, "text/plain", "Missing id"); return; }
+  uint16_t id = (uint16_t)server.arg("id").toInt();
+
+  ScheduleItem items[MAX_SCHEDULE];
+  int count = 0;
+  uint16_t nextId = 1;
+  String err;
+  if (!profileLoad(id, items, count, nextId, err)) { server.send(404, "text/plain", err); return; }
+
   g_schedCount = count;
   for (int i = 0; i < g_schedCount; i++) g_sched[i] = items[i];
-  g_nextId = nextId;
-  g_activeIndex = -1;
+  if (nextId > g_nextId) g_nextId = nextId;
 
-  saveSchedule();
+  scheduleEdited(SCHED_RESET);
   sendJson(200, String("{\"ok\":true,\"count\":") + String(count) + "}");
 }
 
+// POST /api/profiles/delete (id)
+void handleProfileDelete() {
+  if (!server.hasArg("id")) { server.send(400, "text/plain", "Missing id"); return; }
+  if (!profileDelete((uint16_t)server.arg("id").toInt())) { server.send(404, "text/plain", "Not found"); return; }
+  sendJson(200, "{\"ok\":true}");
+}
+
+// GET /api/history?since=<epoch>&limit=<n>
+// Samples: [epoch, mode, fan, targetF, airF]
+void handleHistory() {
+  uint32_t since = server.hasArg("since") ? (uint32_t)strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+  int limit = server.hasArg("limit") ? server.arg("limit").toInt() : 288;
+  if (limit < 1) limit = 1;
+  if (limit > 288) limit = 288;
+
+  static HistorySample buf[288];
+  int n = historyRead(since, buf, limit);
+
+  String j;
+  j.reserve(48 + n * 28);
+  j += "{\"count\":" + String(n) + ",\"samples\":[";
+  for (int i = 0; i < n; i++) {
+    if (i) j += ",";
+    j += "[" + String(buf[i].epoch) + "," + String(buf[i].mode) + "," + String(buf[i].fan) + "," +
+         String(buf[i].targetF) + "," + String(buf[i].airF) + "]";
+  }
+  j += "]}";
+  sendJson(200, j);
+}
+
 void handleSchedulePause() {
   // POST /api/schedule/pause
   // Optional form/query arg: paused=1|0|true|false. If omitted, toggles.
@@ -265,9 +564,10 @@ void handleSchedulePause() {
   }
 
   g_cfg.schedulesPaused = next;
+  ctlPublishConfig();
 
-  // Persist so a reboot doesn't unexpectedly resume schedules.
-  saveConfigToNvs(g_cfg, true);
+  // Persist (write-behind) so a reboot doesn't unexpectedly resume schedules.
+  markConfigFlagsDirty();
 
   sendJson(200, String("{\"ok\":true,\"paused\":") + (g_cfg.schedulesPaused ? "true" : "false") + "}");
 }
@@ -326,10 +626,6 @@ static String statusSummary() {
   return String(buf);
 }
 
-static uint16_t activeScheduleId() {
-  if (g_activeIndex < 0 || g_activeIndex >= g_schedCount) return 0;
-  return g_sched[g_activeIndex].id;
-}
 
 static bool tryGetMinArg(const char* key, uint16_t& outMin) {
   String v = server.arg(key);
@@ -340,7 +636,90 @@ static bool tryGetMinArg(const char* key, uint16_t& outMin) {
   outMin = (uint16_t)n;
   return true;
 }
-static String buildStateJson() {
+
+// Cross-field date checks shared by the form handlers and the batch endpoint
+static bool checkCalendar(ScheduleItem& it, String& outErr) {
+  if (it.fromDay && it.toDay && it.toDay < it.fromDay) { outErr = "To date is before from date"; return false; }
+  if (it.isOverride && it.fromDay == 0) { outErr = "Override needs a from date"; return false; }
+  // A one-off override without an end date covers just its start date.
+  if (it.isOverride && it.toDay == 0) it.toDay = it.fromDay;
+  return true;
+}
+
+// Optional weekly/date args for add/update: days=<mask 1..127>, from=/to=YYYY-MM-DD (blank = no
+// limit), override=0|1. Missing args keep the item's current values (defaults for new items).
+static bool tryGetCalendarArgs(ScheduleItem& it, String& outErr) {
+  if (it.daysMask == 0) it.daysMask = DAYS_ALL;
+
+  if (server.hasArg("days")) {
+    int mask = server.arg("days").toInt();
+    if (mask < 1 || mask > DAYS_ALL) { outErr = "Invalid days"; return false; }
+    it.daysMask = (uint8_t)mask;
+  }
+  if (server.hasArg("from")) {
+    String v = server.arg("from"); v.trim();
+    uint16_t d = 0;
+    if (v.length() && !parseDateYmd(v, d)) { outErr = "Invalid from date"; return false; }
+    it.fromDay = d;
+  }
+  if (server.hasArg("to")) {
+    String v = server.arg("to"); v.trim();
+    uint16_t d = 0;
+    if (v.length() && !parseDateYmd(v, d)) { outErr = "Invalid to date"; return false; }
+    it.toDay = d;
+  }
+  if (server.hasArg("override")) it.isOverride = server.arg("override").toInt() != 0;
+
+  return checkCalendar(it, outErr);
+}
+
+// Optional ramp args for add/update: rampTemp=°F, rampFan=0..19, rampMin=minutes from block
+// start (0/blank = whole block). Blank rampTemp/rampFan disables that part of the ramp.
+static bool tryGetRampArgs(ScheduleItem& it, String& outErr) {
+  if (server.hasArg("rampTemp")) {
+    String v = server.arg("rampTemp"); v.trim();
+    int t = v.length() ? (int)v.toInt() : 0;
+    if (t != 0 && (t < 40 || t > 120)) { outErr = "Invalid rampTemp"; return false; }
+    it.rampToTempF = (uint8_t)t;
+  }
+  if (server.hasArg("rampFan")) {
+    String v = server.arg("rampFan"); v.trim();
+    int f = v.length() ? (int)v.toInt() : -1;
+    if (f > (int)FAN_MAX) { outErr = "Invalid rampFan"; return false; }
+    it.rampToFan = (f < 0) ? RAMP_FAN_NONE : (uint8_t)f;
+  }
+  if (server.hasArg("rampMin")) {
+    int m = server.arg("rampMin").toInt();
+    if (m < 0 || m > 1439) { outErr = "Invalid rampMin"; return false; }
+    it.rampMinutes = (uint16_t)m;
+  }
+  return true;
+}
+static String scheduleItemJson(const ScheduleItem& s) {
+  String j = "{";
+  j += "\"id\":" + String(s.id) + ",";
+  j += "\"rev\":" + String(scheduleItemRev(s)) + ",";
+  j += "\"mode\":\"" + jsonEscape(modeName(s.modeButton)) + "\",";
+  j += "\"tempF\":" + String((int)lroundf(s.tempF)) + ",";
+  j += "\"fan\":" + String(s.fanStep) + ",";
+  j += "\"startMin\":" + String(s.startMin) + ",";
+  j += "\"stopMin\":" + String(s.stopMin) + ",";
+  j += "\"start\":\"" + jsonEscape(fmtTime12(s.startMin)) + "\",";
+  j += "\"stop\":\"" + jsonEscape(fmtTime12(s.stopMin)) + "\",";
+  j += "\"days\":" + String(s.daysMask) + ",";
+  j += "\"from\":\"" + fmtDateYmd(s.fromDay) + "\",";
+  j += "\"to\":\"" + fmtDateYmd(s.toDay) + "\",";
+  j += "\"override\":" + String(s.isOverride ? "true" : "false") + ",";
+  j += "\"rampTempF\":" + String(s.rampToTempF) + ",";
+  j += "\"rampFan\":" + String(s.rampToFan == RAMP_FAN_NONE ? -1 : (int)s.rampToFan) + ",";
+  j += "\"rampMin\":" + String(s.rampMinutes) + ",";
+  j += "\"enabled\":" + String(s.enabled ? "true" : "false");
+  j += "}";
+  return j;
+}
+
+// includeSchedule = false: the caller already has this revision, omit the item list
+static String buildStateJson(bool includeSchedule) {
   String timeStr = nowString();
 
   int isDst = -1;
@@ -351,38 +730,34 @@ static String buildStateJson() {
   j += "\"ip\":\"" + jsonEscape(WiFi.localIP().toString()) + "\",";
   j += "\"time\":\"" + jsonEscape(timeStr) + "\",";
   j += "\"time_valid\":" + String(timeValid() ? "true" : "false") + ",";
+  j += "\"ntp_synced\":" + String(ntpSynced() ? "true" : "false") + ",";
+  j += "\"time_source\":\"" + String(timeSourceName()) + "\",";
+  j += "\"ui_hash\":\"" + uiHashHex() + "\",";
+  if (ntpSynced()) j += "\"ntp_last_sync_age_s\":" + String((millis() - ntpStats().lastSyncMs) / 1000) + ",";
   j += "\"tz\":\"" + jsonEscape(g_cfg.tz) + "\",";
   j += "\"tz_offset_sec\":" + String(tzOff) + ",";
   j += "\"dst\":" + String(isDst) + ",";
   j += "\"device_name\":\"" + jsonEscape(g_cfg.deviceName) + "\",";
   j += "\"device_mac\":\"" + jsonEscape(g_cfg.bedjetMac) + "\",";
-  j += "\"ble_connected\":" + String(bleIsConnected() ? "true" : "false") + ",";
+  j += "\"ble_connected\":" + String(bleLinkUp() ? "true" : "false") + ",";
   j += "\"status_summary\":\"" + jsonEscape(statusSummary()) + "\",";
-  j += "\"active_schedule_id\":" + String(activeScheduleId()) + ",";
+  j += "\"active_schedule_id\":" + String(schedulerActiveId()) + ",";
   j += "\"sched_paused\":" + String(g_cfg.schedulesPaused ? "true" : "false") + ",";
-  j += "\"schedule\":[";
-  for (int i = 0; i < g_schedCount; i++) {
-    if (i) j += ",";
-    const auto& s = g_sched[i];
-    j += "{";
-    j += "\"id\":" + String(s.id) + ",";
-    j += "\"mode\":\"" + jsonEscape(modeName(s.modeButton)) + "\",";
-    j += "\"tempF\":" + String((int)lroundf(s.tempF)) + ",";
-    j += "\"fan\":" + String(s.fanStep) + ",";
-    j += "\"startMin\":" + String(s.startMin) + ",";
-    j += "\"stopMin\":" + String(s.stopMin) + ",";
-    j += "\"start\":\"" + jsonEscape(fmtTime12(s.startMin)) + "\",";
-    j += "\"stop\":\"" + jsonEscape(fmtTime12(s.stopMin)) + "\",";
-    j += "\"enabled\":" + String(s.enabled ? "true" : "false");
-    j += "}";
+  j += "\"sched_rev\":" + String(g_schedRev);
+  if (includeSchedule) {
+    j += ",\"schedule\":[";
+    for (int i = 0; i < g_schedCount; i++) {
+      if (i) j += ",";
+      j += scheduleItemJson(g_sched[i]);
+    }
+    j += "]";
   }
-  j += "]";
   j += "}";
   return j;
 }
 static String buildScheduleExportJson() {
   String j = "{";
-  j += "\"schema\":1,";
+  j += "\"schema\":2,";
   j += "\"exported\":\"" + jsonEscape(nowString()) + "\",";
   j += "\"device_name\":\"" + jsonEscape(g_cfg.deviceName) + "\",";
   j += "\"device_mac\":\"" + jsonEscape(g_cfg.bedjetMac) + "\",";
@@ -398,6 +773,13 @@ static String buildScheduleExportJson() {
     j += "\"fan\":" + String(s.fanStep) + ",";
     j += "\"startMin\":" + String(s.startMin) + ",";
     j += "\"stopMin\":" + String(s.stopMin) + ",";
+    j += "\"days\":" + String(s.daysMask) + ",";
+    j += "\"from\":\"" + fmtDateYmd(s.fromDay) + "\",";
+    j += "\"to\":\"" + fmtDateYmd(s.toDay) + "\",";
+    j += "\"override\":" + String(s.isOverride ? "true" : "false") + ",";
+    j += "\"rampTempF\":" + String(s.rampToTempF) + ",";
+    j += "\"rampFan\":" + String(s.rampToFan == RAMP_FAN_NONE ? -1 : (int)s.rampToFan) + ",";
+    j += "\"rampMin\":" + String(s.rampMinutes) + ",";
     j += "\"enabled\":" + String(s.enabled ? "true" : "false");
     j += "}";
   }
@@ -497,24 +879,15 @@ static bool jsonGetString(const String& obj, const char* key, String& out) {
   return true;
 }
 
-static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int& outCount, uint16_t& outNextId, String& outErr) {
-  outCount = 0;
-  outNextId = 1;
+// Bounds of the array value of "key": a = its '[', b = the matching ']'
+static bool jsonFindArray(const String& body, const char* key, int& a, int& b) {
+  int k = body.indexOf(String("\"") + key + "\"");
+  if (k < 0) return false;
+  a = body.indexOf('[', k);
+  if (a < 0) return false;
 
-  int pNext;
-  int tmp;
-  if (jsonGetInt(body, "nextId", tmp) && tmp > 0 && tmp < 65535) {
-    outNextId = (uint16_t)tmp;
-  }
-
-  int arrKey = body.indexOf("\"schedule\"");
-  if (arrKey < 0) { outErr = "missing schedule"; return false; }
-  int a = body.indexOf('[', arrKey);
-  if (a < 0) { outErr = "missing schedule array"; return false; }
-
-  // Find matching ']'
   int depth = 0;
-  int b = -1;
+  b = -1;
   for (int i = a; i < (int)body.length(); i++) {
     char c = body[i];
     if (c == '[') depth++;
@@ -523,18 +896,17 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
       if (depth == 0) { b = i; break; }
     }
   }
-  if (b < 0) { outErr = "bad schedule array"; return false; }
-
-  int i = a + 1;
-  uint16_t maxId = 0;
+  return b >= 0;
+}
 
+// Next {...} element of an array scanned from i up to b (no nested objects expected).
+// false at the end of the array, or on a malformed object with outErr set.
+static bool jsonNextObject(const String& body, int& i, int b, String& outObj, String& outErr) {
   while (i < b) {
     i = jsonSkipWs(body, i);
     if (i >= b) break;
-    if (body[i] == ',') { i++; continue; }
     if (body[i] != '{') { i++; continue; }
 
-    // extract object substring using brace depth (no nested objects expected)
     int od = 0;
     int j = i;
     for (; j < b; j++) {
@@ -547,9 +919,33 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
     }
     if (od != 0) { outErr = "bad object"; return false; }
 
-    String obj = body.substring(i, j);
+    outObj = body.substring(i, j);
     i = j;
+    return true;
+  }
+  return false;
+}
+
+// assignIds = false leaves items without an id at 0 (merge import allocates them itself)
+static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int& outCount, uint16_t& outNextId, String& outErr, bool assignIds) {
+  outCount = 0;
+  outNextId = 1;
+
+  int pNext;
+  int tmp;
+  if (jsonGetInt(body, "nextId", tmp) && tmp > 0 && tmp < 65535) {
+    outNextId = (uint16_t)tmp;
+  }
+
+  if (body.indexOf("\"schedule\"") < 0) { outErr = "missing schedule"; return false; }
+  int a, b;
+  if (!jsonFindArray(body, "schedule", a, b)) { outErr = "bad schedule array"; return false; }
+
+  int i = a + 1;
+  uint16_t maxId = 0;
+  String obj;
 
+  while (jsonNextObject(body, i, b, obj, outErr)) {
     ScheduleItem it{};
     it.id = 0;
     it.modeButton = BTN_OFF;
@@ -558,6 +954,13 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
     it.startMin = 0;
     it.stopMin = 0;
     it.enabled = true;
+    it.daysMask = DAYS_ALL;   // schema-1 files have no calendar fields
+    it.fromDay = 0;
+    it.toDay = 0;
+    it.isOverride = false;
+    it.rampToTempF = 0;
+    it.rampToFan = RAMP_FAN_NONE;
+    it.rampMinutes = 0;
 
     int idv;
     if (jsonGetInt(obj, "id", idv) && idv > 0 && idv < 65535) it.id = (uint16_t)idv;
@@ -589,7 +992,22 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
     bool en;
     if (jsonGetBool(obj, "enabled", en)) it.enabled = en;
 
-    if (it.id == 0) {
+    int days;
+    if (jsonGetInt(obj, "days", days) && days >= 1 && days <= DAYS_ALL) it.daysMask = (uint8_t)days;
+    String ds;
+    if (jsonGetString(obj, "from", ds) && ds.length() && !parseDateYmd(ds, it.fromDay)) { outErr = "bad from date"; return false; }
+    if (jsonGetString(obj, "to", ds) && ds.length() && !parseDateYmd(ds, it.toDay)) { outErr = "bad to date"; return false; }
+    bool ov;
+    if (jsonGetBool(obj, "override", ov)) it.isOverride = ov;
+    if (it.isOverride && it.fromDay == 0) it.isOverride = false; // undated override = regular item
+    if (it.isOverride && it.toDay == 0) it.toDay = it.fromDay;
+
+    int rv;
+    if (jsonGetInt(obj, "rampTempF", rv) && rv >= 40 && rv <= 120) it.rampToTempF = (uint8_t)rv;
+    if (jsonGetInt(obj, "rampFan", rv) && rv >= (int)FAN_MIN && rv <= (int)FAN_MAX) it.rampToFan = (uint8_t)rv;
+    if (jsonGetInt(obj, "rampMin", rv) && rv >= 0 && rv <= 1439) it.rampMinutes = (uint16_t)rv;
+
+    if (it.id == 0 && assignIds) {
       // allocate stable IDs if missing
       it.id = outNextId++;
     }
@@ -598,6 +1016,7 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
     if (outCount >= MAX_SCHEDULE) { outErr = "too many items"; return false; }
     outItems[outCount++] = it;
   }
+  if (outErr.length()) return false;
 
   // ensure nextId is sane even if caller didn't provide it
   if (outNextId <= maxId) outNextId = (uint16_t)(maxId + 1);
@@ -605,6 +1024,144 @@ static bool parseScheduleImport(const String& body, ScheduleItem* outItems, int&
 
   return true;
 }
+
+// Item fields of a batch op, same ranges as the add/update form (values as JSON
+// numbers/strings/bools). Field names as in the export, with the form's / import's aliases
+// (temp, fanStep, start, stop, rampTemp). Missing fields keep the item's current value.
+static bool parseBatchItemFields(const String& obj, ScheduleItem& it, String& outErr) {
+  String str;
+  int v;
+  float f;
+  bool b;
+
+  if (jsonGetString(obj, "mode", str)) it.modeButton = modeToBtn(str);
+  if (jsonGetInt(obj, "fan", v) || jsonGetInt(obj, "fanStep", v)) it.fanStep = (uint8_t)constrain(v, (int)FAN_MIN, (int)FAN_MAX);
+  if (jsonGetFloat(obj, "tempF", f) || jsonGetFloat(obj, "temp", f)) it.tempF = f;
+  if (jsonGetInt(obj, "startMin", v) || jsonGetInt(obj, "start", v)) {
+    if (v < 0 || v > 1439) { outErr = "Invalid startMin"; return false; }
+    it.startMin = (uint16_t)v;
+  }
+  if (jsonGetInt(obj, "stopMin", v) || jsonGetInt(obj, "stop", v)) {
+    if (v < 0 || v > 1439) { outErr = "Invalid stopMin"; return false; }
+    it.stopMin = (uint16_t)v;
+  }
+  if (it.startMin == it.stopMin) { outErr = "Start and stop cannot be the same"; return false; }
+  if (jsonGetBool(obj, "enabled", b)) it.enabled = b;
+
+  if (jsonGetInt(obj, "days", v)) {
+    if (v < 1 || v > DAYS_ALL) { outErr = "Invalid days"; return false; }
+    it.daysMask = (uint8_t)v;
+  }
+  if (jsonGetString(obj, "from", str)) {
+    uint16_t d = 0;
+    if (str.length() && !parseDateYmd(str, d)) { outErr = "Invalid from date"; return false; }
+    it.fromDay = d;
+  }
+  if (jsonGetString(obj, "to", str)) {
+    uint16_t d = 0;
+    if (str.length() && !parseDateYmd(str, d)) { outErr = "Invalid to date"; return false; }
+    it.toDay = d;
+  }
+  if (jsonGetBool(obj, "override", b)) it.isOverride = b;
+  if (!checkCalendar(it, outErr)) return false;
+
+  if (jsonGetInt(obj, "rampTempF", v) || jsonGetInt(obj, "rampTemp", v)) {
+    if (v != 0 && (v < 40 || v > 120)) { outErr = "Invalid rampTemp"; return false; }
+    it.rampToTempF = (uint8_t)v;
+  }
+  if (jsonGetInt(obj, "rampFan", v)) {
+    if (v > (int)FAN_MAX) { outErr = "Invalid rampFan"; return false; }
+    it.rampToFan = (v < 0) ? RAMP_FAN_NONE : (uint8_t)v;
+  }
+  if (jsonGetInt(obj, "rampMin", v)) {
+    if (v < 0 || v > 1439) { outErr = "Invalid rampMin"; return false; }
+    it.rampMinutes = (uint16_t)v;
+  }
+  return true;
+}
+
+// POST /api/schedule/batch  {"ops":[{"op":"add",...fields}, {"op":"update","id":N,...fields},
+// {"op":"delete","id":N}]}
+// Ops run in order on a copy of the schedule; if any op fails nothing is applied and the
+// reply names it. Otherwise the copy replaces g_sched with one revision bump / one NVS write.
+void handleScheduleBatch() {
+  String body = server.arg("plain");
+  int a, b;
+  if (!jsonFindArray(body, "ops", a, b)) { server.send(400, "text/plain", "missing ops array"); return; }
+
+  ScheduleItem work[MAX_SCHEDULE];
+  int count = g_schedCount;
+  uint16_t nextId = g_nextId;
+  for (int k = 0; k < count; k++) work[k] = g_sched[k];
+
+  String results = "[";
+  String obj, err;
+  int i = a + 1;
+  int n = 0;
+
+  while (jsonNextObject(body, i, b, obj, err)) {
+    String op;
+    int id = 0;
+    jsonGetString(obj, "op", op);
+    jsonGetInt(obj, "id", id);
+
+    int idx = -1;
+    int pos;
+    if (op != "add" && op != "update" && op != "delete") err = "Unknown op";
+    else if (op != "add") {
+      for (int k = 0; k < count; k++) {
+        if (work[k].id == id) { idx = k; break; }
+      }
+      if (idx < 0) err = "Not found";
+    }
+
+    if (!err.length()) {
+      if (op == "add") {
+        if (count >= MAX_SCHEDULE) err = "Schedule full";
+        else if (!jsonFindKey(obj, "startMin", pos) || !jsonFindKey(obj, "stopMin", pos)) err = "Missing startMin/stopMin";
+        else {
+          ScheduleItem it{};
+          it.modeButton = BTN_OFF;
+          it.fanStep = 10;
+          it.tempF = 90;
+          it.enabled = true;
+          it.daysMask = DAYS_ALL;
+          it.rampToFan = RAMP_FAN_NONE;
+          if (parseBatchItemFields(obj, it, err)) {
+            it.id = nextId++;
+            work[count++] = it;
+            results += String(n ? "," : "") + "{\"op\":\"add\",\"id\":" + String(it.id) + ",\"item\":" + scheduleItemJson(it) + "}";
+          }
+        }
+      } else if (op == "update") {
+        ScheduleItem it = work[idx];
+        if (parseBatchItemFields(obj, it, err)) {
+          work[idx] = it;
+          results += String(n ? "," : "") + "{\"op\":\"update\",\"id\":" + String(it.id) + ",\"item\":" + scheduleItemJson(it) + "}";
+        }
+      } else {   // delete
+        for (int k = idx; k < count - 1; k++) work[k] = work[k + 1];
+        count--;
+        results += String(n ? "," : "") + "{\"op\":\"delete\",\"id\":" + String(id) + "}";
+      }
+    }
+
+    if (err.length()) {
+      sendJson(400, "{\"ok\":false,\"failed\":" + String(n) + ",\"error\":\"" + jsonEscape(err) + "\"}");
+      return;
+    }
+    n++;
+  }
+  if (err.length()) { server.send(400, "text/plain", err); return; }
+  if (n == 0) { server.send(400, "text/plain", "no ops"); return; }
+  results += "]";
+
+  // Updates keep the running block (like /update); the next tick ramps/reconciles to them
+  replaceSchedule(work, count, nextId);
+  scheduleEdited();
+  sendJson(200, "{\"ok\":true,\"sched_rev\":" + String(g_schedRev) + ",\"results\":" + results + "}");
+}
+
 void sendAndClose(int code, const char* contentType, const String& body) {
   // NOTE: Arduino WebServer is effectively single-client; browsers that keep a
   // persistent connection open can block other clients (e.g., phone can't load
@@ -615,6 +1172,13 @@ void sendAndClose(int code, const char* contentType, const String& body) {
   server.client().stop();
 }
 
+// Every schedule mutation goes through here: new revision for the UI + deferred NVS write
+static void scheduleEdited(SchedActivePolicy policy) {
+  g_schedRev++;
+  markScheduleDirty();
+  ctlPublishSchedule(policy);
+}
+
 static void sendJson(int code, const String& json) {
   sendAndClose(code, "application/json", json);
 }
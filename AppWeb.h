@@ -5,22 +5,42 @@
 #include "AppTime.h"
 #include "AppBle.h"
 #include "AppStorage.h"
+#include "AppScheduler.h"
+#include "AppControl.h"
+#include "AppFs.h"
+#include "AppNtp.h"
+#include "AppRtc.h"
+#include "AppWifi.h"
+#include "AppBoot.h"
 #include <WebServer.h>
 
 // HTTP handlers (registered in setupWeb in Main.cpp)
 void handleRoot();
+void handleServiceWorker();
 void handleState();
 void handleScheduleExport();
 void handleScheduleImport();
+void handleScheduleBatch();  // ordered add/update/delete ops, applied all-or-nothing
 void handleSchedulePause(); // pause/resume all schedules
 void handleScheduleRunOne(); // run a schedule item immediately for its configured duration
+void handleMetrics();        // counters for reconciler / storage / timing
+void handleBoot();           // boot phase timestamps (AppBoot.h)
+
+// Schedule profiles + status history (LittleFS, see AppFs.h)
+void handleProfiles();
+void handleProfileSave();
+void handleProfileLoad();
+void handleProfileDelete();
+void handleHistory();
 
 void handleBleConnect();
 void handleBleDisconnect();
 void handleCmdButton();
+void handleCmdResult();
 void handleScheduleAdd();
 void handleScheduleUpdate();
 void handleScheduleDeleteOne();
 
 // Shared helper for pages that need to respond and immediately close the connection
 void sendAndClose(int code, const char* contentType, const String& body);
+String jsonEscape(const String& in);
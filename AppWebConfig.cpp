@@ -1,5 +1,6 @@
 #include "AppWebConfig.h"
 #include "AppWeb.h"
+#include "AppWifi.h"
 #include <WiFi.h>
 #include <ESPmDNS.h>
 
@@ -27,23 +28,13 @@ static String htmlEscape(const String& in) {
 }
 
 
-static void sendHtml(int code, const String& html) {
-  sendAndClose(code, "text/html", html);
-}
-
-static String configPageHtml(bool apMode, const String& banner) {
-  // NOTE: Keep JS minimal to avoid breaking the main UI.
-  String action = apMode ? "/save" : "/config/save";
-
-  String ipMode = g_cfg.useDhcp ? "dhcp" : "static";
-
-  String h;
-  h.reserve(4200);
-  h += "<!doctype html><html><head><meta charset='utf-8'/>";
-  h += "<meta name='viewport' content='width=device-width,initial-scale=1'/>";
-  h += "<title>BedJet Schedule ESP32 Setup</title>";
-  h += "<style>";
-  h += R"CSS(
+// Config page template, kept in flash. {{NAME}} placeholders are filled in by
+// configField() while the page is streamed (see sendConfigPage()).
+// NOTE: Keep JS minimal to avoid breaking the main UI.
+static const char CONFIG_PAGE[] PROGMEM = R"CFGHTML(<!doctype html><html><head><meta charset='utf-8'/>
+<meta name='viewport' content='width=device-width,initial-scale=1'/>
+<title>BedJet Schedule ESP32 Setup</title>
+<style>
   :root{
     --bg1:#071a33; --bg2:#053a5a; --card:rgba(255,255,255,.06);
     --border:rgba(255,255,255,.14); --text:#eaf2ff; --muted:rgba(234,242,255,.72);
@@ -127,126 +118,310 @@ static String configPageHtml(bool apMode, const String& banner) {
     border:1px solid rgba(255,195,0,.25);
     margin-bottom:12px;
     font-weight:900;
+    white-space:pre-line;
   }
-)CSS";
-  h += "</style>";
-  h += "</head><body>";
-  String backHref = apMode ? "/" : "/";
-  h += "<div class='wrap'>";
-  h += "<div class='topbar'>";
-  h += String("<a class='btn' href='") + backHref + "'>&larr; Back</a>";
-  h += "<div>";
-  h += "<div class='title'>BedJet ESP32 Setup</div>";
-  h += String("<div class='sub'>") + (apMode ? "Setup access point mode" : "Configure Wi‑Fi and networking") + "</div>";
-  h += "</div>";
-  h += "</div>";
-  h += "<div class='card'>";
-  if (banner.length()) {
-    h += "<div class='banner'>" + banner + "</div>";
-  }
-  if (apMode) {
-    h += "<div class='hint'>You're connected to the setup AP. Enter your Wi‑Fi and BedJet settings, then Save &amp; Reboot.</div>";
-  } else {
-    h += "<div class='hint'>Change settings, then Save &amp; Reboot.</div>";
-  }
-
-  h += "<form method='POST' action='" + action + "'>";
-
-  h += "<label>Wi‑Fi SSID</label>";
-  h += "<input class='field long' name='ssid' type='text' value='" + htmlEscape(g_cfg.wifiSsid) + "' required />";
-
-  h += "<label>Wi‑Fi Password</label>";
-  h += "<input class='field long' name='pass' type='password' value='' placeholder='(leave blank to keep current)' />";
-  h += "<div class='hint'>Leave blank to keep the currently saved password.</div>";
-
-  h += "<label>IP Mode</label>";
-  h += "<select class='field short' name='ipmode' id='ipmode'>";
-  h += String("<option value='dhcp'") + (ipMode == "dhcp" ? " selected" : "") + ">DHCP (dynamic)</option>";
-  h += String("<option value='static'") + (ipMode == "static" ? " selected" : "") + ">Static</option>";
-  h += "</select>";
-
-  h += "<div class='staticFields' id='staticFields'>";
-  h += "<div class='row'>";
-  h += "<div><label>Static IP</label><input class='field' name='ip' type='text' value='" + g_cfg.localIp.toString() + "' /></div>";
-  h += "<div><label>Gateway</label><input class='field' name='gw' type='text' value='" + g_cfg.gateway.toString() + "' /></div>";
-  h += "</div>";
-  h += "<div class='row'>";
-  h += "<div><label>Subnet</label><input class='field' name='sn' type='text' value='" + g_cfg.subnet.toString() + "' /></div>";
-  h += "<div><label>DNS 1</label><input class='field' name='dns1' type='text' value='" + g_cfg.dns1.toString() + "' /></div>";
-  h += "</div>";
-  h += "<div class='row'>";
-  h += "<div><label>DNS 2</label><input class='field' name='dns2' type='text' value='" + g_cfg.dns2.toString() + "' /></div>";
-  h += "<div></div>";
-  h += "</div>";
-  h += "</div>";
-
-  h += "<label>BedJet MAC</label>";
-  h += "<input class='field long' name='mac' type='text' value='" + htmlEscape(g_cfg.bedjetMac) + "' placeholder='AA:BB:CC:DD:EE:FF' />";
-
-  h += "<label>Device Name</label>";
-  h += "<input class='field long' name='name' type='text' value='" + htmlEscape(g_cfg.deviceName) + "' />";
-
-  h += "<label>Hostname (mDNS)</label>";
-  h += "<input class='field short' name='host' type='text' value='" + htmlEscape(g_cfg.hostName) + "' placeholder='BEDJETWEB' />";
-  h += "<div class='hint'>After reboot you can usually open: <b>http://"+ htmlEscape(g_cfg.hostName) +".local/</b> (PC/iOS often work; Android varies). IP always works.</div>";
-  // Time zone
-  String tzNow = g_cfg.tz; tzNow.trim();
-  if (tzNow.length() == 0) tzNow = DEFAULT_TZ;
-  bool tzIsKnown = false;
-  if (tzNow == "EST5EDT,M3.2.0/2,M11.1.0/2") tzIsKnown = true;
-  if (tzNow == "CST6CDT,M3.2.0/2,M11.1.0/2") tzIsKnown = true;
-  if (tzNow == "MST7MDT,M3.2.0/2,M11.1.0/2") tzIsKnown = true;
-  if (tzNow == "PST8PDT,M3.2.0/2,M11.1.0/2") tzIsKnown = true;
-  if (tzNow == "AKST9AKDT,M3.2.0/2,M11.1.0/2") tzIsKnown = true;
-  if (tzNow == "HST10") tzIsKnown = true;
-  if (tzNow == "MST7") tzIsKnown = true;
-  if (tzNow == "UTC0") tzIsKnown = true;
-
-  h += "<label>Time Zone</label>";
-  h += "<select class='field long' name='tzsel' id='tzsel'>";
-  h += String("<option value='EST5EDT,M3.2.0/2,M11.1.0/2'") + ((tzNow == "EST5EDT,M3.2.0/2,M11.1.0/2") ? " selected" : "") + ">US — Eastern (ET)</option>";
-  h += String("<option value='CST6CDT,M3.2.0/2,M11.1.0/2'") + ((tzNow == "CST6CDT,M3.2.0/2,M11.1.0/2") ? " selected" : "") + ">US — Central (CT)</option>";
-  h += String("<option value='MST7MDT,M3.2.0/2,M11.1.0/2'") + ((tzNow == "MST7MDT,M3.2.0/2,M11.1.0/2") ? " selected" : "") + ">US — Mountain (MT)</option>";
-  h += String("<option value='PST8PDT,M3.2.0/2,M11.1.0/2'") + ((tzNow == "PST8PDT,M3.2.0/2,M11.1.0/2") ? " selected" : "") + ">US — Pacific (PT)</option>";
-  h += String("<option value='AKST9AKDT,M3.2.0/2,M11.1.0/2'") + ((tzNow == "AKST9AKDT,M3.2.0/2,M11.1.0/2") ? " selected" : "") + ">US — Alaska (AKT)</option>";
-  h += String("<option value='HST10'") + ((tzNow == "HST10") ? " selected" : "") + ">US — Hawaii (HST)</option>";
-  h += String("<option value='MST7'") + ((tzNow == "MST7") ? " selected" : "") + ">US — Arizona (MST, no DST)</option>";
-  h += String("<option value='UTC0'") + ((tzNow == "UTC0") ? " selected" : "") + ">UTC</option>";
-  h += String("<option value='CUSTOM'") + (!tzIsKnown ? " selected" : "") + ">Custom (POSIX TZ string)</option>";
-  h += "</select>";
-  h += "<div id='tzCustomWrap' style='margin-top:8px;display:none;'>";
-  h += "<label>Custom TZ string</label>";
-  h += "<input class='field long' name='tzcustom' id='tzcustom' type='text' value='" + htmlEscape(tzNow) + "' placeholder='EST5EDT,M3.2.0/2,M11.1.0/2' />";
-  h += "<div class='hint'>Use POSIX TZ format. Example Eastern: <code>EST5EDT,M3.2.0/2,M11.1.0/2</code></div>";
-  h += "</div>";
-
-  h += "<div style='margin-top:14px;display:flex;gap:10px;flex-wrap:wrap;'>";
-  h += "<div class='actions'>";
-  h += "<button class='btn primary' type='submit'>Save &amp; Reboot</button>";
-  h += "</div>";
-
-  h += "<div class='hint'>Tip: hold the ESP32 <b>BOOT</b> button during power‑up to force setup AP mode.</div>";
-
-  h += "</form>";
-
-  // small JS: show/hide static fields; keep it simple and isolated
-  h += "<script>";
-  h += "function upd(){var m=document.getElementById('ipmode').value;var s=document.getElementById('staticFields');if(!s)return; s.style.display=(m==='static')?'block':'none';}";
-  h += "document.getElementById('ipmode').addEventListener('change',upd);upd();";
-  h += "</script>";
-  // small JS: show/hide custom TZ field
-  h += "<script>";
-  h += "function tzupd(){var s=document.getElementById(\"tzsel\");var w=document.getElementById(\"tzCustomWrap\");if(!s||!w) return; w.style.display=(s.value===\"CUSTOM\")?\"block\":\"none\";}";
-  h += "var s=document.getElementById(\"tzsel\"); if(s) s.addEventListener(\"change\",tzupd); tzupd();";
-  h += "</script>";
-
-  h += "<script>";
-  h += "function pushFx(el){if(!el) return; el.classList.add(\"pushed\"); setTimeout(()=>{el.classList.remove(\"pushed\");}, 180);}";
-  h += "document.querySelectorAll(\".btn\").forEach(b=>{ b.addEventListener(\"click\",()=>pushFx(b)); });";
-  h += "</script>";
-
-  h += "</div></div></body></html>";
-  return h;
+  #nets{ margin-top:8px; display:flex; flex-direction:column; gap:6px; }
+  .net{
+    display:flex; justify-content:space-between; gap:10px;
+    padding:8px 12px; border-radius:12px; cursor:pointer;
+    border:1px solid rgba(255,255,255,.10); background:rgba(0,0,0,.14);
+  }
+  .net span{ color:var(--muted); font-size:12.5px; white-space:nowrap; }
+</style>
+</head><body>
+<div class='wrap'>
+<div class='topbar'>
+<a class='btn' href='/'>&larr; Back</a>
+<div>
+<div class='title'>BedJet ESP32 Setup</div>
+<div class='sub'>{{SUBTITLE}}</div>
+</div>
+</div>
+<div class='card'>
+{{BANNER}}<div class='hint'>{{INTRO}}</div>
+<form method='POST' action='{{ACTION}}'>
+
+<label>Wi‑Fi SSID</label>
+<div class='row'>
+<input class='field long' name='ssid' id='ssid' type='text' value='{{SSID}}' list='ssidList' required />
+<button class='btn' type='button' id='scanBtn'>Scan</button>
+</div>
+<datalist id='ssidList'></datalist>
+<div id='nets'></div>
+
+<label>Wi‑Fi Password</label>
+<input class='field long' name='pass' type='password' value='' placeholder='(leave blank to keep current)' />
+<div class='hint'>Leave blank to keep the currently saved password.</div>
+
+<label>IP Mode</label>
+<select class='field short' name='ipmode' id='ipmode'>
+<option value='dhcp'{{DHCP_SEL}}>DHCP (dynamic)</option>
+<option value='static'{{STATIC_SEL}}>Static</option>
+</select>
+
+<div class='staticFields' id='staticFields'>
+<div class='row'>
+<div><label>Static IP</label><input class='field' name='ip' type='text' value='{{IP}}' /></div>
+<div><label>Gateway</label><input class='field' name='gw' type='text' value='{{GW}}' /></div>
+</div>
+<div class='row'>
+<div><label>Subnet</label><input class='field' name='sn' type='text' value='{{SN}}' /></div>
+<div><label>DNS 1</label><input class='field' name='dns1' type='text' value='{{DNS1}}' /></div>
+</div>
+<div class='row'>
+<div><label>DNS 2</label><input class='field' name='dns2' type='text' value='{{DNS2}}' /></div>
+<div></div>
+</div>
+</div>
+
+<label>BedJet MAC</label>
+<input class='field long' name='mac' type='text' value='{{MAC}}' placeholder='AA:BB:CC:DD:EE:FF' />
+
+<label>Device Name</label>
+<input class='field long' name='name' type='text' value='{{NAME}}' />
+
+<label>Hostname (mDNS)</label>
+<input class='field short' name='host' type='text' value='{{HOST}}' placeholder='BEDJETWEB' />
+<div class='hint'>After reboot you can usually open: <b>http://{{HOST}}.local/</b> (PC/iOS often work; Android varies). IP always works.</div>
+
+<label>Time Zone</label>
+<select class='field long' name='tzsel' id='tzsel'>
+{{TZ_OPTIONS}}</select>
+<div id='tzCustomWrap' style='margin-top:8px;display:none;'>
+<label>Custom TZ string</label>
+<input class='field long' name='tzcustom' id='tzcustom' type='text' value='{{TZ}}' placeholder='EST5EDT,M3.2.0/2,M11.1.0/2' />
+<div class='hint'>Use POSIX TZ format. Example Eastern: <code>EST5EDT,M3.2.0/2,M11.1.0/2</code></div>
+</div>
+
+<label>NTP server</label>
+<input class='field long' name='ntp' type='text' value='{{NTP}}' placeholder='pool.ntp.org' />
+<div class='hint'>Host name or IP. A local server (e.g. your router) gives the fastest first sync after boot.</div>
+
+<label>Ramp step (minutes)</label>
+<input class='field short' name='rampstep' type='number' min='1' max='60' value='{{RAMPSTEP}}' />
+<div class='hint'>Minimum time between temperature/fan changes while a schedule ramp is running.</div>
+
+<div class='row'>
+<div><label>Re-check every (s)</label><input class='field short' name='recsec' type='number' min='0' max='3600' value='{{RECSEC}}' /></div>
+<div><label>Temp tolerance (&deg;F)</label><input class='field short' name='rectol' type='number' min='0' max='10' value='{{RECTOL}}' /></div>
+<div><label>Confirm checks</label><input class='field short' name='rechyst' type='number' min='1' max='10' value='{{RECHYST}}' /></div>
+</div>
+<div class='hint'>While a schedule block is active, the BedJet status is compared to the block and only the differing settings are re-sent (after the drift is seen on the given number of consecutive checks). 0 seconds disables it.</div>
+
+<div style='margin-top:14px;display:flex;gap:10px;flex-wrap:wrap;'>
+<div class='actions'>
+<button class='btn primary' type='submit' id='saveBtn'>{{SAVE_LABEL}}</button>
+</div>
+<div class='hint' id='testMsg'></div>
+
+<div class='hint'>Tip: hold the ESP32 <b>BOOT</b> button during power‑up to force setup AP mode.</div>
+
+</form>
+<script>
+function upd(){var m=document.getElementById('ipmode').value;var s=document.getElementById('staticFields');if(!s)return; s.style.display=(m==='static')?'block':'none';}
+document.getElementById('ipmode').addEventListener('change',upd);upd();
+</script>
+<script>
+function tzupd(){var s=document.getElementById("tzsel");var w=document.getElementById("tzCustomWrap");if(!s||!w) return; w.style.display=(s.value==="CUSTOM")?"block":"none";}
+var s=document.getElementById("tzsel"); if(s) s.addEventListener("change",tzupd); tzupd();
+</script>
+<script>
+// Network scan (/api/wifi/scan runs in the background; poll until it is done)
+var AP={{AP_MODE}};
+function esc(t){return String(t).replace(/[&<>"']/g,function(c){return '&#'+c.charCodeAt(0)+';';});}
+function showNets(j){
+  var box=document.getElementById('nets'), dl=document.getElementById('ssidList');
+  var nets=j.networks||[];
+  dl.innerHTML=nets.map(function(n){return "<option value='"+esc(n.ssid)+"'>";}).join('');
+  box.innerHTML=nets.map(function(n){
+    return "<div class='net' data-ssid='"+esc(n.ssid)+"'><b>"+esc(n.ssid)+"</b><span>"+n.rssi+" dBm &middot; ch "+n.ch+(n.secure?" &middot; &#128274;":"")+"</span></div>";
+  }).join('') || "<div class='hint'>No networks found.</div>";
+  box.querySelectorAll('.net').forEach(function(el){ el.addEventListener('click',function(){ document.getElementById('ssid').value=el.getAttribute('data-ssid'); }); });
+}
+function scan(force){
+  var b=document.getElementById('scanBtn'); b.disabled=true; b.textContent='Scanning...';
+  (function poll(first){
+    fetch('/api/wifi/scan'+(first&&force?'?refresh=1':''),{cache:'no-store'}).then(function(r){return r.json();}).then(function(j){
+      if(j.state==='running'){ setTimeout(function(){poll(false);},700); return; }
+      showNets(j); b.disabled=false; b.textContent='Scan';
+    }).catch(function(){ b.disabled=false; b.textContent='Scan'; });
+  })(true);
+}
+document.getElementById('scanBtn').addEventListener('click',function(){scan(true);});
+if(AP) scan(false);
+
+// Setup AP: test the credentials first (the portal keeps running), save only once connected.
+// The setup network follows the tested network's channel, so the phone may drop off it;
+// the result is kept on the device and polled again once the phone is back.
+var TEST_GIVEUP_MS=180000;
+function testPoll(f,btn,msg,apName){
+  var lostAt=0;
+  (function poll(){
+    fetch('/api/wifi/test',{cache:'no-store'}).then(function(r){return r.json();}).then(function(j){
+      lostAt=0;
+      if(j.state==='running'){ msg.textContent='Testing connection... '+(j.elapsed_ms/1000).toFixed(1)+' s ('+j.detail+')'; setTimeout(poll,500); return; }
+      if(j.state==='done'){ msg.textContent='Connected (IP '+j.ip+'). Saving...'; f.submit(); return; }
+      msg.textContent='Connection failed: '+j.detail+'. Check the SSID / password and try again.'; btn.disabled=false;
+    }).catch(function(){
+      var now=Date.now(); if(!lostAt) lostAt=now;
+      if(now-lostAt>TEST_GIVEUP_MS){ msg.textContent='Still cannot reach the device. Reconnect to '+apName+', reload this page and try again.'; btn.disabled=false; return; }
+      msg.textContent='Lost the setup network. Reconnect this phone / computer to '+apName+' (keep this page open); the test result will show up here.';
+      setTimeout(poll,1000);
+    });
+  })();
+}
+if(AP) document.querySelector('form').addEventListener('submit',function(e){
+  e.preventDefault();
+  var f=this, btn=document.getElementById('saveBtn'), msg=document.getElementById('testMsg');
+  btn.disabled=true; msg.textContent='Testing connection...';
+  fetch('/api/wifi/test',{method:'POST',body:new URLSearchParams(new FormData(f))}).then(function(r){
+    if(!r.ok) return r.text().then(function(t){throw new Error(t);});
+    return r.json().then(function(j){
+      var apName=j.ap_ssid||'the setup network';
+      if(!j.target_ch || j.target_ch!==j.ap_ch)
+        msg.textContent='Testing connection... '+apName+' moves to '+(j.target_ch?'channel '+j.target_ch:'the new network\'s channel')+' for the test and this phone may drop off it. If it does, reconnect to '+apName+'.';
+      setTimeout(function(){testPoll(f,btn,msg,apName);},1500);
+    });
+  }).catch(function(err){ msg.textContent='Test failed: '+err.message; btn.disabled=false; });
+});
+// After a drop the browser may have reloaded this page: show how the last test went
+if(AP) fetch('/api/wifi/test',{cache:'no-store'}).then(function(r){return r.json();}).then(function(j){
+  var msg=document.getElementById('testMsg');
+  if(j.state==='done') msg.textContent='The last test connected to '+j.ssid+' (IP '+j.ip+'). Enter the same password and press Test, Save & Reboot again.';
+  else if(j.state==='failed') msg.textContent='The last test of '+j.ssid+' failed: '+j.detail+'.';
+  else if(j.state==='running') msg.textContent='A test of '+j.ssid+' is still running...';
+}).catch(function(){});
+</script>
+<script>
+function pushFx(el){if(!el) return; el.classList.add("pushed"); setTimeout(()=>{el.classList.remove("pushed");}, 180);}
+document.querySelectorAll(".btn").forEach(b=>{ b.addEventListener("click",()=>pushFx(b)); });
+</script>
+</div></div></body></html>
+)CFGHTML";
+
+struct TzChoice { const char* tz; const char* label; };
+static const TzChoice TZ_CHOICES[] = {
+  {"EST5EDT,M3.2.0/2,M11.1.0/2",   "US — Eastern (ET)"},
+  {"CST6CDT,M3.2.0/2,M11.1.0/2",   "US — Central (CT)"},
+  {"MST7MDT,M3.2.0/2,M11.1.0/2",   "US — Mountain (MT)"},
+  {"PST8PDT,M3.2.0/2,M11.1.0/2",   "US — Pacific (PT)"},
+  {"AKST9AKDT,M3.2.0/2,M11.1.0/2", "US — Alaska (AKT)"},
+  {"HST10",                        "US — Hawaii (HST)"},
+  {"MST7",                         "US — Arizona (MST, no DST)"},
+  {"UTC0",                         "UTC"},
+};
+
+// Small output buffer so the page goes out in ~512-byte chunks instead of one chunk per
+// template piece; this (plus one field value at a time) is all the RAM rendering needs.
+struct ChunkOut {
+  char buf[512];
+  size_t n = 0;
+
+  void flush() {
+    if (n) server.sendContent(buf, n);
+    n = 0;
+  }
+  void write(const char* p, size_t len) {
+    while (len) {
+      size_t k = sizeof(buf) - n;
+      if (k > len) k = len;
+      memcpy_P(buf + n, p, k);
+      n += k; p += k; len -= k;
+      if (n == sizeof(buf)) flush();
+    }
+  }
+  void write(const char* s) { write(s, strlen(s)); }
+  void write(const String& v) { write(v.c_str(), v.length()); }
+};
+
+static String configTz() {
+  String tz = g_cfg.tz;
+  tz.trim();
+  if (tz.length() == 0) tz = DEFAULT_TZ;
+  return tz;
+}
+
+// Value of one placeholder. User-controlled values are always htmlEscape'd.
+static void configField(ChunkOut& out, const String& key, bool apMode, const String& banner) {
+  if (key == "SUBTITLE") out.write(apMode ? "Setup access point mode" : "Configure Wi‑Fi and networking");
+  else if (key == "BANNER") {
+    if (banner.length()) out.write("<div class='banner'>" + htmlEscape(banner) + "</div>");
+  }
+  else if (key == "INTRO") {
+    out.write(apMode ? "You're connected to the setup AP. Enter your Wi‑Fi and BedJet settings, then Save &amp; Reboot."
+                     : "Change settings, then Save. Only Wi‑Fi / IP changes reboot the device.");
+  }
+  else if (key == "ACTION") out.write(apMode ? "/save" : "/config/save");
+  else if (key == "AP_MODE") out.write(apMode ? "true" : "false");
+  else if (key == "SAVE_LABEL") out.write(apMode ? "Test, Save &amp; Reboot" : "Save");
+  else if (key == "SSID") out.write(htmlEscape(g_cfg.wifiSsid));
+  else if (key == "DHCP_SEL") { if (g_cfg.useDhcp) out.write(" selected"); }
+  else if (key == "STATIC_SEL") { if (!g_cfg.useDhcp) out.write(" selected"); }
+  else if (key == "IP") out.write(g_cfg.localIp.toString());
+  else if (key == "GW") out.write(g_cfg.gateway.toString());
+  else if (key == "SN") out.write(g_cfg.subnet.toString());
+  else if (key == "DNS1") out.write(g_cfg.dns1.toString());
+  else if (key == "DNS2") out.write(g_cfg.dns2.toString());
+  else if (key == "MAC") out.write(htmlEscape(g_cfg.bedjetMac));
+  else if (key == "NAME") out.write(htmlEscape(g_cfg.deviceName));
+  else if (key == "HOST") out.write(htmlEscape(g_cfg.hostName));
+  else if (key == "TZ") out.write(htmlEscape(configTz()));
+  else if (key == "TZ_OPTIONS") {
+    String tz = configTz();
+    bool known = false;
+    for (const TzChoice& c : TZ_CHOICES) {
+      bool sel = tz == c.tz;
+      known = known || sel;
+      out.write(String("<option value='") + c.tz + "'" + (sel ? " selected" : "") + ">" + c.label + "</option>\n");
+    }
+    out.write(String("<option value='CUSTOM'") + (known ? "" : " selected") + ">Custom (POSIX TZ string)</option>\n");
+  }
+  else if (key == "NTP") out.write(htmlEscape(g_cfg.ntpServer));
+  else if (key == "RAMPSTEP") out.write(String(g_cfg.rampStepMin));
+  else if (key == "RECSEC") out.write(String(g_cfg.reconcileSec));
+  else if (key == "RECTOL") out.write(String(g_cfg.reconcileTolF));
+  else if (key == "RECHYST") out.write(String(g_cfg.reconcileHyst));
+}
+
+// Stream CONFIG_PAGE with chunked transfer encoding: no full-page String, so heap use does
+// not grow with the page (matters in AP mode, where heap is tight).
+static void sendConfigPage(int code, bool apMode, const String& banner) {
+  server.sendHeader("Cache-Control", "no-store");
+  server.sendHeader("Connection", "close");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, "text/html", "");
+
+  ChunkOut out;
+  const char* p = CONFIG_PAGE;
+  const char* end = CONFIG_PAGE + strlen_P(CONFIG_PAGE);
+  while (p < end) {
+    const char* open = strstr_P(p, "{{");
+    if (!open) { out.write(p, end - p); break; }
+    out.write(p, open - p);
+    const char* close = strstr_P(open + 2, "}}");
+    if (!close) break;   // malformed template: stop rather than emit a broken field
+
+    char key[24];
+    size_t klen = close - (open + 2);
+    if (klen >= sizeof(key)) klen = sizeof(key) - 1;
+    memcpy_P(key, open + 2, klen);
+    key[klen] = 0;
+    configField(out, String(key), apMode, banner);
+    p = close + 2;
+  }
+  out.flush();
+  server.sendContent("");   // terminating chunk
+  server.client().stop();
+}
+
+static bool isNtpHostSane(const String& h) {
+  if (h.length() == 0 || h.length() > 63) return false;
+  for (size_t i = 0; i < h.length(); i++) {
+    char c = h[i];
+    bool ok = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+    if (!ok) return false;
+  }
+  return true;
 }
 
 static bool isTzSane(const String& tz) {
@@ -259,7 +434,20 @@ static bool isTzSane(const String& tz) {
   return true;
 }
 
-static bool applyConfigFromRequest(RuntimeConfig& outCfg) {
+// Form fields stored as strings in the config record (see CFG_STR_MAX)
+static const char* const CFG_STR_ARGS[] = { "ssid", "pass", "mac", "name", "host", "tzsel", "tzcustom", "ntp" };
+
+// err is set for problems worth naming; otherwise callers show the generic message.
+static bool applyConfigFromRequest(RuntimeConfig& outCfg, String& err) {
+  err = "";
+  for (const char* a : CFG_STR_ARGS) {
+    String v = server.arg(a); v.trim();
+    if (v.length() > CFG_STR_MAX) {
+      err = String("Field '") + a + "' is too long (max " + String((unsigned)CFG_STR_MAX) + " characters).";
+      return false;
+    }
+  }
+
   RuntimeConfig c = g_cfg;
 
   String ssid = server.arg("ssid"); ssid.trim();
@@ -319,58 +507,101 @@ static bool applyConfigFromRequest(RuntimeConfig& outCfg) {
     c.tz = tz;
   }
 
+  if (server.hasArg("ntp")) {
+    String ntp = server.arg("ntp"); ntp.trim();
+    if (ntp.length() == 0) ntp = DEFAULT_NTP_SERVER;
+    if (!isNtpHostSane(ntp)) return false;
+    c.ntpServer = ntp;
+  }
 
-
-  outCfg = c;
-  return true;
-}
-
-static String tryWifiAndGetIp(const RuntimeConfig& c, bool& ok) {
-  ok = false;
-
-  WiFi.disconnect(true, true);
-  delay(200);
-
-  WiFi.mode(WIFI_STA);
-  WiFi.setSleep(false);
-
-  if (!c.useDhcp) {
-    WiFi.config(c.localIp, c.gateway, c.subnet, c.dns1, c.dns2);
+  String rampStep = server.arg("rampstep"); rampStep.trim();
+  if (rampStep.length()) {
+    int v = rampStep.toInt();
+    if (v < 1 || v > 60) return false;
+    c.rampStepMin = (uint8_t)v;
   }
 
-  WiFi.begin(c.wifiSsid.c_str(), (c.wifiPass.length() ? c.wifiPass.c_str() : g_cfg.wifiPass.c_str()));
+  String recSec = server.arg("recsec"); recSec.trim();
+  if (recSec.length()) {
+    int v = recSec.toInt();
+    if (v < 0 || v > 3600) return false;
+    c.reconcileSec = (uint16_t)v;
+  }
+  String recTol = server.arg("rectol"); recTol.trim();
+  if (recTol.length()) {
+    int v = recTol.toInt();
+    if (v < 0 || v > 10) return false;
+    c.reconcileTolF = (uint8_t)v;
+  }
+  String recHyst = server.arg("rechyst"); recHyst.trim();
+  if (recHyst.length()) {
+    int v = recHyst.toInt();
+    if (v < 1 || v > 10) return false;
+    c.reconcileHyst = (uint8_t)v;
+  }
 
-  uint32_t start = millis();
-  while (!WiFi.isConnected() && millis() - start < 9000) delay(250);
 
-  if (!WiFi.isConnected()) return String("");
 
-  ok = true;
-  return WiFi.localIP().toString();
+  outCfg = c;
+  return true;
 }
 
 static void handleConfigGet(bool apMode) {
-  sendHtml(200, configPageHtml(apMode, ""));
+  sendConfigPage(200, apMode, "");
 }
 
 
 static void handleConfigSave(bool apMode) {
   RuntimeConfig newCfg;
-  if (!applyConfigFromRequest(newCfg)) {
-    sendHtml(400, configPageHtml(apMode, "Invalid input. Please check SSID / IP fields / MAC format."));
+  String err;
+  if (!applyConfigFromRequest(newCfg, err)) {
+    sendConfigPage(400, apMode, err.length() ? err : String("Invalid input. Please check SSID / IP fields / MAC format."));
+    return;
+  }
+
+  // Setup AP: only save credentials that were just seen to work (see /api/wifi/test)
+  if (apMode && !wifiTestVerified(newCfg)) {
+    sendConfigPage(400, apMode, "Test the Wi‑Fi connection before saving (Test, Save & Reboot).");
     return;
   }
 
+  uint8_t changes = configChanges(g_cfg, newCfg);
+
   // Persist config (keep existing password if blank)
-  saveConfigToNvs(newCfg, true);
+  if (!saveConfigToNvs(newCfg, true)) {
+    sendConfigPage(500, apMode, "Could not save the configuration (NVS write failed).");
+    return;
+  }
 
   // Update runtime copy
   if (newCfg.wifiPass.length() == 0) newCfg.wifiPass = g_cfg.wifiPass;
   g_cfg = newCfg;
+  ctlPublishConfig();   // BedJet MAC + schedule tuning for the control task
 
   String msg;
   msg.reserve(256);
   msg += "Saved configuration.\n";
+
+  // Normal mode: apply what does not touch the network in place (see ConfigApply)
+  if (!apMode && !(changes & CFG_APPLY_RESTART)) {
+    if (changes & CFG_APPLY_TZ) setupTimeZone();
+    if (changes & CFG_APPLY_NTP) ntpBegin(g_cfg.ntpServer);
+    if (changes & CFG_APPLY_MDNS) setupMdns();
+    Serial.printf("[CFG] applied without restart (changes=0x%02X)\n", (unsigned)changes);
+
+    if (changes & CFG_APPLY_TZ) msg += "Time zone applied.\n";
+    if (changes & CFG_APPLY_NTP) msg += "Syncing time with the new NTP server.\n";
+    if (changes & CFG_APPLY_MDNS) {
+      String host = normalizeHost(g_cfg.hostName);
+      host.toLowerCase();
+      msg += "Now reachable at http://" + host + ".local/ (the router's DHCP name updates after the next reboot).\n";
+    }
+    if (changes & CFG_APPLY_BLE) msg += "BedJet MAC changed; the next command connects to the new BedJet.\n";
+    msg += "No restart needed.";
+    sendConfigPage(200, apMode, msg);
+    return;
+  }
+
   if (!g_cfg.useDhcp) {
     msg += "After reboot, browse: http://" + g_cfg.localIp.toString() + "/\n";
   } else {
@@ -381,15 +612,86 @@ static void handleConfigSave(bool apMode) {
   msg += "Rebooting...";
 
   // IMPORTANT: Do not disrupt Wi‑Fi before responding (or the browser will hang).
-  sendHtml(200, configPageHtml(apMode, msg));
+  sendConfigPage(200, apMode, msg);
   scheduleRestart(apMode ? 4500 : 1500);
 }
+// GET /api/wifi/scan[?refresh=1]: cached results, a new background scan when stale/forced
+static void handleWifiScan() {
+  wifiScanStart(server.arg("refresh") == "1");
+
+  const WifiNetwork* nets;
+  int n = wifiScanResults(nets);
+  WifiJobState st = wifiScanState();
+
+  String j = "{\"state\":\"";
+  j += (st == WIFI_JOB_RUNNING) ? "running" : (st == WIFI_JOB_FAILED) ? "failed" : "done";
+  j += "\",\"age_ms\":" + String(wifiScanAgeMs()) + ",\"networks\":[";
+  for (int i = 0; i < n; i++) {
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
+             nets[i].bssid[0], nets[i].bssid[1], nets[i].bssid[2], nets[i].bssid[3], nets[i].bssid[4], nets[i].bssid[5]);
+    if (i) j += ",";
+    j += "{\"ssid\":\"" + jsonEscape(nets[i].ssid) + "\"";
+    j += ",\"rssi\":" + String(nets[i].rssi);
+    j += ",\"ch\":" + String(nets[i].channel);
+    j += ",\"secure\":" + String(nets[i].secure ? "true" : "false");
+    j += ",\"bssid\":\"" + String(bssid) + "\"}";
+  }
+  j += "]}";
+  sendAndClose(200, "application/json", j);
+}
+
+static char s_apSsid[32];   // setup AP name, set by startConfigPortal()
+
+// POST /api/wifi/test (same fields as the config form): start a background connect
+static void handleWifiTestStart() {
+  RuntimeConfig c;
+  String err;
+  if (!applyConfigFromRequest(c, err)) {
+    sendAndClose(400, "text/plain", err.length() ? err : String("Invalid input. Please check SSID / IP fields / MAC format."));
+    return;
+  }
+  // One radio: while the station joins, the soft-AP moves to the target network's channel
+  // and phones on the setup network often drop. Report both so the page can warn.
+  int apCh = WiFi.channel();
+  int targetCh = 0;   // unknown (not in the last scan)
+  const WifiNetwork* nets;
+  int n = wifiScanResults(nets);
+  for (int i = 0; i < n; i++) {
+    if (c.wifiSsid == nets[i].ssid) { targetCh = nets[i].channel; break; }
+  }
+  wifiTestStart(c);
+
+  String j = "{\"ok\":true,\"state\":\"running\"";
+  j += ",\"ap_ssid\":\"" + jsonEscape(s_apSsid) + "\"";
+  j += ",\"ap_ch\":" + String(apCh) + ",\"target_ch\":" + String(targetCh) + "}";
+  sendAndClose(200, "application/json", j);
+}
+
+// GET /api/wifi/test: progress of the last test
+static void handleWifiTestStatus() {
+  WifiJobState st = wifiTestState();
+  String j = "{\"state\":\"";
+  j += (st == WIFI_JOB_RUNNING) ? "running" : (st == WIFI_JOB_DONE) ? "done" : (st == WIFI_JOB_FAILED) ? "failed" : "idle";
+  j += "\",\"elapsed_ms\":" + String(wifiTestElapsedMs());
+  j += ",\"detail\":\"" + String(wifiTestDetail()) + "\"";
+  j += ",\"ssid\":\"" + jsonEscape(wifiTestSsid()) + "\"";
+  if (st == WIFI_JOB_DONE) j += ",\"ip\":\"" + wifiTestIp().toString() + "\"";
+  j += "}";
+  sendAndClose(200, "application/json", j);
+}
+
 void scheduleRestart(uint32_t delayMs) {
+  // Called after the response is sent; write anything still pending before the reboot window.
+  persistFlush();
   g_pendingRestartAtMs = millis() + delayMs;
 }
 void setupWebConfigPortal() {
   server.on("/", HTTP_GET, [](){ handleConfigGet(true); });
   server.on("/save", HTTP_POST, [](){ handleConfigSave(true); });
+  server.on("/api/wifi/scan", HTTP_GET, handleWifiScan);
+  server.on("/api/wifi/test", HTTP_POST, handleWifiTestStart);
+  server.on("/api/wifi/test", HTTP_GET, handleWifiTestStatus);
 
   // Captive portal: redirect everything to /
   server.onNotFound([](){
@@ -404,23 +706,27 @@ void setupWebConfigPortal() {
 void setupWebNormalConfigPage() {
   server.on("/config", HTTP_GET, [](){ handleConfigGet(false); });
   server.on("/config/save", HTTP_POST, [](){ handleConfigSave(false); });
+  server.on("/api/wifi/scan", HTTP_GET, handleWifiScan);
 }
+// Also the fallback when the saved network cannot be joined; the control task (BLE +
+// scheduler) may already be running then and is left running (see setup()).
 void startConfigPortal() {
   g_configMode = true;
 
-  WiFi.mode(WIFI_AP);
+  // AP + station: the station side scans and test-connects while the portal stays up
+  WiFi.mode(WIFI_AP_STA);
   uint32_t chip = (uint32_t)(ESP.getEfuseMac() & 0xFFFF);
-  char ssid[32];
-  snprintf(ssid, sizeof(ssid), "BedJetSetup-%04X", (unsigned int)chip);
+  snprintf(s_apSsid, sizeof(s_apSsid), "BedJetSetup-%04X", (unsigned int)chip);
 
   // Open AP (no password) to simplify first boot
-  WiFi.softAP(ssid);
+  WiFi.softAP(s_apSsid);
 
   IPAddress apIp = WiFi.softAPIP();
   g_dns.start(53, "*", apIp);
 
   setupWebConfigPortal();
+  wifiScanStart(true);   // results are usually ready by the time the page asks
 
-  Serial.printf("[CFG] Setup AP started. SSID=%s  IP=%s\n", ssid, apIp.toString().c_str());
+  Serial.printf("[CFG] Setup AP started. SSID=%s  IP=%s\n", s_apSsid, apIp.toString().c_str());
   Serial.printf("[CFG] Open http://%s/ in a browser\n", apIp.toString().c_str());
 }
\ No newline at end of file
@@ -12,3 +12,7 @@ void startConfigPortal();
 void setupWebConfigPortal();
 void setupWebNormalConfigPage();
 void scheduleRestart(uint32_t delayMs = 1500);
+
+// Main.cpp; re-run by a config save so these changes apply without a restart
+void setupTimeZone();
+void setupMdns();
@@ -0,0 +1,310 @@
+#include "AppWifi.h"
+#include "AppStorage.h"   // storageCrc32, g_nvsMutex
+#include <WiFi.h>
+#include <Preferences.h>
+
+static WifiNetwork  s_nets[WIFI_SCAN_MAX];
+static int          s_netCount = 0;
+static WifiJobState s_scanState = WIFI_JOB_IDLE;
+static uint32_t     s_scanDoneMs = 0;
+
+static WifiJobState s_testState = WIFI_JOB_IDLE;
+static uint32_t     s_testStartMs = 0;
+static uint32_t     s_testEndMs = 0;
+static const char*  s_testDetail = "idle";
+static IPAddress    s_testIp;
+static RuntimeConfig s_testCfg;
+
+// ---------------------------------------------------------------------------
+// Scan
+// ---------------------------------------------------------------------------
+void wifiScanStart(bool force) {
+  if (s_scanState == WIFI_JOB_RUNNING) return;
+  if (!force && s_scanState == WIFI_JOB_DONE && millis() - s_scanDoneMs < WIFI_SCAN_MAX_AGE_MS) return;
+  // A station connect in progress owns the radio; scanning now would stall it.
+  if (s_testState == WIFI_JOB_RUNNING) return;
+
+  int r = WiFi.scanNetworks(true /* async */, false);
+  s_scanState = (r == WIFI_SCAN_FAILED) ? WIFI_JOB_FAILED : WIFI_JOB_RUNNING;
+}
+
+static void collectScan(int n) {
+  s_netCount = 0;
+  for (int i = 0; i < n; i++) {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0 || ssid.length() > 32) continue;   // hidden networks
+    int8_t rssi = (int8_t)WiFi.RSSI(i);
+
+    int slot = -1;
+    for (int k = 0; k < s_netCount; k++) {
+      if (ssid == s_nets[k].ssid) { slot = k; break; }
+    }
+    if (slot >= 0 && s_nets[slot].rssi >= rssi) continue;
+    if (slot < 0) {
+      if (s_netCount >= WIFI_SCAN_MAX) {
+        // full: replace the weakest entry if this one is stronger
+        int weakest = 0;
+        for (int k = 1; k < s_netCount; k++) if (s_nets[k].rssi < s_nets[weakest].rssi) weakest = k;
+        if (s_nets[weakest].rssi >= rssi) continue;
+        slot = weakest;
+      } else {
+        slot = s_netCount++;
+      }
+    }
+
+    WifiNetwork& w = s_nets[slot];
+    strncpy(w.ssid, ssid.c_str(), sizeof(w.ssid) - 1);
+    w.ssid[sizeof(w.ssid) - 1] = 0;
+    w.rssi = rssi;
+    w.channel = (uint8_t)WiFi.channel(i);
+    w.secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+    const uint8_t* b = WiFi.BSSID(i);
+    if (b) memcpy(w.bssid, b, 6);
+    else memset(w.bssid, 0, 6);
+  }
+
+  // strongest first (insertion sort, n <= 20)
+  for (int i = 1; i < s_netCount; i++) {
+    WifiNetwork t = s_nets[i];
+    int j = i - 1;
+    while (j >= 0 && s_nets[j].rssi < t.rssi) { s_nets[j + 1] = s_nets[j]; j--; }
+    s_nets[j + 1] = t;
+  }
+}
+
+static void scanPoll() {
+  if (s_scanState != WIFI_JOB_RUNNING) return;
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  if (n < 0) {
+    s_scanState = WIFI_JOB_FAILED;
+  } else {
+    collectScan(n);
+    s_scanState = WIFI_JOB_DONE;
+    s_scanDoneMs = millis();
+    Serial.printf("[WIFI] scan: %d networks\n", s_netCount);
+  }
+  WiFi.scanDelete();
+}
+
+WifiJobState wifiScanState() {
+  return s_scanState;
+}
+
+int wifiScanResults(const WifiNetwork*& out) {
+  out = s_nets;
+  return s_netCount;
+}
+
+uint32_t wifiScanAgeMs() {
+  return s_scanDoneMs ? millis() - s_scanDoneMs : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Credential test
+// ---------------------------------------------------------------------------
+void wifiTestStart(const RuntimeConfig& cfg) {
+  s_testCfg = cfg;
+  if (s_testCfg.wifiPass.length() == 0) s_testCfg.wifiPass = g_cfg.wifiPass;   // blank = keep
+
+  WiFi.disconnect(false, false);
+  if (!s_testCfg.useDhcp) {
+    WiFi.config(s_testCfg.localIp, s_testCfg.gateway, s_testCfg.subnet, s_testCfg.dns1, s_testCfg.dns2);
+  } else {
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());   // back to DHCP
+  }
+  WiFi.begin(s_testCfg.wifiSsid.c_str(), s_testCfg.wifiPass.c_str());
+
+  s_testState = WIFI_JOB_RUNNING;
+  s_testStartMs = millis();
+  s_testEndMs = 0;
+  s_testDetail = "connecting";
+  s_testIp = IPAddress();
+  Serial.printf("[WIFI] testing connection to '%s'\n", s_testCfg.wifiSsid.c_str());
+}
+
+static void testFinish(bool ok, const char* detail) {
+  s_testState = ok ? WIFI_JOB_DONE : WIFI_JOB_FAILED;
+  s_testDetail = detail;
+  s_testEndMs = millis();
+  // Stop the station from retrying in the background (it drags the AP channel around).
+  if (!ok) WiFi.disconnect(false, false);
+  Serial.printf("[WIFI] test %s after %lu ms (%s)\n", ok ? "ok" : "failed",
+                (unsigned long)(s_testEndMs - s_testStartMs), detail);
+}
+
+static void testPoll() {
+  if (s_testState != WIFI_JOB_RUNNING) return;
+  wl_status_t st = WiFi.status();
+  if (st == WL_CONNECTED) {
+    s_testIp = WiFi.localIP();
+    testFinish(true, "connected");
+  } else if (st == WL_NO_SSID_AVAIL) {
+    testFinish(false, "network not found");
+  } else if (st == WL_CONNECT_FAILED) {
+    testFinish(false, "wrong password or rejected");
+  } else if (millis() - s_testStartMs >= WIFI_TEST_TIMEOUT_MS) {
+    testFinish(false, "timed out");
+  }
+}
+
+WifiJobState wifiTestState() {
+  return s_testState;
+}
+
+uint32_t wifiTestElapsedMs() {
+  if (s_testState == WIFI_JOB_IDLE) return 0;
+  return (s_testEndMs ? s_testEndMs : millis()) - s_testStartMs;
+}
+
+const char* wifiTestDetail() {
+  return s_testDetail;
+}
+
+IPAddress wifiTestIp() {
+  return s_testIp;
+}
+
+String wifiTestSsid() {
+  return s_testCfg.wifiSsid;
+}
+
+bool wifiTestVerified(const RuntimeConfig& cfg) {
+  if (s_testState != WIFI_JOB_DONE) return false;
+  String pass = cfg.wifiPass.length() ? cfg.wifiPass : g_cfg.wifiPass;
+  if (cfg.wifiSsid != s_testCfg.wifiSsid || pass != s_testCfg.wifiPass) return false;
+  if (cfg.useDhcp != s_testCfg.useDhcp) return false;
+  return cfg.useDhcp || (cfg.localIp == s_testCfg.localIp && cfg.gateway == s_testCfg.gateway &&
+                         cfg.subnet == s_testCfg.subnet);
+}
+
+void wifiLoop() {
+  scanPoll();
+  testPoll();
+}
+
+// ---------------------------------------------------------------------------
+// Boot connect (directed, with fallback)
+// ---------------------------------------------------------------------------
+struct WifiHint {
+  uint32_t magic;
+  uint32_t ssidCrc;    // hint only applies to the SSID it was learned on
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint8_t  reserved;
+  uint32_t ip, gw, sn, dns;   // last DHCP lease (0 with static IP)
+  uint32_t crc;
+};
+static const uint32_t WIFI_HINT_MAGIC = 0x4E574A42;   // "BJWN"
+
+static WifiConnectStats s_connStats = {};
+static Preferences prefsWifi;
+
+static uint32_t hintCrc(const WifiHint& h) {
+  return storageCrc32((const uint8_t*)&h, offsetof(WifiHint, crc));
+}
+
+static uint32_t ssidCrc(const String& ssid) {
+  return storageCrc32((const uint8_t*)ssid.c_str(), ssid.length());
+}
+
+static bool loadHint(WifiHint& h) {
+  g_nvsMutex.lock();
+  prefsWifi.begin("wifi", true);
+  size_t n = prefsWifi.getBytes("hint", &h, sizeof(h));
+  prefsWifi.end();
+  g_nvsMutex.unlock();
+  return n == sizeof(h) && h.magic == WIFI_HINT_MAGIC && h.crc == hintCrc(h) && h.channel >= 1 && h.channel <= 14;
+}
+
+static void saveHint(const WifiHint& old, bool hadOld, const RuntimeConfig& cfg) {
+  WifiHint h = {};
+  h.magic = WIFI_HINT_MAGIC;
+  h.ssidCrc = ssidCrc(cfg.wifiSsid);
+  const uint8_t* b = WiFi.BSSID();
+  if (b) memcpy(h.bssid, b, 6);
+  h.channel = (uint8_t)WiFi.channel();
+  if (cfg.useDhcp) {
+    h.ip = (uint32_t)WiFi.localIP();
+    h.gw = (uint32_t)WiFi.gatewayIP();
+    h.sn = (uint32_t)WiFi.subnetMask();
+    h.dns = (uint32_t)WiFi.dnsIP(0);
+  }
+  h.crc = hintCrc(h);
+  if (hadOld && memcmp(&h, &old, sizeof(h)) == 0) return;   // unchanged: no flash write
+
+  g_nvsMutex.lock();
+  prefsWifi.begin("wifi", false);
+  prefsWifi.putBytes("hint", &h, sizeof(h));
+  prefsWifi.end();
+  g_nvsMutex.unlock();
+  Serial.printf("[WIFI] saved connect hint (ch %u)\n", (unsigned)h.channel);
+}
+
+// Boot connect state (non-blocking so setup() can bring up BLE / storage meanwhile)
+static WifiJobState s_connState = WIFI_JOB_IDLE;
+static bool     s_connDirected = false;   // directed attempt in progress
+static bool     s_connHaveHint = false;
+static WifiHint s_connHint;
+static RuntimeConfig s_connCfg;
+static uint32_t s_connStartMs = 0;
+static uint32_t s_connTimeoutMs = 0;
+
+void wifiConnectBegin(const RuntimeConfig& cfg, uint32_t timeoutMs) {
+  s_connStats = {};
+  s_connCfg = cfg;
+  s_connTimeoutMs = timeoutMs;
+  s_connHaveHint = loadHint(s_connHint) && s_connHint.ssidCrc == ssidCrc(cfg.wifiSsid);
+  s_connDirected = s_connHaveHint;
+  s_connState = WIFI_JOB_RUNNING;
+  s_connStartMs = millis();
+
+  if (s_connDirected) {
+    WiFi.begin(cfg.wifiSsid.c_str(), cfg.wifiPass.c_str(), s_connHint.channel, s_connHint.bssid, true);
+  } else {
+    WiFi.begin(cfg.wifiSsid.c_str(), cfg.wifiPass.c_str());
+  }
+}
+
+WifiJobState wifiConnectPoll() {
+  if (s_connState != WIFI_JOB_RUNNING) return s_connState;
+
+  uint32_t elapsed = millis() - s_connStartMs;
+  if (!WiFi.isConnected()) {
+    if (s_connDirected && elapsed >= WIFI_DIRECTED_TIMEOUT_MS) {
+      // AP moved channel / replaced: forget the BSSID and let the station scan
+      Serial.printf("[WIFI] directed connect (ch %u) failed, falling back to scan\n", (unsigned)s_connHint.channel);
+      s_connStats.directedMs = elapsed;
+      s_connStats.fallback = true;
+      s_connDirected = false;
+      WiFi.disconnect(false, false);
+      delay(50);
+      WiFi.begin(s_connCfg.wifiSsid.c_str(), s_connCfg.wifiPass.c_str());
+    } else if (elapsed >= s_connTimeoutMs) {
+      s_connCfg.wifiPass = String();
+      s_connState = WIFI_JOB_FAILED;
+    }
+    return s_connState;
+  }
+
+  if (s_connDirected) {
+    s_connStats.directedMs = elapsed;
+    s_connStats.directed = true;
+  }
+  s_connStats.connectMs = elapsed;
+  s_connStats.channel = (uint8_t)WiFi.channel();
+  s_connStats.rssi = (int8_t)WiFi.RSSI();
+  s_connStats.leaseSame = s_connHaveHint && s_connCfg.useDhcp && s_connHint.ip == (uint32_t)WiFi.localIP();
+  Serial.printf("[WIFI] connected in %lu ms (%s, ch %u, %d dBm)\n", (unsigned long)s_connStats.connectMs,
+                s_connStats.directed ? "directed" : (s_connStats.fallback ? "fallback scan" : "scan"),
+                (unsigned)s_connStats.channel, (int)s_connStats.rssi);
+
+  saveHint(s_connHint, s_connHaveHint, s_connCfg);
+  s_connCfg.wifiPass = String();
+  s_connState = WIFI_JOB_DONE;
+  return s_connState;
+}
+
+const WifiConnectStats& wifiConnectStats() {
+  return s_connStats;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "AppCommon.h"
+#include "AppConfig.h"
+
+// Non-blocking Wi-Fi helpers for the setup portal and /config: a cached network scan and a
+// credential test that connects in the background while the portal keeps serving. Both are
+// advanced from wifiLoop().
+static const int WIFI_SCAN_MAX = 20;
+static const uint32_t WIFI_SCAN_MAX_AGE_MS = 30000;   // older results trigger a new scan
+static const uint32_t WIFI_TEST_TIMEOUT_MS = 15000;
+
+struct WifiNetwork {
+  char    ssid[33];
+  int8_t  rssi;
+  uint8_t channel;
+  bool    secure;
+  uint8_t bssid[6];
+};
+
+enum WifiJobState : uint8_t { WIFI_JOB_IDLE = 0, WIFI_JOB_RUNNING, WIFI_JOB_DONE, WIFI_JOB_FAILED };
+
+// Scan: one entry per SSID (strongest BSSID), strongest first.
+void wifiScanStart(bool force);                 // no-op while running or if results are fresh
+WifiJobState wifiScanState();
+int  wifiScanResults(const WifiNetwork*& out);  // count; valid until the next scan completes
+uint32_t wifiScanAgeMs();
+
+// Credential test: connects the station with cfg's SSID/password/IP settings.
+void wifiTestStart(const RuntimeConfig& cfg);
+WifiJobState wifiTestState();
+uint32_t wifiTestElapsedMs();
+const char* wifiTestDetail();                   // "connecting", "connected", "wrong password", ...
+IPAddress wifiTestIp();
+String wifiTestSsid();                          // network of the last test ("" = none yet)
+// true if the last test succeeded with exactly these credentials
+bool wifiTestVerified(const RuntimeConfig& cfg);
+
+void wifiLoop();
+
+// --------------------------- Boot connect ---------------------------
+// The BSSID/channel of the last successful connection (plus the DHCP lease it got) are kept
+// in NVS. Boot first tries a directed connect to that BSSID on that channel, which skips the
+// all-channel scan; if that does not connect within WIFI_DIRECTED_TIMEOUT_MS it falls back to
+// a normal connect. The hint is rewritten only when it changes.
+static const uint32_t WIFI_DIRECTED_TIMEOUT_MS = 4000;
+
+struct WifiConnectStats {
+  uint32_t connectMs;    // WiFi.begin() -> connected (including any fallback)
+  uint32_t directedMs;   // time spent on the directed attempt (0 = not tried)
+  bool     directed;     // connected on the directed attempt
+  bool     fallback;     // directed attempt failed, full connect used
+  bool     leaseSame;    // DHCP handed out the same address as last time
+  uint8_t  channel;
+  int8_t   rssi;
+};
+
+// Non-blocking: begin, then poll until DONE / FAILED (timeoutMs covers both attempts).
+void wifiConnectBegin(const RuntimeConfig& cfg, uint32_t timeoutMs);
+WifiJobState wifiConnectPoll();
+const WifiConnectStats& wifiConnectStats();
@@ -2,7 +2,14 @@
 
 WebServer server(80);
 
-static bool setupWiFi() {
+static String hostNameLower() {
+  String host = normalizeHost(g_cfg.hostName);
+  host.toLowerCase();
+  return host;
+}
+
+// Starts association and returns; setupWiFiFinish() waits for it.
+static void setupWiFiBegin() {
   WiFi.mode(WIFI_STA);
   WiFi.setSleep(false);
 
@@ -11,37 +18,49 @@ static bool setupWiFi() {
     WiFi.config(g_cfg.localIp, g_cfg.gateway, g_cfg.subnet, g_cfg.dns1, g_cfg.dns2);
   }
 
-  String host = normalizeHost(g_cfg.hostName);
-  String hostLower = host; hostLower.toLowerCase();
-  WiFi.setHostname(hostLower.c_str());
-
-  WiFi.begin(g_cfg.wifiSsid.c_str(), g_cfg.wifiPass.c_str());
+  WiFi.setHostname(hostNameLower().c_str());
 
-  uint32_t start = millis();
-  while (!WiFi.isConnected() && millis() - start < 15000) delay(250);
+  // Directed connect to the last BSSID/channel first, full scan as fallback (AppWifi)
+  wifiConnectBegin(g_cfg, 15000);
+  bootMark(BOOT_WIFI_BEGIN);
+}
 
-  if (!WiFi.isConnected()) return false;
+static bool setupWiFiFinish() {
+  while (wifiConnectPoll() == WIFI_JOB_RUNNING) delay(20);
+  if (wifiConnectPoll() != WIFI_JOB_DONE) return false;
+  bootMark(BOOT_WIFI_CONNECTED);
 
   Serial.printf("[WIFI] Connected. IP=%s\n", WiFi.localIP().toString().c_str());
+  setupMdns();
+  return true;
+}
 
-  // mDNS: http://<hostname>.local/
-  if (MDNS.begin(hostLower.c_str())) {
+// mDNS: http://<hostname>.local/ (re-run on a host name change)
+void setupMdns() {
+  static bool started = false;
+  if (started) MDNS.end();
+  String hostLower = hostNameLower();
+  started = MDNS.begin(hostLower.c_str());
+  if (started) {
     MDNS.addService("http", "tcp", 80);
     Serial.printf("[MDNS] http://%s.local/\n", hostLower.c_str());
   }
-  return true;
 }
 
-static void setupTimeNtp() {
-  // Time zone + NTP. Note: Arduino-ESP32's configTime(...) may reset TZ to UTC,
-  // so set TZ *after* calling configTime to ensure localtime() reflects the selected zone.
+void setupTimeZone() {
+  // Local-time conversion only; set before Wi-Fi so a clock restored from RTC memory is
+  // usable by the scheduler right away. Also re-run on a TZ change.
   String tz = g_cfg.tz; tz.trim();
   if (tz.length() == 0) tz = DEFAULT_TZ;
 
-  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-
   setenv("TZ", tz.c_str(), 1);
   tzset();
+  timeSetTz(tz);
+}
+
+static void setupTimeNtp() {
+  // Our own SNTP client (AppNtp) sets / corrects the system clock.
+  ntpBegin(g_cfg.ntpServer);
 }
 
 void setupBle() {
@@ -52,12 +71,16 @@ void setupBle() {
 
 static void setupWeb() {
   server.on("/", HTTP_GET, handleRoot);
+  server.on("/sw.js", HTTP_GET, handleServiceWorker);
   server.on("/api/state", HTTP_GET, handleState);
+  server.on("/api/metrics", HTTP_GET, handleMetrics);
+  server.on("/api/boot", HTTP_GET, handleBoot);
 
   server.on("/api/ble/connect", HTTP_POST, handleBleConnect);
   server.on("/api/ble/disconnect", HTTP_POST, handleBleDisconnect);
 
   server.on("/api/cmd/button", HTTP_POST, handleCmdButton);
+  server.on("/api/cmd/result", HTTP_GET, handleCmdResult);
 
   server.on("/api/schedule/add", HTTP_POST, handleScheduleAdd);
   server.on("/api/schedule/update", HTTP_POST, handleScheduleUpdate);
@@ -65,43 +88,75 @@ static void setupWeb() {
   server.on("/api/schedule/runOne", HTTP_POST, handleScheduleRunOne);
   server.on("/api/schedule/export", HTTP_GET, handleScheduleExport);
   server.on("/api/schedule/import", HTTP_POST, handleScheduleImport);
+  server.on("/api/schedule/batch", HTTP_POST, handleScheduleBatch);
   server.on("/api/schedule/pause", HTTP_POST, handleSchedulePause);
 
+  server.on("/api/profiles", HTTP_GET, handleProfiles);
+  server.on("/api/profiles/save", HTTP_POST, handleProfileSave);
+  server.on("/api/profiles/load", HTTP_POST, handleProfileLoad);
+  server.on("/api/profiles/delete", HTTP_POST, handleProfileDelete);
+  server.on("/api/history", HTTP_GET, handleHistory);
+
   setupWebNormalConfigPage();
+  static const char* kHeaders[] = {"If-None-Match"};
+  server.collectHeaders(kHeaders, 1);
   server.begin();
 }
 
 void setup() {
   Serial.begin(115200);
+  // Before anything else: a warm reboot gets its wall clock back from RTC memory
+  rtcClockRestore();
+  bootMark(BOOT_RTC_RESTORED);
   delay(200);
 
   // BOOT button (GPIO0) held low at boot forces config portal
   pinMode(0, INPUT_PULLUP);
   bool forceCfg = (digitalRead(0) == LOW);
 
-  loadSchedule();
   bool hasCfg = loadConfig();
+  bootMark(BOOT_CONFIG_LOADED);
+  setupTimeZone();
 
   if (forceCfg || !hasCfg) {
     startConfigPortal();
     return;
   }
 
-  bool wifiOk = setupWiFi();
+  // Association takes seconds; everything that does not need the network runs meanwhile.
+  setupWiFiBegin();
+
+  loadSchedule();
+  g_schedRev = esp_random();
+  bootMark(BOOT_SCHEDULE_LOADED);
+
+  // BLE + scheduler task: NimBLE init and the first BedJet connect run while Wi-Fi associates
+  ctlStart();
+
+  fsBegin();
+  bootMark(BOOT_FS_MOUNTED);
+
+  bool wifiOk = setupWiFiFinish();
   if (!wifiOk) {
-    Serial.println("[WIFI] Not connected. Falling back to setup AP portal.");
+    // The control task keeps running on purpose: a router that is down (e.g. after a power
+    // cut) should not stop the bed's schedule while the clock is still valid (RTC). Idle it
+    // only touches the radio to apply a block or reconcile one, so the portal's soft-AP
+    // shares air time with occasional BLE connects, not a continuous scan.
+    Serial.println("[WIFI] Not connected. Falling back to setup AP portal (scheduler keeps running).");
     startConfigPortal();
     return;
   }
 
   setupWeb();
+  bootMark(BOOT_WEB_READY);
   setupTimeNtp();
-  setupBle();
 }
 
 void loop() {
   // Pending restart (used by config portal & config page)
   if (g_pendingRestartAtMs && (int32_t)(millis() - g_pendingRestartAtMs) >= 0) {
+    persistFlush();
+    rtcClockSaveNow();
     delay(50);
     ESP.restart();
   }
@@ -110,21 +165,30 @@ void loop() {
   if (g_configMode) {
     g_dns.processNextRequest();
     server.handleClient();
+    wifiLoop();
     delay(5);
     return;
   }
 
+  // Gap between two passes = worst-case HTTP wait (BLE and the scheduler run on the control task)
+  static uint32_t lastPassUs = 0;
+  uint32_t passUs = micros();
+  if (lastPassUs && passUs - lastPassUs > g_metrics.webLoopUsMax) g_metrics.webLoopUsMax = passUs - lastPassUs;
+  lastPassUs = passUs;
+
   server.handleClient();
+  wifiLoop();   // /api/wifi/scan results
 
-  // keep BLE state honest (and clear handles if link dropped)
-  bleLoop();
+  // NTP request / reply (non-blocking) + wall-clock checkpoint for warm reboots
+  ntpLoop();
+  if (ntpSynced()) bootMark(BOOT_NTP_SYNCED);
+  rtcClockCheckpoint();
 
-  // scheduler tick (every 2s)
-  uint32_t now = millis();
-  if (now - g_lastSchedulerTickMs >= 2000) {
-    g_lastSchedulerTickMs = now;
-    schedulerTick();
-  }
+  // status history sampling (LittleFS)
+  fsLoop();
+
+  // write-behind NVS flush (schedule/config edits from the web handlers)
+  persistLoop();
 
   delay(5);
 }
@@ -9,7 +9,13 @@
 #include "AppTime.h"
 #include "AppBle.h"
 #include "AppStorage.h"
+#include "AppFs.h"
+#include "AppNtp.h"
+#include "AppRtc.h"
+#include "AppWifi.h"
+#include "AppBoot.h"
 #include "AppScheduler.h"
+#include "AppControl.h"
 #include "AppWeb.h"
 #include "AppWebConfig.h"
 
@@ -0,0 +1,95 @@
+#include "NtpCore.h"
+#include <string.h>
+
+static void putBe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static uint32_t getBe32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void ntpPutTimestamp(int64_t us, uint8_t* p) {
+  int64_t sec = us / 1000000LL;
+  int64_t sub = us % 1000000LL;
+  putBe32(p, (uint32_t)(sec + NTP_UNIX_DELTA));
+  putBe32(p + 4, (uint32_t)(((uint64_t)sub << 32) / 1000000ULL));
+}
+
+int64_t ntpGetTimestamp(const uint8_t* p) {
+  int64_t sec = getBe32(p);
+  if (sec < 0x80000000LL) sec += 0x100000000LL;   // era 1 (after 2036-02-07)
+  uint64_t frac = getBe32(p + 4);
+  // Rounded, so a timestamp written by ntpPutTimestamp() reads back to the same microsecond
+  return (sec - NTP_UNIX_DELTA) * 1000000LL + (int64_t)((frac * 1000000ULL + 0x80000000ULL) >> 32);
+}
+
+static bool isZero(const uint8_t* p, size_t n) {
+  for (size_t i = 0; i < n; i++) if (p[i]) return false;
+  return true;
+}
+
+NtpCore::NtpCore(NtpClock& clock, NtpStats& stats) : m_clock(clock), m_stats(stats) {}
+
+void NtpCore::buildRequest(uint8_t* pkt) {
+  memset(pkt, 0, NTP_PACKET_SIZE);
+  pkt[0] = 0x23;   // LI 0, version 4, mode 3 (client)
+
+  m_sentUs = m_clock.wallUs();
+  ntpPutTimestamp(m_sentUs, m_sentTs);
+  memcpy(&pkt[40], m_sentTs, 8);
+  m_pending = true;
+}
+
+NtpReply NtpCore::handleReply(const uint8_t* pkt, size_t len) {
+  int64_t t4 = m_clock.wallUs();
+  if (!m_pending || len < NTP_PACKET_SIZE) return NTP_REPLY_REJECTED;
+
+  uint8_t mode = pkt[0] & 0x07;
+  uint8_t li = pkt[0] >> 6;
+  uint8_t stratum = pkt[1];
+  // Originate must echo our transmit time: drops stale, duplicate and spoofed replies
+  if (mode != 4 || memcmp(&pkt[24], m_sentTs, 8) != 0) return NTP_REPLY_REJECTED;
+  m_pending = false;
+
+  if (stratum == 0) {
+    memcpy(m_kiss, &pkt[12], 4);   // reference ID carries the kiss code
+    m_kiss[4] = 0;
+    return NTP_REPLY_KOD;
+  }
+  // Unsynchronised server, or no receive / transmit time
+  if (li == 3 || stratum > 15 || isZero(&pkt[32], 8) || isZero(&pkt[40], 8)) return NTP_REPLY_REJECTED;
+
+  int64_t t1 = m_sentUs;
+  int64_t t2 = ntpGetTimestamp(&pkt[32]);
+  int64_t t3 = ntpGetTimestamp(&pkt[40]);
+  int64_t offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+  int64_t rttUs = (t4 - t1) - (t3 - t2);
+  if (rttUs < 0) rttUs = 0;
+
+  bool first = !synced();
+  int64_t offsetMs = offsetUs / 1000;
+  if (first || offsetMs > NTP_STEP_THRESHOLD_MS || offsetMs < -NTP_STEP_THRESHOLD_MS) {
+    m_clock.stepUs(offsetUs);
+    m_stats.steps++;
+  } else {
+    m_clock.slewUs(offsetUs);
+  }
+
+  uint32_t now = m_clock.monoMs();
+  // Drift from the correction needed since the previous sync (not meaningful for the first
+  // one, which mostly corrects "no time at all" or a restored RTC value).
+  if (!first && now != m_stats.lastSyncMs) {
+    float ppm = (float)offsetUs * 1000.0f / (float)(now - m_stats.lastSyncMs);
+    m_stats.driftPpm = (m_stats.syncs < 2) ? ppm : m_stats.driftPpm * 0.75f + ppm * 0.25f;
+  }
+
+  m_stats.syncs++;
+  m_stats.lastOffsetMs = (int32_t)offsetMs;
+  m_stats.lastRttMs = (uint32_t)(rttUs / 1000);
+  if (m_stats.bestRttMs == 0 || m_stats.lastRttMs < m_stats.bestRttMs) m_stats.bestRttMs = m_stats.lastRttMs;
+  m_stats.stratum = stratum;
+  m_stats.lastSyncMs = now;
+  if (first) m_stats.firstSyncMs = now ? now : 1;
+  return NTP_REPLY_OK;
+}
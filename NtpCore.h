@@ -0,0 +1,65 @@
+#pragma once
+// SNTP packet handling and clock correction: plain C++ with no Arduino / lwIP includes, so a
+// host test can replay canned server replies (same split as SchedulerCore.h). The system
+// clock sits behind NtpClock; the firmware adapter and the UDP / DNS side live in AppNtp.cpp.
+#include <stdint.h>
+#include <stddef.h>
+
+static const size_t   NTP_PACKET_SIZE = 48;
+static const uint32_t NTP_UNIX_DELTA = 2208988800UL;   // 1900-01-01 -> 1970-01-01
+static const int32_t  NTP_STEP_THRESHOLD_MS = 500;    // larger corrections step instead of slewing
+
+struct NtpStats {
+  uint32_t requests;
+  uint32_t syncs;          // accepted replies
+  uint32_t failures;       // timeouts, DNS failures, rejected replies
+  uint32_t steps;          // clock stepped (settimeofday) instead of slewed
+  int32_t  lastOffsetMs;   // correction applied at the last sync (server - local)
+  uint32_t lastRttMs;      // round-trip delay of the last sync
+  uint32_t bestRttMs;
+  float    driftPpm;       // smoothed local clock drift (positive = local clock slow)
+  uint32_t firstSyncMs;    // monoMs() at the first sync (0 = not yet)
+  uint32_t lastSyncMs;     // monoMs() at the last sync
+  uint8_t  stratum;
+};
+
+class NtpClock {
+ public:
+  virtual ~NtpClock() {}
+  virtual int64_t  wallUs() = 0;                 // system wall clock, microseconds since 1970
+  virtual uint32_t monoMs() = 0;                 // monotonic milliseconds
+  virtual void     stepUs(int64_t offsetUs) = 0; // jump the wall clock by offsetUs
+  virtual void     slewUs(int64_t offsetUs) = 0; // correct gradually (adjtime)
+};
+
+enum NtpReply : uint8_t {
+  NTP_REPLY_OK = 0,
+  NTP_REPLY_REJECTED,   // malformed, unsynchronised server, zero / unmatched timestamps
+  NTP_REPLY_KOD         // kiss-o'-death (stratum 0): back off, e.g. "RATE" / "DENY"
+};
+
+// 64-bit NTP timestamps <-> Unix microseconds (era 1 from 2036-02-07 on)
+void    ntpPutTimestamp(int64_t unixUs, uint8_t* p);
+int64_t ntpGetTimestamp(const uint8_t* p);
+
+class NtpCore {
+ public:
+  NtpCore(NtpClock& clock, NtpStats& stats);
+
+  // Client request (mode 3); remembers its transmit time to match and time the reply.
+  void buildRequest(uint8_t* pkt);
+  // Validates a reply to the last request; on OK corrects the clock and updates the stats.
+  // Failures are left to the caller to count (it also counts timeouts / DNS errors).
+  NtpReply handleReply(const uint8_t* pkt, size_t len);
+
+  bool synced() const { return m_stats.firstSyncMs != 0; }
+  const char* lastKiss() const { return m_kiss; }   // code of the last kiss-o'-death ("RATE", ...)
+
+ private:
+  NtpClock& m_clock;
+  NtpStats& m_stats;
+  int64_t   m_sentUs = 0;      // local wall clock at send (t1)
+  uint8_t   m_sentTs[8] = {};  // transmit timestamp as sent; echoed back as originate
+  bool      m_pending = false;
+  char      m_kiss[5] = {};
+};
@@ -0,0 +1,399 @@
+#include "SchedulerCore.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// --------------------------- Pure helpers ---------------------------
+bool schedWithinBlock(uint16_t nowMin, uint16_t startMin, uint16_t stopMin) {
+  if (startMin == stopMin) return false;
+  if (startMin < stopMin) return (nowMin >= startMin && nowMin < stopMin);
+  return (nowMin >= startMin) || (nowMin < stopMin); // wraps midnight
+}
+
+uint16_t schedDurationMinutes(uint16_t startMin, uint16_t stopMin) {
+  int d = (int)stopMin - (int)startMin;
+  if (d <= 0) d += 1440;
+  return (uint16_t)d;
+}
+
+// Minutes left until the block's stop time (handles midnight wrap). Used when a block is
+// entered late (reboot / power blip / resume) so the BedJet stops at the scheduled time.
+// 0 at the stop minute itself (the block is over, not a day away).
+uint16_t schedMinutesUntilStop(uint16_t nowMin, uint16_t stopMin) {
+  int d = (int)stopMin - (int)nowMin;
+  if (d < 0) d += 1440;
+  return (uint16_t)d;
+}
+
+// Minutes elapsed since the block's start time (handles midnight wrap).
+uint16_t schedMinutesSinceStart(uint16_t nowMin, uint16_t startMin) {
+  int d = (int)nowMin - (int)startMin;
+  if (d < 0) d += 1440;
+  return (uint16_t)d;
+}
+
+static bool inWrapTail(const ScheduleItem& it, uint16_t nowMin) {
+  return it.startMin > it.stopMin && nowMin < it.stopMin;
+}
+
+uint16_t schedOccurrenceDay(const ScheduleItem& it, uint16_t nowMin, uint16_t dayNum) {
+  return inWrapTail(it, nowMin) ? (uint16_t)(dayNum - 1) : dayNum;
+}
+
+// Day/date filter. A block that wraps midnight belongs to the day it *started* on, so in
+// its after-midnight tail the previous day's weekday/date are checked.
+bool schedActiveOnDay(const ScheduleItem& it, uint16_t nowMin, uint8_t wday, uint16_t dayNum) {
+  if (inWrapTail(it, nowMin)) {
+    wday = (uint8_t)((wday + 6) % 7);
+    dayNum = (uint16_t)(dayNum - 1);
+  }
+  if (!(it.daysMask & (1u << wday))) return false;
+  if (it.fromDay && dayNum < it.fromDay) return false;
+  if (it.toDay && dayNum > it.toDay) return false;
+  return true;
+}
+
+// Single pass over the table: the first matching override wins outright, otherwise the
+// first matching regular item (table order = priority, as before).
+int schedPickActiveIndex(const ScheduleItem* items, int count, uint16_t nowMin, uint8_t wday, uint16_t dayNum,
+                         int skip) {
+  int regular = -1;
+  for (int i = 0; i < count; i++) {
+    const ScheduleItem& it = items[i];
+    if (!it.enabled || i == skip) continue;
+    if (!it.isOverride && regular >= 0) continue;
+    if (!schedWithinBlock(nowMin, it.startMin, it.stopMin)) continue;
+    if (!schedActiveOnDay(it, nowMin, wday, dayNum)) continue;
+    if (it.isOverride) return i;
+    regular = i;
+  }
+  return regular;
+}
+
+bool schedHasRamp(const ScheduleItem& it) {
+  if (it.modeButton == BTN_OFF) return false;
+  return it.rampToTempF != 0 || it.rampToFan != RAMP_FAN_NONE;
+}
+
+// Setpoint of a (possibly ramping) block. Time is quantized to whole ramp steps counted
+// from the block start, so the same block always produces the same command stream.
+void schedRampSetpoint(const ScheduleItem& it, uint16_t nowMin, uint8_t stepMin, int& outTempF, uint8_t& outFan) {
+  outTempF = (int)lroundf(it.tempF);
+  outFan = it.fanStep;
+  if (!schedHasRamp(it)) return;
+
+  uint16_t blockLen = schedDurationMinutes(it.startMin, it.stopMin);
+  uint16_t rampLen = (it.rampMinutes && it.rampMinutes < blockLen) ? it.rampMinutes : blockLen;
+  uint16_t elapsed = schedMinutesSinceStart(nowMin, it.startMin);
+  if (stepMin == 0) stepMin = 1;
+
+  float frac = 1.0f;
+  if (elapsed < rampLen) frac = (float)((elapsed / stepMin) * stepMin) / (float)rampLen;
+
+  if (it.rampToTempF) outTempF = (int)lroundf(it.tempF + ((float)it.rampToTempF - it.tempF) * frac);
+  if (it.rampToFan != RAMP_FAN_NONE) {
+    int f = (int)lroundf((float)it.fanStep + ((float)it.rampToFan - (float)it.fanStep) * frac);
+    if (f < (int)FAN_MIN) f = FAN_MIN;
+    if (f > (int)FAN_MAX) f = FAN_MAX;
+    outFan = (uint8_t)f;
+  }
+}
+
+// Whole ramp steps since the block start; ramp writes happen when this changes.
+static int rampStepIndex(const ScheduleItem& it, uint16_t nowMin, uint8_t stepMin) {
+  if (stepMin == 0) stepMin = 1;
+  return schedMinutesSinceStart(nowMin, it.startMin) / stepMin;
+}
+
+uint32_t scheduleItemHash(const ScheduleItem& it) {
+  // FNV-1a over the command-relevant fields
+  uint32_t h = 2166136261u;
+  auto mix = [&h](const void* p, size_t n) {
+    const uint8_t* b = (const uint8_t*)p;
+    for (size_t i = 0; i < n; i++) { h ^= b[i]; h *= 16777619u; }
+  };
+  mix(&it.id, sizeof(it.id));
+  mix(&it.modeButton, sizeof(it.modeButton));
+  mix(&it.fanStep, sizeof(it.fanStep));
+  mix(&it.tempF, sizeof(it.tempF));
+  mix(&it.startMin, sizeof(it.startMin));
+  mix(&it.stopMin, sizeof(it.stopMin));
+  mix(&it.rampToTempF, sizeof(it.rampToTempF));
+  mix(&it.rampToFan, sizeof(it.rampToFan));
+  mix(&it.rampMinutes, sizeof(it.rampMinutes));
+  return h;
+}
+
+// --------------------------- Scheduler ---------------------------
+SchedulerCore::SchedulerCore(SchedClock& clock, SchedActuator& act, SchedPersist& persist, SchedStats& stats)
+  : m_clock(clock), m_act(act), m_persist(persist), m_stats(stats) {}
+
+void SchedulerCore::logf(const char* fmt, ...) {
+  char buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  m_act.log(buf);
+}
+
+bool SchedulerCore::apply(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p) {
+  if (!m_act.ensureConnected()) return false;
+
+  m_act.setClockNow();
+  m_act.pauseMs(40);
+
+  if (it.modeButton == BTN_OFF) {
+    return m_act.button(BTN_OFF);
+  }
+
+  // Use "smart" mode switching to improve reliability when crossing COOL <-> HEAT-family modes.
+  if (!m_act.setModeSmart(it.modeButton)) return false;
+  m_act.pauseMs(80);
+
+  // Ramping blocks entered late start from the interpolated setpoint, not the initial one.
+  int tempF;
+  uint8_t fan;
+  schedRampSetpoint(it, nowMin, p.rampStepMin, tempF, fan);
+
+  m_act.setFan(fan);
+  m_act.pauseMs(60);
+
+  m_act.setTempF(schedHasRamp(it) ? (float)tempF : it.tempF);
+  m_act.pauseMs(60);
+  rampReset(rampStepIndex(it, nowMin, p.rampStepMin), tempF, fan);
+
+  // Remaining duration: equals the full block when entered on time, shorter when entered late.
+  uint16_t runMins = schedMinutesUntilStop(nowMin, it.stopMin);
+  m_act.setRuntimeMinutes(runMins);
+
+  return true;
+}
+
+// --------------------------- Ramps ---------------------------
+void SchedulerCore::rampReset(int step, int tempF, int fan) {
+  m_rampStep = step;
+  m_rampSentTempF = tempF;
+  m_rampSentFan = fan;
+}
+
+// Called every scheduler tick while a ramping block stays active. Sends only the fields
+// whose interpolated value changed, once per ramp step (on the first tick after each step
+// boundary counted from the block start, so writes do not drift with tick timing), and
+// skips writes when the latest status frame already reports the wanted value.
+void SchedulerCore::rampTick(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p) {
+  if (!schedHasRamp(it)) return;
+
+  uint8_t stepMin = p.rampStepMin ? p.rampStepMin : 1;
+  int step = rampStepIndex(it, nowMin, stepMin);
+  bool everSent = (m_rampSentTempF >= 0 || m_rampSentFan >= 0);  // false after a resume-on-boot
+  if (everSent && step == m_rampStep) return;
+
+  int tempF;
+  uint8_t fan;
+  schedRampSetpoint(it, nowMin, stepMin, tempF, fan);
+
+  BedjetStatus st;
+  bool haveStatus = m_act.getStatus(st);
+  int curTempF = haveStatus ? st.targetF : m_rampSentTempF;
+  int curFan   = haveStatus ? (int)st.fanStep : m_rampSentFan;
+
+  bool sendTemp = (it.rampToTempF != 0) && tempF != curTempF;
+  bool sendFan  = (it.rampToFan != RAMP_FAN_NONE) && (int)fan != curFan;
+  if (!sendTemp && !sendFan) {
+    m_rampStep = step;
+    return;
+  }
+  if (!m_act.ensureConnected()) return;
+
+  uint16_t elapsed = schedMinutesSinceStart(nowMin, it.startMin);
+  if (sendTemp) {
+    m_act.setTempF((float)tempF);
+    logf("[SCHED] ramp id=%u t+%u temp=%dF", (unsigned)it.id, (unsigned)elapsed, tempF);
+  }
+  if (sendFan) {
+    if (sendTemp) m_act.pauseMs(60);
+    m_act.setFan(fan);
+    logf("[SCHED] ramp id=%u t+%u fan=%u", (unsigned)it.id, (unsigned)elapsed, (unsigned)fan);
+  }
+  rampReset(step, tempF, fan);
+}
+
+// --------------------------- Reconciler ---------------------------
+// While a block is active, periodically compare the decoded status frame to what the block
+// wants and send only what differs. Mode drift (including a BedJet power cycle, which comes
+// back OFF) triggers a full re-apply so runtime is restored too.
+static const uint8_t RECONCILE_MAX_RETRIES = 3;  // per block, for drift that does not stick
+
+void SchedulerCore::reconcileReset() {
+  m_recLastCheckMs = m_clock.monoMs();
+  m_recDriftCount = 0;
+  m_recRetries = 0;
+  m_manualHold = false;
+}
+
+void SchedulerCore::noteManualCommand(int activeIndex) {
+  if (activeIndex >= 0) m_manualHold = true;
+}
+
+void SchedulerCore::reconcileTick(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p) {
+  if (p.reconcileSec == 0 || m_manualHold) return;
+  if (m_clock.monoMs() - m_recLastCheckMs < (uint32_t)p.reconcileSec * 1000UL) return;
+  m_recLastCheckMs = m_clock.monoMs();
+
+  if (!m_act.isConnected()) {
+    // Link drops when the BedJet is power-cycled or out of range; reconnect so its state
+    // can be checked. Status notifications resume once connected.
+    m_act.ensureConnected();
+    return;
+  }
+
+  BedjetStatus st;
+  if (!m_act.getStatus(st)) return;
+  m_stats.reconcileChecks++;
+
+  int tempF;
+  uint8_t fan;
+  schedRampSetpoint(it, nowMin, p.rampStepMin, tempF, fan);
+
+  bool adjustable = (it.modeButton != BTN_OFF && it.modeButton != BTN_DRY);
+  // The BedJet ends TURBO by itself on its own timer and carries on in HEAT; re-applying
+  // would re-arm a turbo nobody asked to extend. Temp and fan are still compared.
+  bool turboExpired = (it.modeButton == BTN_TURBO && st.modeButton == BTN_HEAT);
+  bool modeDiff = (st.modeButton != it.modeButton) && !turboExpired;
+  bool tempDiff = adjustable && abs(st.targetF - tempF) > (int)p.reconcileTolF;
+  bool fanDiff  = adjustable && st.fanStep != fan;
+
+  if (!modeDiff && !tempDiff && !fanDiff) {
+    m_recDriftCount = 0;
+    m_recRetries = 0;
+    m_stats.reconcileNoops++;
+    return;
+  }
+
+  // Hysteresis: only act on drift seen on several consecutive checks.
+  uint8_t hyst = p.reconcileHyst ? p.reconcileHyst : 1;
+  if (++m_recDriftCount < hyst) return;
+  m_recDriftCount = 0;
+  if (m_recRetries >= RECONCILE_MAX_RETRIES) return;
+  m_recRetries++;
+
+  if (modeDiff) {
+    logf("[SCHED] reconcile id=%u mode drift, re-applying", (unsigned)it.id);
+    if (apply(it, nowMin, p)) m_stats.reconcileReapplies++;
+    return;
+  }
+  if (tempDiff) {
+    logf("[SCHED] reconcile id=%u temp %dF -> %dF", (unsigned)it.id, st.targetF, tempF);
+    m_act.setTempF((float)tempF);
+    m_stats.reconcileWrites++;
+  }
+  if (fanDiff) {
+    if (tempDiff) m_act.pauseMs(60);
+    logf("[SCHED] reconcile id=%u fan %u -> %u", (unsigned)it.id, (unsigned)st.fanStep, (unsigned)fan);
+    m_act.setFan(fan);
+    m_stats.reconcileWrites++;
+  }
+  rampReset(rampStepIndex(it, nowMin, p.rampStepMin), tempF, fan);
+}
+
+// --------------------------- Resume ---------------------------
+void SchedulerCore::rememberApplied(uint16_t schedId, uint32_t itemHash) {
+  SchedResume r{};
+  r.schedId = schedId;
+  r.itemHash = itemHash;
+  r.appliedEpoch = m_clock.epochNow();
+  m_persist.saveResume(r);
+}
+
+// After a reboot (activeIndex == -1) check whether this exact block occurrence was
+// already applied before the reset. If so, adopt it instead of re-sending.
+bool SchedulerCore::resumeWithoutApply(const ScheduleItem& it, uint16_t nowMin) {
+  if (m_resumeChecked) return false;
+  m_resumeChecked = true;
+
+  SchedResume r{};
+  if (!m_persist.loadResume(r) || r.schedId == 0) return false;
+  if (r.schedId != it.id || r.itemHash != scheduleItemHash(it)) return false;
+
+  // The block occurrence we are in started at (now - elapsed); the apply must be newer.
+  uint32_t now = m_clock.epochNow();
+  uint32_t occurrenceStart = now - (uint32_t)schedMinutesSinceStart(nowMin, it.startMin) * 60u - 59u;
+  if (r.appliedEpoch < occurrenceStart || r.appliedEpoch > now) return false;
+
+  logf("[SCHED] Resuming schedule id=%u (applied %lus ago), not re-sending",
+       (unsigned)it.id, (unsigned long)(now - r.appliedEpoch));
+  return true;
+}
+
+// --------------------------- Tick ---------------------------
+void SchedulerCore::tick(const ScheduleItem* items, int count, int& activeIndex, const SchedParams& p) {
+  if (!m_clock.timeValid()) return;
+
+  // Pause = do not execute schedules; BedJet remains in its current state until resumed.
+  if (p.paused) return;
+
+  uint16_t nowMin = 0;
+  uint8_t wday = 0;
+  uint16_t dayNum = 0;
+  if (!m_clock.localNow(nowMin, wday, dayNum)) return;
+  int desired = schedPickActiveIndex(items, count, nowMin, wday, dayNum);
+
+  // DST fall-back repeats an hour of local time; a block occurrence that already reached its
+  // stop time must not fire a second time in the repeated hour. Whatever it was layered over
+  // (e.g. an override inside a night block) stays in charge instead.
+  if (desired >= 0 && desired != activeIndex) {
+    const ScheduleItem& it = items[desired];
+    if (it.id == m_doneId && scheduleItemHash(it) == m_doneHash &&
+        schedOccurrenceDay(it, nowMin, dayNum) == m_doneDay) {
+      desired = schedPickActiveIndex(items, count, nowMin, wday, dayNum, desired);
+    }
+  }
+
+  if (desired == activeIndex) {
+    if (desired >= 0) {
+      rampTick(items[desired], nowMin, p);
+      reconcileTick(items[desired], nowMin, p);
+    }
+    return;
+  }
+
+  // Leaving a block because its own window ended (not because another item took over)
+  if (activeIndex >= 0 && activeIndex < count) {
+    const ScheduleItem& prev = items[activeIndex];
+    if (!schedWithinBlock(nowMin, prev.startMin, prev.stopMin)) {
+      m_doneId = prev.id;
+      m_doneHash = scheduleItemHash(prev);
+      m_doneDay = m_activeDay;
+    }
+  }
+
+  reconcileReset();
+
+  if (desired < 0) {
+    if (activeIndex >= 0) {
+      m_act.ensureConnected();
+      m_act.button(BTN_OFF);
+      rememberApplied(0, 0);
+      m_stats.transitions++;
+    }
+    activeIndex = -1;
+    return;
+  }
+
+  const ScheduleItem& it = items[desired];
+  if (activeIndex < 0 && resumeWithoutApply(it, nowMin)) {
+    activeIndex = desired;
+    m_stats.transitions++;
+    m_activeDay = schedOccurrenceDay(it, nowMin, dayNum);
+    return;
+  }
+
+  if (apply(it, nowMin, p)) {
+    activeIndex = desired;
+    m_stats.transitions++;
+    m_activeDay = schedOccurrenceDay(it, nowMin, dayNum);
+    rememberApplied(it.id, scheduleItemHash(it));
+  }
+}
@@ -0,0 +1,176 @@
+#pragma once
+// Scheduler core: plain C++ with no Arduino / NimBLE / ESP-IDF includes, so the same code
+// that runs on the ESP32 can be driven on a host with a virtual clock. Everything device
+// specific sits behind SchedClock / SchedActuator / SchedPersist (firmware adapters live in
+// AppScheduler.cpp).
+#include <stdint.h>
+#include <stddef.h>
+
+static const int MAX_SCHEDULE = 16;
+
+// Day-of-week mask bits (bit0 = Sunday .. bit6 = Saturday, matches tm_wday)
+static const uint8_t DAYS_ALL      = 0x7F;
+static const uint8_t DAYS_WEEKDAYS = 0x3E;
+static const uint8_t DAYS_WEEKEND  = 0x41;
+
+struct ScheduleItem {
+  uint16_t id;
+  uint8_t  modeButton;   // BedjetButton
+  uint8_t  fanStep;      // 0..19
+  float    tempF;
+  uint16_t startMin;     // minutes from midnight local (0..1439)
+  uint16_t stopMin;      // minutes from midnight local (0..1439)
+  bool     enabled;
+  uint8_t  daysMask;     // days the block may *start* on (DAYS_ALL = every day)
+  uint16_t fromDay;      // first active local date, days since 1970-01-01 (0 = no limit)
+  uint16_t toDay;        // last active local date, inclusive (0 = no limit)
+  bool     isOverride;   // one-off override layer: wins over regular items on its dates
+  uint8_t  rampToTempF;  // ramp target °F reached at the end of the ramp (0 = no temp ramp)
+  uint8_t  rampToFan;    // ramp target fan step (RAMP_FAN_NONE = no fan ramp)
+  uint16_t rampMinutes;  // ramp length from block start (0 = whole block)
+};
+
+static const uint8_t RAMP_FAN_NONE = 0xFF;
+
+// BedJet commands/buttons
+enum BedjetButton : uint8_t {
+  BTN_OFF   = 0x01,
+  BTN_COOL  = 0x02,
+  BTN_HEAT  = 0x03,
+  BTN_TURBO = 0x04,
+  BTN_DRY   = 0x05,
+  BTN_EXTHT = 0x06
+};
+
+// Fan steps (BedJet reports 0..19)
+static constexpr uint8_t FAN_MIN = 0;
+static constexpr uint8_t FAN_MAX = 19;
+
+// Decoded view of the latest status frame (see bleStatusSummary() for the byte layout)
+struct BedjetStatus {
+  uint8_t  modeButton;    // BedjetButton equivalent of the reported mode
+  uint8_t  fanStep;       // 0..19
+  int      targetF;       // set temperature, whole °F
+  int      airF;          // actual air temperature, whole °F
+  uint16_t remainingMin;  // runtime left (hours*60 + minutes)
+  uint32_t ageMs;         // age of the frame
+};
+
+// Last schedule block actually applied to the BedJet (see saveResumeState()).
+struct SchedResume {
+  uint16_t schedId;       // 0 = nothing applied / last transition was OFF
+  uint32_t itemHash;      // scheduleItemHash() of the item when it was applied
+  uint32_t appliedEpoch;  // UTC epoch seconds of the apply
+};
+
+// Tunables taken from RuntimeConfig on every tick
+struct SchedParams {
+  bool     paused;
+  uint8_t  rampStepMin;
+  uint16_t reconcileSec;
+  uint8_t  reconcileTolF;
+  uint8_t  reconcileHyst;
+};
+
+struct SchedStats {
+  uint32_t reconcileChecks;     // reconciler compared status vs desired state
+  uint32_t reconcileNoops;      // ...and found nothing to send
+  uint32_t reconcileWrites;     // individual fan/temp correction writes
+  uint32_t reconcileReapplies;  // full re-apply (mode drift / BedJet power cycle)
+  uint32_t transitions;         // active block changes (including to/from "none")
+};
+
+// --------------------------- Interfaces ---------------------------
+class SchedClock {
+ public:
+  virtual ~SchedClock() {}
+  virtual bool timeValid() = 0;
+  // Local wall clock: minute of day, weekday (0 = Sun), days since 1970-01-01
+  virtual bool localNow(uint16_t& minOfDay, uint8_t& wday, uint16_t& dayNum) = 0;
+  virtual uint32_t epochNow() = 0;   // UTC seconds
+  virtual uint32_t monoMs() = 0;     // monotonic milliseconds
+};
+
+class SchedActuator {
+ public:
+  virtual ~SchedActuator() {}
+  virtual bool ensureConnected() = 0;
+  virtual bool isConnected() = 0;
+  virtual bool getStatus(BedjetStatus& out) = 0;  // false if no fresh status frame
+  virtual bool setClockNow() = 0;
+  virtual bool button(uint8_t btn) = 0;
+  virtual bool setModeSmart(uint8_t btn) = 0;
+  virtual bool setFan(uint8_t step) = 0;
+  virtual bool setTempF(float tempF) = 0;
+  virtual bool setRuntimeMinutes(uint16_t minutes) = 0;
+  virtual void pauseMs(uint32_t ms) = 0;          // spacing between BLE writes
+  virtual void log(const char* msg) = 0;
+};
+
+class SchedPersist {
+ public:
+  virtual ~SchedPersist() {}
+  virtual bool loadResume(SchedResume& out) = 0;
+  virtual void saveResume(const SchedResume& r) = 0;
+};
+
+// --------------------------- Pure helpers ---------------------------
+bool     schedWithinBlock(uint16_t nowMin, uint16_t startMin, uint16_t stopMin);
+uint16_t schedDurationMinutes(uint16_t startMin, uint16_t stopMin);
+uint16_t schedMinutesUntilStop(uint16_t nowMin, uint16_t stopMin);
+uint16_t schedMinutesSinceStart(uint16_t nowMin, uint16_t startMin);
+// Local date the current occurrence of a block started on (previous day in a wrap tail)
+uint16_t schedOccurrenceDay(const ScheduleItem& it, uint16_t nowMin, uint16_t dayNum);
+bool     schedActiveOnDay(const ScheduleItem& it, uint16_t nowMin, uint8_t wday, uint16_t dayNum);
+// skip = index to leave out (-1 = none)
+int      schedPickActiveIndex(const ScheduleItem* items, int count, uint16_t nowMin, uint8_t wday, uint16_t dayNum,
+                              int skip = -1);
+bool     schedHasRamp(const ScheduleItem& it);
+void     schedRampSetpoint(const ScheduleItem& it, uint16_t nowMin, uint8_t stepMin, int& outTempF, uint8_t& outFan);
+
+// Fingerprint of the fields that affect what is sent to the BedJet (used for resume-after-reboot).
+uint32_t scheduleItemHash(const ScheduleItem& it);
+
+// --------------------------- Scheduler ---------------------------
+class SchedulerCore {
+ public:
+  SchedulerCore(SchedClock& clock, SchedActuator& act, SchedPersist& persist, SchedStats& stats);
+
+  // One scheduler step. activeIndex is the caller-owned index of the applied block (-1 = none).
+  void tick(const ScheduleItem* items, int count, int& activeIndex, const SchedParams& p);
+
+  // Manual command while a block is active: stop reconciling until the next transition.
+  void noteManualCommand(int activeIndex);
+
+ private:
+  bool apply(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p);
+  void rampTick(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p);
+  void rampReset(int step, int tempF, int fan);
+  void reconcileTick(const ScheduleItem& it, uint16_t nowMin, const SchedParams& p);
+  void reconcileReset();
+  bool resumeWithoutApply(const ScheduleItem& it, uint16_t nowMin);
+  void rememberApplied(uint16_t schedId, uint32_t itemHash);
+  void logf(const char* fmt, ...);
+
+  SchedClock& m_clock;
+  SchedActuator& m_act;
+  SchedPersist& m_persist;
+  SchedStats& m_stats;
+
+  bool     m_resumeChecked = false;
+
+  // Block occurrence that already ran to its stop time (guards DST fall-back repeats)
+  uint16_t m_doneId = 0;
+  uint32_t m_doneHash = 0;
+  uint16_t m_doneDay = 0;
+  uint16_t m_activeDay = 0;
+
+  int      m_rampStep = -1;      // ramp step (see rampStepIndex()) of the last write/check
+  int      m_rampSentTempF = -1;
+  int      m_rampSentFan = -1;
+
+  uint32_t m_recLastCheckMs = 0;
+  uint8_t  m_recDriftCount = 0;
+  uint8_t  m_recRetries = 0;
+  bool     m_manualHold = false;
+};
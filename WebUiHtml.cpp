@@ -144,6 +144,13 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
   select.qcSelect{ width:5.4em; min-width:0; }
   .mini{ font-size:12px; color:var(--muted); margin-top:6px; }
   .timegrid{ display:grid; grid-template-columns:1fr 1fr 1fr; gap:10px; }
+  .daygrid{ display:grid; grid-template-columns:repeat(7,1fr); gap:6px; }
+  .daychk{
+    display:flex; flex-direction:column; align-items:center; gap:4px; margin:0;
+    padding:6px 0; border-radius:10px; border:1px solid var(--inputBorder); background:var(--inputBg);
+    font-size:12px; font-weight:850; color:var(--text); cursor:pointer;
+  }
+  .daychk input{ width:auto; margin:0; }
 
   /* Desktop schedule table */
   .tablewrap{ overflow-x:auto; -webkit-overflow-scrolling:touch; border-radius:12px; }
@@ -228,6 +235,10 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
   }
   @keyframes spin{ to{ transform: rotate(360deg);} }
 
+  /* Painted from the local copy; cleared once the device answers */
+  body.stale .card{ opacity:.6; }
+  body.stale #timeNow::after{ content:" (cached)"; color:var(--muted); }
+
 </style>
 </head>
 <body>
@@ -320,11 +331,21 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
       </div>
     </div>
 
+    <!-- Multi-edit: shown while items are selected -->
+    <div id="bulkBar" class="inline" style="display:none; margin-top:10px;">
+      <span id="bulkCount" class="mini" style="margin-top:0;"></span>
+      <button class="btn" onclick="bulkEdit('enable', this)">ENABLE</button>
+      <button class="btn" onclick="bulkEdit('disable', this)">DISABLE</button>
+      <button class="btn" style="border-color:rgba(255,59,77,.32); background:rgba(255,59,77,.14);" onclick="bulkEdit('delete', this)">DELETE</button>
+      <button class="btn" onclick="clearSel()">CLEAR</button>
+    </div>
+
     <!-- Desktop grid -->
     <div class="tablewrap">
       <table>
         <thead>
           <tr>
+            <th style="width:36px;"></th>
             <th style="width:70px;">Run</th>
             <th style="width:60px;">#</th>
             <th>Mode</th>
@@ -332,6 +353,7 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
             <th>Fan</th>
             <th>Start</th>
             <th>Stop</th>
+            <th>Days</th>
             <th>Enabled</th>
             <th style="width:110px; text-align:right;">Actions</th>
           </tr>
@@ -361,7 +383,8 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
   </div>
 
   <div class="mini" style="margin-top:8px;">
-    Export downloads a JSON file. Import expects the same JSON format and will <b>REPLACE</b> the current schedule.
+    Export downloads a JSON file. Import expects the same JSON format. <b>Replace</b> makes the file the new schedule;
+    <b>Merge</b> adds new items and updates items with the same ID, keeping the rest.
   </div>
 
   <div class="formrow" style="margin-top:10px;">
@@ -380,7 +403,9 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
   </div>
 
   <div class="inline" style="justify-content:flex-end; margin-top:12px;">
-    <button class="btn primary" onclick="importReplace(this)">Import (Replace)</button>
+    <label class="mini" style="margin:0 auto 0 0;"><input type="checkbox" id="impPrune"/> Merge: remove items not in the file</label>
+    <button class="btn" onclick="importSchedule(this, 'merge')">Import (Merge)</button>
+    <button class="btn primary" onclick="importSchedule(this, 'replace')">Import (Replace)</button>
     <button class="btn" onclick="closeImp()">Cancel</button>
   </div>
 </dialog>
@@ -453,6 +478,52 @@ const char INDEX_HTML[] PROGMEM = R"BEDJET_HTML(
     </div>
   </div>
 
+  <div class="formrow">
+    <div style="flex:1;">
+      <label>Days (block start day)</label>
+      <div class="daygrid" id="dayGrid"></div>
+    </div>
+  </div>
+
+  <div class="formrow">
+    <div class="half">
+      <label>From date (optional)</label>
+      <input id="fromDate" type="date"/>
+    </div>
+    <div class="half">
+      <label>To date (optional)</label>
+      <input id="toDate" type="date"/>
+    </div>
+  </div>
+
+  <div class="formrow">
+    <div class="half">
+      <label>Ramp to Temp (°F, optional)</label>
+      <input id="rampTempInp" inputmode="numeric" placeholder="e.g. 80"/>
+    </div>
+    <div class="half">
+      <label>Ramp to Fan (0-19, optional)</label>
+      <input id="rampFanInp" inputmode="numeric" placeholder="e.g. 5"/>
+    </div>
+  </div>
+  <div class="formrow">
+    <div style="flex:1;">
+      <label>Ramp over (minutes from start)</label>
+      <input id="rampMinInp" inputmode="numeric" placeholder="blank = whole block"/>
+      <div class="mini">Temp/fan move gradually from the values above to the ramp targets.</div>
+    </div>
+  </div>
+
+  <div class="formrow">
+    <div style="flex:1;">
+      <label>One-off override</label>
+      <select id="overrideSel">
+        <option value="0" selected>No</option>
+        <option value="1">Yes — replaces other items on these dates</option>
+      </select>
+    </div>
+  </div>
+
   <div class="inline" style="justify-content:flex-end; margin-top:12px;">
     <button class="btn primary" onclick="saveSchedule()">Save</button>
     <button class="btn" onclick="closeDlg()">Cancel</button>
@@ -527,53 +598,86 @@ function minutesToSelectors(mins, prefix){
   document.getElementById(prefix+"Ampm").value = ampm;
 }
 
-function renderScheduleTable(){
-  const rowsEl=document.getElementById("rows");
-  rowsEl.innerHTML = (state.schedule||[]).map((s,i)=>`
-    <tr>
+const DAY_NAMES=["Su","Mo","Tu","We","Th","Fr","Sa"];
+
+function daysLabel(s){
+  const m = (s.days==null) ? 127 : Number(s.days);
+  let txt;
+  if(m===127) txt="Every day";
+  else if(m===0x3E) txt="Weekdays";
+  else if(m===0x41) txt="Weekends";
+  else txt=DAY_NAMES.filter((_,i)=>m & (1<<i)).join(" ");
+  if(s.from || s.to){
+    txt += " • " + (s.from===s.to ? s.from : ((s.from||"…")+" → "+(s.to||"…")));
+  }
+  if(s.override) txt = "Override • " + txt;
+  return txt;
+}
+
+function tempLabel(s){
+  return (s.rampTempF ? (s.tempF+"→"+s.rampTempF) : String(s.tempF)) + "°F";
+}
+function fanLabel(s){
+  return (s.rampFan!=null && s.rampFan>=0) ? (s.fan+"→"+s.rampFan) : String(s.fan);
+}
+
+function fillDayGrid(mask){
+  const g=document.getElementById("dayGrid");
+  g.innerHTML = DAY_NAMES.map((n,i)=>
+    `<label class="daychk">${n}<input type="checkbox" id="day${i}" ${(mask & (1<<i))?"checked":""}/></label>`).join("");
+}
+
+function readDayMask(){
+  let m=0;
+  for(let i=0;i<7;i++){ if(document.getElementById("day"+i).checked) m |= (1<<i); }
+  return m;
+}
+
+function selBox(s){
+  return `<input type="checkbox" data-sel="${s.id}" ${selected.has(s.id)?"checked":""} onchange="toggleSel(${s.id}, this.checked)"/>`;
+}
+
+function rowHtml(s,i){
+  return `
+      <td>${selBox(s)}</td>
       <td>
         <button class="iconbtn" title="Run now" onclick="runOne(${s.id}, this)">▶</button>
       </td>
       <td>${i+1}</td>
       <td>${s.mode}</td>
-      <td>${s.tempF}°F</td>
-      <td>${s.fan}</td>
+      <td>${tempLabel(s)}</td>
+      <td>${fanLabel(s)}</td>
       <td>${s.start}</td>
       <td>${s.stop}</td>
+      <td>${daysLabel(s)}</td>
       <td>${s.enabled ? "Yes":"No"}</td>
       <td style="text-align:right;">
         <div class="iconrow">
           <button class="iconbtn" title="Edit" onclick="openEdit(${s.id})">✎</button>
           <button class="iconbtn danger" title="Delete" onclick="deleteOne(${s.id})">🗑</button>
         </div>
-      </td>
-    </tr>`).join("");
+      </td>`;
 }
 
-function renderScheduleCards(){
-  const cards=document.getElementById("cards");
-  const sched = state.schedule || [];
-  if(!sched.length){
-    cards.innerHTML = `<div class="scard"><div class="scardTitle">No schedule items</div>
-                       <div class="sub" style="margin-top:6px;">Tap ADD to create one.</div></div>`;
-    return;
-  }
-  cards.innerHTML = sched.map((s,i)=>`
-    <div class="scard">
+function cardHtml(s,i){
+  return `
       <div class="scardTop">
-        <div class="scardTitle">Schedule #${i+1} <span style="color:var(--muted); font-weight:800;">(ID ${s.id})</span></div>
+        <div class="scardTitle">${selBox(s)} Schedule #${i+1} <span style="color:var(--muted); font-weight:800;">(ID ${s.id})</span></div>
         <div class="badge ${s.enabled?'on':''}">${s.enabled?'Enabled':'Disabled'}</div>
       </div>
 
       <div class="scardGrid">
         <div class="scRow">
         <div class="scItem"><span class="scK">Mode</span><span class="scV">${s.mode}</span></div>
-        <div class="scItem"><span class="scK">Temp / Fan</span><span class="scV">${s.tempF}°F • ${s.fan}</span></div>
+        <div class="scItem"><span class="scK">Temp / Fan</span><span class="scV">${tempLabel(s)} • ${fanLabel(s)}</span></div>
       </div>
       <div class="scRow">
         <div class="scItem"><span class="scK">Start</span><span class="scV">${s.start}</span></div>
         <div class="scItem"><span class="scK">Stop</span><span class="scV">${s.stop}</span></div>
       </div>
+      <div class="scRow">
+        <div class="scItem"><span class="scK">Days</span><span class="scV">${daysLabel(s)}</span></div>
+      </div>
       </div>
 
       <div class="scActions">
@@ -582,54 +686,264 @@ function renderScheduleCards(){
           <button class="btn" onclick="openEdit(${s.id})">Edit</button>
           <button class="btn" style="border-color:rgba(255,59,77,.32); background:rgba(255,59,77,.14);" onclick="deleteOne(${s.id})">Delete</button>
         </div>
-      </div>
-    </div>`).join("");
+      </div>`;
 }
 
+// Keyed rendering: one <tr> + one card per schedule id, rebuilt only when the item's
+// rev (CRC of its stored record) or its position changes. Unchanged rows keep their DOM.
+const rowCache=new Map();   // id -> {rev, idx, tr, card}
+let emptyCard=null;
+
+function renderSchedule(sched){
+  const rowsEl=document.getElementById("rows");
+  const cardsEl=document.getElementById("cards");
+  const seen=new Set();
+  let touched=0;
+
+  if(!emptyCard){
+    emptyCard=document.createElement("div");
+    emptyCard.className="scard";
+    emptyCard.innerHTML=`<div class="scardTitle">No schedule items</div>
+                       <div class="sub" style="margin-top:6px;">Tap ADD to create one.</div>`;
+  }
+  if(sched.length) emptyCard.remove();
+
+  sched.forEach((s,i)=>{
+    let e=rowCache.get(s.id);
+    if(!e){
+      e={rev:null, idx:-1, tr:document.createElement("tr"), card:document.createElement("div")};
+      e.card.className="scard";
+      rowCache.set(s.id,e);
+    }
+    if(e.rev!==s.rev || e.idx!==i){
+      e.tr.innerHTML=rowHtml(s,i);
+      e.card.innerHTML=cardHtml(s,i);
+      e.rev=s.rev; e.idx=i;
+      touched++;
+    }
+    if(rowsEl.children[i]!==e.tr) rowsEl.insertBefore(e.tr, rowsEl.children[i]||null);
+    if(cardsEl.children[i]!==e.card) cardsEl.insertBefore(e.card, cardsEl.children[i]||null);
+    seen.add(s.id);
+  });
+
+  for(const [id,e] of rowCache){
+    if(seen.has(id)) continue;
+    e.tr.remove(); e.card.remove();
+    rowCache.delete(id);
+    selected.delete(id);
+    touched++;
+  }
+  updateBulkBar();
+
+  if(!sched.length && emptyCard.parentNode!==cardsEl) cardsEl.appendChild(emptyCard);
+  return touched;
+}
+
+// Only write the DOM when the value actually changed.
+function setText(id, v){
+  const el=document.getElementById(id);
+  if(el && el.textContent!==v) el.textContent=v;
+}
+function setHtml(id, v){
+  const el=document.getElementById(id);
+  if(el && el._html!==v){ el.innerHTML=v; el._html=v; }
+}
+
+let renderedRev=null;
+
 function render(){
   if(!state) return;
 
-  document.getElementById("dev").textContent = state.device_name || "-";
-  document.getElementById("mac").textContent = state.device_mac || "-";
-  document.getElementById("ip").textContent  = state.ip || "-";
-  document.getElementById("timeNow").textContent = state.time || "-";
+  setText("dev", state.device_name || "-");
+  setText("mac", state.device_mac || "-");
+  setText("ip", state.ip || "-");
+  setText("timeNow", state.time || "-");
 
-  document.getElementById("ntp").innerHTML = state.time_valid ? pill(true,"Synced") : pill(false,"Not Synced");
-  document.getElementById("ble").innerHTML = state.ble_connected ? pill(true,"Connected") : pill(false,"Disconnected");
+  const restored = state.time_valid && state.ntp_synced===false;
+  setHtml("ntp", !state.time_valid ? pill(false,"Not Synced") : (restored ? pill(true,"Restored") : pill(true,"Synced")));
+  setHtml("ble", state.ble_connected ? pill(true,"Connected") : pill(false,"Disconnected"));
 
   const tz = (state.tz_offset_sec!=null) ? String(state.tz_offset_sec) : "-";
-  document.getElementById("tz").textContent = tz;
+  setText("tz", tz);
 
   const act = state.active_schedule_id || 0;
-  document.getElementById("schedState").textContent = (state.sched_paused ? "[PAUSED] " : "") + (act ? ("Running schedule ID: "+act) : "Not in a scheduled block");
-  document.getElementById("status").textContent = state.status_summary || "-";
+  setText("schedState", (state.sched_paused ? "[PAUSED] " : "") + (act ? ("Running schedule ID: "+act) : "Not in a scheduled block"));
+  setText("status", state.status_summary || "-");
 
   const pb = document.getElementById("pauseBtn");
   if(pb){
     const paused = !!state.sched_paused;
-    pb.textContent = paused ? "RESUME" : "PAUSE";
+    setText("pauseBtn", paused ? "RESUME" : "PAUSE");
     pb.classList.toggle("danger", paused);
   }
 
+  if(state.sched_rev!==renderedRev){
+    renderSchedule(state.schedule||[]);
+    renderedRev=state.sched_rev;
+  }
+}
+
+// One poller per browser: tabs elect a leader over BroadcastChannel. The leader polls
+// /api/state and fans each result out; the others only render what they receive. Hidden
+// tabs never lead, so with every tab in the background nothing polls at all.
+const TAB_ID = Date.now().toString(36) + Math.random().toString(36).slice(2);
+const bc = ("BroadcastChannel" in window) ? new BroadcastChannel("bedjet-state") : null;
+const LEADER_TIMEOUT_MS = 5000;
+let isLeader = !bc;
+let leaderSeenMs = 0;
+let claimMs = 0;
+
+function applyState(s){
+  if(!s.schedule && state && s.sched_rev===state.sched_rev) s.schedule=state.schedule;
+  state=s;
+  document.body.classList.remove("stale");
+  render();
+}
+
+// Last state kept in localStorage so a reload paints at once (marked stale) instead of
+// waiting for a busy device. Rewritten when the schedule changes, otherwise every 30 s.
+const CACHE_KEY="bedjet.state";
+let cacheSavedMs=0, cacheSavedRev=null, cachedUi=null;
+
+function loadCachedState(){
+  try{
+    const c=JSON.parse(localStorage.getItem(CACHE_KEY)||"null");
+    if(!c || !c.state) return;
+    cachedUi=c.ui;
+    state=c.state;
+    document.body.classList.add("stale");
+    render();
+  } catch(e){
+    state=null;
+    try{ localStorage.removeItem(CACHE_KEY); }catch(_){}
+  }
+}
+
+function saveCachedState(){
+  const now=Date.now();
+  // A different ui_hash means new firmware: replace the old copy right away.
+  if(state.ui_hash===cachedUi && state.sched_rev===cacheSavedRev && now-cacheSavedMs<30000) return;
+  cacheSavedMs=now; cacheSavedRev=state.sched_rev; cachedUi=state.ui_hash;
+  try{ localStorage.setItem(CACHE_KEY, JSON.stringify({ui:state.ui_hash, state})); }catch(e){}
+}
+
+// Service workers need a secure context (https or localhost); on plain http the shell is
+// still revalidated cheaply through its ETag.
+if("serviceWorker" in navigator && window.isSecureContext){
+  navigator.serviceWorker.register("/sw.js").catch(()=>{});
+  navigator.serviceWorker.addEventListener("message", ev=>{
+    if(!ev.data || ev.data.t!=="ui-updated") return;
+    try{ localStorage.removeItem(CACHE_KEY); }catch(e){}
+    if(!document.querySelector("dialog[open]")) location.reload();
+  });
+}
+
+if(bc){
+  bc.onmessage = (ev)=>{
+    const m = ev.data || {};
+    if(m.t==="state"){
+      if(m.lead){
+        leaderSeenMs=Date.now(); claimMs=0;
+        if(isLeader && m.from<TAB_ID) isLeader=false;   // two leaders: lower id wins
+      }
+      if(m.state && !pendingEdits) applyState(m.state);
+    } else if(m.t==="claim"){
+      if(isLeader) bc.postMessage({t:"leader", from:TAB_ID});
+      else if(claimMs && m.from<TAB_ID) claimMs=0;
+    } else if(m.t==="leader"){
+      leaderSeenMs=Date.now(); claimMs=0;
+      if(isLeader && m.from<TAB_ID) isLeader=false;
+    } else if(m.t==="resign"){
+      leaderSeenMs=0;
+      pollTick();
+    }
+  };
+}
 
-  renderScheduleTable();
-  renderScheduleCards();
+function pollTick(){
+  if(document.hidden) return;
+  if(isLeader){ refresh(); return; }
+  const now=Date.now();
+  if(claimMs){
+    // Nobody objected within one tick: take over.
+    if(now-claimMs >= 1500){ claimMs=0; isLeader=true; refresh(); }
+    return;
+  }
+  if(now-leaderSeenMs > LEADER_TIMEOUT_MS){
+    claimMs=now;
+    bc.postMessage({t:"claim", from:TAB_ID});
+  }
 }
 
+document.addEventListener("visibilitychange", ()=>{
+  if(document.hidden){
+    if(isLeader && bc){ isLeader=false; bc.postMessage({t:"resign", from:TAB_ID}); }
+  } else {
+    pollTick();
+  }
+});
+window.addEventListener("pagehide", ()=>{
+  if(isLeader && bc) bc.postMessage({t:"resign", from:TAB_ID});
+});
+
 let refreshInFlight=false;
 async function refresh(){
   if(document.hidden) return;
-  if(refreshInFlight) return;
+  if(refreshInFlight || pendingEdits) return;
   refreshInFlight=true;
   try{
-    const r=await fetch("/api/state",{cache:"no-store"});
-    state=await r.json();
-    render();
+    // With ?rev= the device leaves out "schedule" when our copy is still current.
+    const url = (state && state.schedule && typeof state.sched_rev==="number") ? ("/api/state?rev="+state.sched_rev) : "/api/state";
+    const r=await fetch(url,{cache:"no-store"});
+    applyState(await r.json());
+    saveCachedState();
+    if(bc) bc.postMessage({t:"state", from:TAB_ID, lead:isLeader, state});
   } finally {
     refreshInFlight=false;
   }
 }
 
+// /?bench=N: render N synthetic items and compare a full innerHTML rebuild with the keyed
+// path (initial build, one changed item, nothing changed). Polling is disabled in this mode.
+function benchItem(id, rev){
+  return {id, rev, mode:"HEAT", tempF:80+(id%20), fan:id%20, start:"10:00 PM", stop:"6:30 AM",
+          startMin:1320, stopMin:390, days:127, enabled:(id%3)!==0};
+}
+function benchTime(fn, reps){
+  const t=[];
+  for(let r=0;r<reps;r++){ const t0=performance.now(); fn(r); t.push(performance.now()-t0); }
+  t.sort((a,b)=>a-b);
+  return t[Math.floor(t.length/2)].toFixed(2)+" ms";
+}
+function runBench(n){
+  const reps=21;
+  const sched=[];
+  for(let i=0;i<n;i++) sched.push(benchItem(i+1, i+1));
+  const rowsEl=document.getElementById("rows");
+  const cardsEl=document.getElementById("cards");
+  const clear=()=>{ rowCache.clear(); rowsEl.innerHTML=""; cardsEl.innerHTML=""; };
+
+  const out=[];
+  out.push("items: "+n+", median of "+reps+" runs");
+  clear();
+  out.push("full rebuild:        "+benchTime(()=>{
+    rowsEl.innerHTML=sched.map((s,i)=>"<tr>"+rowHtml(s,i)+"</tr>").join("");
+    cardsEl.innerHTML=sched.map((s,i)=>'<div class="scard">'+cardHtml(s,i)+"</div>").join("");
+  }, reps));
+  out.push("keyed, cold:         "+benchTime(()=>{ clear(); renderSchedule(sched); }, reps));
+  clear(); renderSchedule(sched);
+  out.push("keyed, 1 changed:    "+benchTime(r=>{
+    const k=Math.floor(n/2);
+    sched[k]=Object.assign({}, sched[k], {rev:1000000+r, tempF:60+(r%40)});
+    renderSchedule(sched);
+  }, reps));
+  out.push("keyed, unchanged:    "+benchTime(()=>{ renderSchedule(sched); }, reps));
+
+  const st=document.getElementById("status");
+  if(st){ st.style.whiteSpace="pre"; st.textContent=out.join("\n"); }
+  console.log(out.join("\n"));
+}
+
 
 function setConnModal(msg, spinner=true, isError=false){
   const d=document.getElementById("connDlg");
@@ -655,6 +969,34 @@ async function doRefresh(el){
   finally { if(el) el.disabled = false; }
 }
 
+// BLE commands run on the device's control task and answer within ~100 ms: 202 "pending" with a
+// request id while it still works on it (e.g. a reconnect), polled here until it settles.
+async function ctlAwait(r){
+  let j = {};
+  try{ j = await r.json(); } catch(e){ return {ok:r.ok}; }
+  if(typeof j.ok !== "boolean") j.ok = r.ok;
+  const t0 = Date.now();
+  while(j.pending && j.req && Date.now() - t0 < 60000){
+    await new Promise(res=>setTimeout(res, 400));
+    let p;
+    try{ p = await (await fetch("/api/cmd/result?req=" + j.req)).json(); } catch(e){ continue; }
+    if(p.state === "pending") continue;
+    if(p.state === "unknown") break;
+    j = Object.assign({}, j, {pending:false, ok:p.state === "ok"});
+  }
+  return j;
+}
+
+// Still "pending" after ctlAwait (result lost or very slow) or "busy" = other commands queued.
+// Either way the next poll shows the result.
+function ctlNotice(j){
+  if(!j || (!j.pending && !j.busy)) return false;
+  setConnModal(j.pending ? "Still working on it (BedJet reconnecting)..." : "Busy, try again in a moment", false, !!j.busy);
+  refresh().catch(()=>{});
+  closeConnModal(1800);
+  return true;
+}
+
 async function bleConnect(el){
   pushBtn(el);
   if(el) el.disabled = true;
@@ -662,13 +1004,9 @@ async function bleConnect(el){
 
   try{
     const r = await fetch("/api/ble/connect",{method:"POST"});
-    let ok = r.ok;
-    try{
-      const j = await r.json();
-      if(typeof j.ok === "boolean") ok = j.ok;
-    } catch(e){ /* ignore */ }
-
-    if(ok){
+    const j = await ctlAwait(r);
+    if(ctlNotice(j)) return;
+    if(j.ok){
       setConnModal("Connected", false, false);
       await refresh();
       closeConnModal(450);
@@ -690,7 +1028,7 @@ async function bleDisconnect(el){
   pushBtn(el);
   if(el) el.disabled = true;
   try{
-    await fetch("/api/ble/disconnect",{method:"POST"});
+    await ctlAwait(await fetch("/api/ble/disconnect",{method:"POST"}));
   } finally {
     if(el) el.disabled = false;
     await refresh();
@@ -779,7 +1117,7 @@ async function exportSchedule(el){
   }
 }
 
-async function importReplace(el){
+async function importSchedule(el, mode){
   pushBtn(el);
   if(el) el.disabled=true;
   try{
@@ -788,17 +1126,26 @@ async function importReplace(el){
     if(!body.length){ setImpMsg("Paste JSON or choose a file first.", true); return; }
 
     setImpMsg("Importing...", false);
-    const r = await fetch("/api/schedule/import", {method:"POST", body});
+    let url = "/api/schedule/import";
+    if(mode==="merge"){
+      const prune = document.getElementById("impPrune");
+      url += "?mode=merge" + (prune && prune.checked ? "&prune=1" : "");
+    }
+    const r = await fetch(url, {method:"POST", body});
     if(!r.ok){
       setImpMsg("Import failed: "+await r.text(), true);
       return;
     }
     let j=null;
     try{ j = await r.json(); }catch(e){}
-    const n = j && typeof j.count === "number" ? j.count : null;
-    setImpMsg("Imported "+(n!==null? n : "schedule")+" item(s).", false);
+    if(j && j.mode==="merge"){
+      setImpMsg("Merged: "+j.added+" added, "+j.changed+" changed, "+j.removed+" removed, "+j.unchanged+" unchanged.", false);
+    } else {
+      const n = j && typeof j.count === "number" ? j.count : null;
+      setImpMsg("Imported "+(n!==null? n : "schedule")+" item(s).", false);
+    }
     await refresh();
-    setTimeout(()=>closeImp(), 650);
+    setTimeout(()=>closeImp(), mode==="merge" ? 2000 : 650);
   } catch(e){
     setImpMsg("Import failed.", true);
   } finally {
@@ -846,13 +1193,9 @@ async function btn(name, el){
     await new Promise(r => setTimeout(r, 80));
 
     const r = await fetch("/api/cmd/button?" + qs.toString(), {method:"POST"});
-    let ok = r.ok;
-    try{
-      const j = await r.json();
-      if(typeof j.ok === "boolean") ok = j.ok;
-    } catch(e){ /* ignore */ }
-
-    if(ok){
+    const j = await ctlAwait(r);
+    if(ctlNotice(j)) return;
+    if(j.ok){
       setConnModal(name + " applied", false, false);
       await refresh();
       closeConnModal(450);
@@ -878,6 +1221,13 @@ function openAdd(){
   document.getElementById("fanInp").value = "10";
   document.getElementById("tempInp").value = "90";
   document.getElementById("enabledSel").value = "1";
+  fillDayGrid(127);
+  document.getElementById("fromDate").value = "";
+  document.getElementById("toDate").value = "";
+  document.getElementById("overrideSel").value = "0";
+  document.getElementById("rampTempInp").value = "";
+  document.getElementById("rampFanInp").value = "";
+  document.getElementById("rampMinInp").value = "";
   document.getElementById("dlg").showModal();
 }
 
@@ -899,11 +1249,130 @@ function openEdit(id){
     minutesToSelectors(Number(item.stopMin), "stop");
   }
 
+  fillDayGrid(item.days==null ? 127 : Number(item.days));
+  document.getElementById("fromDate").value = item.from || "";
+  document.getElementById("toDate").value = item.to || "";
+  document.getElementById("overrideSel").value = item.override ? "1" : "0";
+  document.getElementById("rampTempInp").value = item.rampTempF ? String(item.rampTempF) : "";
+  document.getElementById("rampFanInp").value = (item.rampFan!=null && item.rampFan>=0) ? String(item.rampFan) : "";
+  document.getElementById("rampMinInp").value = item.rampMin ? String(item.rampMin) : "";
+
   document.getElementById("dlg").showModal();
 }
 
 function closeDlg(){ document.getElementById("dlg").close(); }
 
+function fmtTime12(m){
+  const h24=Math.floor(m/60), mm=m%60;
+  let h=h24%12; if(h===0) h=12;
+  return h+":"+(mm<10?"0":"")+mm+" "+(h24>=12?"PM":"AM");
+}
+
+// Optimistic schedule edits: the change is rendered at once, then replaced by the item and
+// sched_rev from the reply (no follow-up /api/state). If the reply's revision is not the
+// next one, another client edited too and a full refresh resyncs. Failures roll back.
+let pendingEdits=0, localRev=0;
+
+function upsertLocal(sched, item, replaceId){
+  const i=sched.findIndex(x=>Number(x.id)===Number(replaceId));
+  if(i>=0) sched[i]=item; else sched.push(item);
+}
+function removeLocal(sched, id){
+  const i=sched.findIndex(x=>Number(x.id)===Number(id));
+  if(i>=0) sched.splice(i,1);
+}
+
+// localEdit(sched) applies the change to a copy now; reconcile(reply, sched) swaps in the
+// device's items once it answers.
+async function scheduleMutation(url, body, localEdit, reconcile){
+  if(!state) state={};
+  const prevSched=state.schedule || [];
+  const prevRev=state.sched_rev;
+  const expectRev=(typeof prevRev==="number") ? ((prevRev+1)>>>0) : null;
+
+  const sched=prevSched.slice();
+  localEdit(sched);
+  state.schedule=sched;
+  state.sched_rev="local"+(++localRev);
+  pendingEdits++;
+  render();
+
+  let ok=false, resync=false;
+  try{
+    const r=await fetch(url,{method:"POST",body});
+    if(!r.ok){
+      const t=await r.text();
+      let msg=t;
+      try{ const j=JSON.parse(t); if(j.error) msg=(j.failed!=null ? ("op "+(j.failed+1)+": ") : "")+j.error; }catch(_){}
+      throw new Error(msg);
+    }
+    const j=await r.json();
+    if(reconcile) reconcile(j, state.schedule);
+    if(j.sched_rev===expectRev) state.sched_rev=j.sched_rev;
+    else { state.sched_rev="local"+(++localRev); resync=true; }
+    render();
+    ok=true;
+  } catch(e){
+    state.schedule=prevSched;
+    state.sched_rev=prevRev;
+    render();
+    throw e;
+  } finally {
+    pendingEdits--;
+    if(resync) refresh();
+    else if(ok && !pendingEdits && typeof state.sched_rev==="number"){
+      saveCachedState();
+      if(bc) bc.postMessage({t:"state", from:TAB_ID, lead:isLeader, state});
+    }
+  }
+}
+
+// Multi-select: bulk enable/disable/delete go out as one /api/schedule/batch request
+// (all-or-nothing on the device, one flash write).
+const selected=new Set();
+
+function updateBulkBar(){
+  const bar=document.getElementById("bulkBar");
+  if(!bar) return;
+  bar.style.display = selected.size ? "flex" : "none";
+  setText("bulkCount", selected.size+" selected");
+}
+function toggleSel(id, on){
+  if(on) selected.add(id); else selected.delete(id);
+  document.querySelectorAll(`[data-sel="${id}"]`).forEach(el=>{ el.checked=on; });
+  updateBulkBar();
+}
+function clearSel(){
+  selected.clear();
+  document.querySelectorAll("[data-sel]").forEach(el=>{ el.checked=false; });
+  updateBulkBar();
+}
+
+async function bulkEdit(kind, el){
+  pushBtn(el);
+  const ids=(state && state.schedule ? state.schedule : []).map(x=>x.id).filter(id=>selected.has(id));
+  if(!ids.length) return;
+  if(kind==="delete" && !confirm("Delete "+ids.length+" schedule item(s)?")) return;
+
+  const ops = ids.map(id => kind==="delete" ? {op:"delete", id} : {op:"update", id, enabled: kind==="enable"});
+  if(el) el.disabled=true;
+  try{
+    await scheduleMutation("/api/schedule/batch", JSON.stringify({ops}),
+      sched=>{
+        ops.forEach(o=>{
+          if(o.op==="delete") removeLocal(sched, o.id);
+          else { const i=sched.findIndex(x=>x.id===o.id); if(i>=0) sched[i]=Object.assign({}, sched[i], {enabled:o.enabled, rev:"pending"}); }
+        });
+      },
+      (j, sched)=>{ (j.results||[]).forEach(r=>{ if(r.item) upsertLocal(sched, r.item, r.id); }); });
+    if(kind==="delete") clearSel();
+  } catch(e){
+    alert("Bulk "+kind+" failed: "+e.message);
+  } finally {
+    if(el) el.disabled=false;
+  }
+}
+
 async function saveSchedule(){
   const mode = document.getElementById("modeSel").value;
   const fan  = document.getElementById("fanInp").value;
@@ -924,22 +1393,44 @@ async function saveSchedule(){
   if(sMin===null || eMin===null){ alert("Invalid time selection"); return; }
   if(sMin===eMin){ alert("Start and Stop cannot be the same"); return; }
 
+  const days = readDayMask();
+  if(!days){ alert("Select at least one day"); return; }
+  const from = document.getElementById("fromDate").value || "";
+  const to = document.getElementById("toDate").value || "";
+  const override = document.getElementById("overrideSel").value;
+  if(override==="1" && !from){ alert("An override needs a from date"); return; }
+
   const editId = document.getElementById("editId").value.trim();
 
   let url = "/api/schedule/add";
-  const bodyObj = { mode, fan, temp, enabled, startMin:String(sMin), stopMin:String(eMin) };
+  const rampTemp = document.getElementById("rampTempInp").value.trim();
+  const rampFan = document.getElementById("rampFanInp").value.trim();
+  const rampMin = document.getElementById("rampMinInp").value.trim() || "0";
+
+  const bodyObj = { mode, fan, temp, enabled, startMin:String(sMin), stopMin:String(eMin),
+                    days:String(days), from, to, override, rampTemp, rampFan, rampMin };
 
   if(editId.length){
     url = "/api/schedule/update";
     bodyObj.id = editId;
   }
 
-  const body = new URLSearchParams(bodyObj);
-  const r = await fetch(url,{method:"POST",body});
-  if(!r.ok){ alert((editId.length?"Update":"Add")+" failed: "+await r.text()); return; }
+  const draft = { id: editId.length ? Number(editId) : -(++localRev), rev:"pending",
+                  mode, tempF:Number(temp), fan:Number(fan), startMin:sMin, stopMin:eMin,
+                  start:fmtTime12(sMin), stop:fmtTime12(eMin), days, from, to,
+                  override: override==="1", rampTempF: rampTemp ? Number(rampTemp) : 0,
+                  rampFan: rampFan.length ? Number(rampFan) : -1, rampMin:Number(rampMin),
+                  enabled: enabled==="1" };
 
   closeDlg();
-  await refresh();
+  try{
+    await scheduleMutation(url, new URLSearchParams(bodyObj),
+      sched=>upsertLocal(sched, draft, draft.id),
+      (j, sched)=>upsertLocal(sched, j.item, draft.id));
+  } catch(e){
+    alert((editId.length?"Update":"Add")+" failed: "+e.message);
+    document.getElementById("dlg").showModal();   // fields are still filled in
+  }
 }
 
 
@@ -981,7 +1472,9 @@ async function runOne(id, el){
   try{
     const body = new URLSearchParams({id:String(id)});
     const r = await fetch("/api/schedule/runOne",{method:"POST",body});
-    if(!r.ok){
+    const j = await ctlAwait(r);
+    if(ctlNotice(j)) return;
+    if(!j.ok){
       setConnModal("Schedule run failed", false, true);
       closeConnModal(1200);
       return;
@@ -1001,10 +1494,12 @@ async function runOne(id, el){
 
 async function deleteOne(id){
   if(!confirm("Delete schedule item "+id+"?")) return;
-  const body = new URLSearchParams({id:String(id)});
-  const r = await fetch("/api/schedule/deleteOne",{method:"POST",body});
-  if(!r.ok){ alert("Delete failed: "+await r.text()); return; }
-  await refresh();
+  try{
+    await scheduleMutation("/api/schedule/deleteOne", new URLSearchParams({id:String(id)}),
+      sched=>removeLocal(sched, id), null);
+  } catch(e){
+    alert("Delete failed: "+e.message);
+  }
 }
 
 
@@ -1026,11 +1521,55 @@ function initQuickRunSelects(){
 
 initQuickRunSelects();
 
-setInterval(refresh, 2000);
-refresh();
+const benchN = parseInt(new URLSearchParams(location.search).get("bench")||"0",10);
+if(benchN>0){
+  runBench(Math.min(benchN, 2000));
+} else {
+  loadCachedState();
+  setInterval(pollTick, 2000);
+  refresh();   // first paint; the election settles over the next ticks
+}
 </script>
 </body></html>
 
 )BEDJET_HTML";
 
 const size_t INDEX_HTML_LEN = sizeof(INDEX_HTML) - 1;
+
+// Service worker for the UI shell; /sw.js prepends `const V="<ui hash>";`.
+// Serves "/" from cache immediately and revalidates it in the background; API calls are
+// never intercepted. A new UI hash installs a new worker, which deletes the old cache.
+const char SW_JS[] PROGMEM = R"BEDJET_SW(
+const CACHE = "bedjet-ui-" + V;
+
+self.addEventListener("install", e=>{
+  e.waitUntil(caches.open(CACHE).then(c=>c.add("/")).then(()=>self.skipWaiting()));
+});
+
+self.addEventListener("activate", e=>{
+  e.waitUntil(caches.keys()
+    .then(ks=>Promise.all(ks.filter(k=>k.startsWith("bedjet-ui-") && k!==CACHE).map(k=>caches.delete(k))))
+    .then(()=>self.clients.claim()));
+});
+
+self.addEventListener("fetch", e=>{
+  const u = new URL(e.request.url);
+  if(e.request.method!=="GET" || u.origin!==location.origin || u.pathname!=="/") return;
+  e.respondWith(caches.open(CACHE).then(async c=>{
+    const hit = await c.match("/");
+    const net = fetch("/", {cache:"no-cache"}).then(async r=>{
+      if(r.ok){
+        const changed = hit && hit.headers.get("ETag")!==r.headers.get("ETag");
+        await c.put("/", r.clone());
+        if(changed){
+          const cl = await self.clients.matchAll();
+          cl.forEach(x=>x.postMessage({t:"ui-updated"}));
+        }
+      }
+      return r;
+    });
+    if(hit){ e.waitUntil(net.catch(()=>{})); return hit; }
+    return net;
+  }));
+});
+)BEDJET_SW";
@@ -3,3 +3,4 @@
 
 extern const char INDEX_HTML[] PROGMEM;
 extern const size_t INDEX_HTML_LEN;
+extern const char SW_JS[] PROGMEM;
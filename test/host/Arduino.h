@@ -0,0 +1,69 @@
+#pragma once
+// Just enough of the Arduino core for the firmware modules the host tests compile
+// (AppTime.cpp, AppStorage.cpp). Not a general replacement.
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+
+inline uint32_t millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+inline uint32_t micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+inline void delay(uint32_t) {}
+
+// FreeRTOS spinlock as a host spinlock
+struct portMUX_TYPE {
+  std::atomic_flag f = ATOMIC_FLAG_INIT;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+inline void portENTER_CRITICAL(portMUX_TYPE* m) { while (m->f.test_and_set(std::memory_order_acquire)) {} }
+inline void portEXIT_CRITICAL(portMUX_TYPE* m) { m->f.clear(std::memory_order_release); }
+
+class String {
+ public:
+  String() {}
+  String(const char* c) : m_s(c ? c : "") {}
+  String(const std::string& s) : m_s(s) {}
+  const char* c_str() const { return m_s.c_str(); }
+  size_t length() const { return m_s.size(); }
+  bool operator==(const String& o) const { return m_s == o.m_s; }
+  bool operator==(const char* o) const { return m_s == o; }
+  String& operator+=(const String& o) { m_s += o.m_s; return *this; }
+  String& operator+=(const char* o) { m_s += o; return *this; }
+
+ private:
+  std::string m_s;
+};
+
+// Serial output goes to stdout unless the test silences it.
+struct HostSerial {
+  bool quiet = false;
+  void printf(const char* fmt, ...) {
+    if (quiet) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+  }
+  void println(const char* s) { if (!quiet) puts(s); }
+  void println(const String& s) { println(s.c_str()); }
+};
+inline HostSerial Serial;
@@ -0,0 +1,104 @@
+#pragma once
+// In-memory NVS for host tests. All instances share one store (like the flash partition).
+// tearNextPut() makes the next putBytes() stop part-way, as if power failed mid-write;
+// failNextPut() makes it store nothing and return 0, as on a full partition.
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+ public:
+  enum Tear {
+    TEAR_KEEP_OLD_TAIL,   // first `keep` bytes new, rest still the old value
+    TEAR_ERASED_TAIL,     // first `keep` bytes new, rest erased (0xFF)
+    TEAR_TRUNCATED        // only `keep` bytes stored
+  };
+
+  static std::map<std::string, std::vector<uint8_t>>& store() {
+    static std::map<std::string, std::vector<uint8_t>> s;
+    return s;
+  }
+  static void reset() {
+    store().clear();
+    s_tearArmed = false;
+    s_failArmed = false;
+  }
+  static void tearNextPut(size_t keep, Tear mode) {
+    s_tearArmed = true;
+    s_tearKeep = keep;
+    s_tearMode = mode;
+  }
+  static bool tearPending() { return s_tearArmed; }
+  static void failNextPut() { s_failArmed = true; }
+  static bool failPending() { return s_failArmed; }
+
+  bool begin(const char* ns, bool readOnly = false) {
+    m_ns = ns;
+    m_open = true;
+    return true;
+  }
+  void end() { m_open = false; }
+
+  bool isKey(const char* key) { return store().count(k(key)) != 0; }
+  bool remove(const char* key) { return store().erase(k(key)) != 0; }
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    const uint8_t* b = (const uint8_t*)value;
+    std::vector<uint8_t> nv(b, b + len);
+    if (s_failArmed) {
+      s_failArmed = false;
+      return 0;
+    }
+    if (s_tearArmed) {
+      s_tearArmed = false;
+      std::vector<uint8_t> old = store()[k(key)];
+      size_t keep = s_tearKeep < len ? s_tearKeep : len;
+      if (s_tearMode == TEAR_TRUNCATED) {
+        nv.resize(keep);
+      } else {
+        for (size_t i = keep; i < len; i++) {
+          nv[i] = (s_tearMode == TEAR_KEEP_OLD_TAIL && i < old.size()) ? old[i] : 0xFF;
+        }
+      }
+      store()[k(key)] = nv;
+      return keep;   // the caller never sees this on a real power loss
+    }
+    store()[k(key)] = nv;
+    return len;
+  }
+  size_t getBytes(const char* key, void* buf, size_t maxLen) {
+    auto it = store().find(k(key));
+    if (it == store().end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+  size_t putUInt(const char* key, uint32_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint32_t getUInt(const char* key, uint32_t def = 0) { return getNum(key, def); }
+  size_t putUChar(const char* key, uint8_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint8_t getUChar(const char* key, uint8_t def = 0) { return getNum(key, def); }
+  bool getBool(const char* key, bool def = false) { return getNum<uint8_t>(key, def) != 0; }
+  String getString(const char* key, const String& def = String()) {
+    auto it = store().find(k(key));
+    if (it == store().end()) return def;
+    return String(std::string(it->second.begin(), it->second.end()));
+  }
+
+ private:
+  std::string k(const char* key) const { return m_ns + "/" + key; }
+
+  template <typename T>
+  T getNum(const char* key, T def) {
+    T v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+  }
+
+  std::string m_ns;
+  bool m_open = false;
+
+  static inline bool   s_failArmed = false;
+  static inline bool   s_tearArmed = false;
+  static inline size_t s_tearKeep = 0;
+  static inline Tear   s_tearMode = TEAR_KEEP_OLD_TAIL;
+};
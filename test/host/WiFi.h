@@ -0,0 +1,14 @@
+#pragma once
+// IPAddress only (RuntimeConfig in AppConfig.h)
+#include <Arduino.h>
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : m_b{a, b, c, d} {}
+  uint8_t operator[](int i) const { return m_b[i]; }
+  operator uint32_t() const { return (uint32_t)m_b[0] | (uint32_t)m_b[1] << 8 | (uint32_t)m_b[2] << 16 | (uint32_t)m_b[3] << 24; }
+
+ private:
+  uint8_t m_b[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,206 @@
+// SNTP core (NtpCore.cpp) against canned server replies: the first sync steps, small later
+// corrections slew and feed the drift estimate, large ones step, and kiss-o'-death, zero
+// timestamps, unsynchronised servers and unmatched replies leave the clock and stats alone.
+#include "NtpCore.h"
+#include "sched_harness.h"
+#include <string.h>
+#include <vector>
+
+static const int64_t SEC = 1000000LL;
+static const int64_t MS = 1000LL;
+
+class FakeNtpClock : public NtpClock {
+ public:
+  int64_t  wall = 0;   // local wall clock (us)
+  uint32_t mono = 0;
+  std::vector<int64_t> steps, slews;
+
+  int64_t wallUs() override { return wall; }
+  uint32_t monoMs() override { return mono; }
+  void stepUs(int64_t offsetUs) override {
+    wall += offsetUs;
+    steps.push_back(offsetUs);
+  }
+  void slewUs(int64_t offsetUs) override { slews.push_back(offsetUs); }
+};
+
+struct Server {
+  uint8_t     li = 0;
+  uint8_t     mode = 4;
+  uint8_t     stratum = 2;
+  const char* refId = "GPS";
+  bool        zeroRx = false;
+  bool        zeroTx = false;
+  bool        wrongOrigin = false;
+};
+
+// One request / reply. The server clock is offsetUs ahead of the local one; the request
+// takes upUs to arrive, the server holds it procUs, the reply takes downUs back.
+static NtpReply exchange(NtpCore& core, FakeNtpClock& c, const Server& s, int64_t offsetUs, int64_t upUs,
+                         int64_t downUs, int64_t procUs = 300) {
+  uint8_t req[NTP_PACKET_SIZE];
+  core.buildRequest(req);
+  CHECK((req[0] & 7) == 3 && (req[0] >> 3 & 7) == 4, "request is v4 client mode");
+  CHECK(ntpGetTimestamp(&req[40]) / MS == c.wall / MS, "request transmit time is the local clock");
+
+  int64_t t1 = c.wall;
+  int64_t t2 = t1 + offsetUs + upUs;
+  int64_t t3 = t2 + procUs;
+
+  uint8_t rep[NTP_PACKET_SIZE] = {};
+  rep[0] = (uint8_t)(s.li << 6 | 4 << 3 | s.mode);
+  rep[1] = s.stratum;
+  strncpy((char*)&rep[12], s.refId, 4);
+  memcpy(&rep[24], &req[40], 8);
+  if (s.wrongOrigin) rep[31] ^= 1;
+  if (!s.zeroRx) ntpPutTimestamp(t2, &rep[32]);
+  if (!s.zeroTx) ntpPutTimestamp(t3, &rep[40]);
+
+  c.wall = t1 + upUs + procUs + downUs;
+  c.mono += (uint32_t)((upUs + procUs + downUs) / MS);
+  return core.handleReply(rep, sizeof(rep));
+}
+
+static bool near(int64_t a, int64_t b, int64_t tol) { return a - b <= tol && b - a <= tol; }
+
+static void testSyncSequence() {
+  FakeNtpClock c;
+  NtpStats st = {};
+  NtpCore core(c, st);
+  Server srv;
+  c.wall = 1767225600LL * SEC;   // 2026-01-01, RTC a few seconds behind
+  c.mono = 5000;
+
+  // First sync always steps, even when small; asymmetric path: offset error (up - down) / 2
+  CHECK(exchange(core, c, srv, 3200 * MS, 20 * MS, 30 * MS) == NTP_REPLY_OK, "first reply accepted");
+  CHECK(c.steps.size() == 1 && near(c.steps[0], 3195 * MS, 5) && c.slews.empty(), "first sync stepped %lld us",
+        c.steps.empty() ? 0LL : (long long)c.steps[0]);
+  CHECK(core.synced() && st.syncs == 1 && st.steps == 1 && st.lastOffsetMs == 3195 && st.lastRttMs == 50 &&
+        st.bestRttMs == 50 && st.stratum == 2 && st.firstSyncMs == 5050 && st.lastSyncMs == 5050,
+        "first sync stats: syncs %u steps %u off %d rtt %u best %u first %u", st.syncs, st.steps,
+        st.lastOffsetMs, st.lastRttMs, st.bestRttMs, st.firstSyncMs);
+  CHECK(st.driftPpm == 0.0f, "no drift estimate from the first sync");
+
+  // An hour later 120 ms behind: slewed, drift = 120 ms / 3600 s = 33.3 ppm
+  c.wall += 3600 * SEC;
+  c.mono += 3600 * 1000;
+  CHECK(exchange(core, c, srv, 120 * MS, 10 * MS, 10 * MS) == NTP_REPLY_OK, "slew reply accepted");
+  CHECK(c.steps.size() == 1 && c.slews.size() == 1 && near(c.slews[0], 120 * MS, 5), "120 ms slewed, not stepped");
+  CHECK(st.syncs == 2 && st.steps == 1 && st.lastOffsetMs == 120 && st.lastRttMs == 20 && st.bestRttMs == 20,
+        "slew stats: syncs %u steps %u off %d rtt %u best %u", st.syncs, st.steps, st.lastOffsetMs, st.lastRttMs,
+        st.bestRttMs);
+  CHECK(fabsf(st.driftPpm - 33.33f) < 0.1f, "drift %.2f ppm, want 33.33", (double)st.driftPpm);
+
+  // Beyond NTP_STEP_THRESHOLD_MS (someone set the clock by hand): step, smoothed drift
+  c.wall += 3600 * SEC;
+  c.mono += 3600 * 1000;
+  CHECK(exchange(core, c, srv, -900 * MS, 15 * MS, 15 * MS) == NTP_REPLY_OK, "step reply accepted");
+  CHECK(c.steps.size() == 2 && near(c.steps[1], -900 * MS, 5) && c.slews.size() == 1, "-900 ms stepped");
+  float want = 33.33f * 0.75f + (-250.0f) * 0.25f;
+  CHECK(st.steps == 2 && st.lastOffsetMs == -900 && st.lastRttMs == 30 && st.bestRttMs == 20 &&
+        fabsf(st.driftPpm - want) < 0.1f, "step stats: steps %u off %d rtt %u best %u drift %.2f (want %.2f)",
+        st.steps, st.lastOffsetMs, st.lastRttMs, st.bestRttMs, (double)st.driftPpm, (double)want);
+
+  // Exactly at the threshold still slews
+  c.wall += 60 * SEC;
+  c.mono += 60 * 1000;
+  CHECK(exchange(core, c, srv, -NTP_STEP_THRESHOLD_MS * MS, 5 * MS, 5 * MS) == NTP_REPLY_OK, "threshold reply");
+  CHECK(c.steps.size() == 2 && c.slews.size() == 2, "%d ms slewed", -NTP_STEP_THRESHOLD_MS);
+}
+
+// Replies that must not touch the clock or the sync stats.
+static void testRejected() {
+  struct Case {
+    const char* name;
+    Server      srv;
+    NtpReply    want;
+  };
+  Server kod;
+  kod.stratum = 0;
+  kod.refId = "RATE";
+  Server deny = kod;
+  deny.refId = "DENY";
+  Server zeroTx, zeroRx, alarm, s16, bcast, origin;
+  zeroTx.zeroTx = true;
+  zeroRx.zeroRx = true;
+  alarm.li = 3;
+  s16.stratum = 16;
+  bcast.mode = 5;
+  origin.wrongOrigin = true;
+  const Case cases[] = {
+    {"kiss-o'-death RATE", kod, NTP_REPLY_KOD},
+    {"kiss-o'-death DENY", deny, NTP_REPLY_KOD},
+    {"zero transmit time", zeroTx, NTP_REPLY_REJECTED},
+    {"zero receive time", zeroRx, NTP_REPLY_REJECTED},
+    {"leap indicator alarm", alarm, NTP_REPLY_REJECTED},
+    {"stratum 16", s16, NTP_REPLY_REJECTED},
+    {"broadcast mode", bcast, NTP_REPLY_REJECTED},
+    {"originate mismatch", origin, NTP_REPLY_REJECTED},
+  };
+
+  for (bool synced : {false, true}) {
+    for (const Case& k : cases) {
+      FakeNtpClock c;
+      NtpStats st = {};
+      NtpCore core(c, st);
+      c.wall = 2000000000LL * SEC;
+      c.mono = 1000;
+      if (synced) exchange(core, c, Server(), 50 * MS, 10 * MS, 10 * MS);
+      NtpStats before = st;
+      size_t steps = c.steps.size(), slews = c.slews.size();
+
+      NtpReply r = exchange(core, c, k.srv, 2 * SEC, 10 * MS, 10 * MS);
+      CHECK(r == k.want, "%s (synced=%d): result %d, want %d", k.name, (int)synced, (int)r, (int)k.want);
+      CHECK(c.steps.size() == steps && c.slews.size() == slews, "%s (synced=%d): clock adjusted", k.name, (int)synced);
+      CHECK(memcmp(&st, &before, sizeof(st)) == 0 && core.synced() == synced, "%s (synced=%d): stats changed",
+            k.name, (int)synced);
+      if (k.want == NTP_REPLY_KOD) CHECK(strcmp(core.lastKiss(), k.srv.refId) == 0, "kiss code %s", core.lastKiss());
+    }
+  }
+}
+
+// A reply only counts once, and a short datagram never does.
+static void testUnmatched() {
+  FakeNtpClock c;
+  NtpStats st = {};
+  NtpCore core(c, st);
+  c.wall = 1800000000LL * SEC;
+  uint8_t rep[NTP_PACKET_SIZE] = {};
+  CHECK(core.handleReply(rep, sizeof(rep)) == NTP_REPLY_REJECTED, "reply without a request");
+
+  uint8_t req[NTP_PACKET_SIZE];
+  core.buildRequest(req);
+  rep[0] = 0x24;
+  rep[1] = 1;
+  memcpy(&rep[24], &req[40], 8);
+  ntpPutTimestamp(c.wall, &rep[32]);
+  ntpPutTimestamp(c.wall, &rep[40]);
+  CHECK(core.handleReply(rep, 40) == NTP_REPLY_REJECTED, "short reply");
+  CHECK(core.handleReply(rep, sizeof(rep)) == NTP_REPLY_OK, "matching reply after a short one");
+  CHECK(core.handleReply(rep, sizeof(rep)) == NTP_REPLY_REJECTED && st.syncs == 1, "duplicate reply");
+}
+
+// Timestamps round-trip exactly on both sides of the 2036 era rollover.
+static void testTimestamps() {
+  const int64_t eraEnd = (0x100000000LL - NTP_UNIX_DELTA) * SEC;   // 2036-02-07 06:28:16 UTC
+  const int64_t samples[] = {0, 1767225600LL * SEC + 999999, eraEnd - 1, eraEnd, eraEnd + 1, 2208988800LL * SEC + 123456};
+  for (int64_t us : samples) {
+    uint8_t ts[8];
+    ntpPutTimestamp(us, ts);
+    int64_t back = ntpGetTimestamp(ts);
+    CHECK(back == us, "timestamp %lld us read back as %lld", (long long)us, (long long)back);
+  }
+}
+
+int main() {
+  testSyncSequence();
+  testRejected();
+  testUnmatched();
+  testTimestamps();
+  if (g_failures) {
+    printf("ntp_core: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("ntp_core: OK\n");
+  return 0;
+}
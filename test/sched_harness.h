@@ -0,0 +1,183 @@
+#pragma once
+// Host doubles for SchedulerCore: a virtual clock the test advances, an actuator that
+// records every command instead of writing BLE, and in-memory resume persistence.
+#include "SchedulerCore.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+static int g_failures = 0;
+
+// Report and keep going; main() returns non-zero if anything failed.
+#define CHECK(cond, ...)                                                        \
+  do {                                                                          \
+    if (!(cond)) {                                                              \
+      g_failures++;                                                             \
+      fprintf(stderr, "FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond);          \
+      fprintf(stderr, __VA_ARGS__);                                             \
+      fputc('\n', stderr);                                                      \
+    }                                                                           \
+  } while (0)
+
+static inline void setTz(const char* tz) {
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+// Days since 1970-01-01 of a civil date (proleptic Gregorian)
+static inline long civilDays(long y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = (unsigned)(y - era * 400);
+  unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (long)doe - 719468;
+}
+
+// UTC epoch of a local wall-clock time in the current TZ (first occurrence if repeated)
+static inline int64_t localEpoch(int y, int mon, int d, int h, int mi) {
+  struct tm tm = {};
+  tm.tm_year = y - 1900;
+  tm.tm_mon = mon - 1;
+  tm.tm_mday = d;
+  tm.tm_hour = h;
+  tm.tm_min = mi;
+  tm.tm_isdst = -1;
+  return (int64_t)mktime(&tm);
+}
+
+// Local wall clock from libc; the firmware gets the same values from localDateTime().
+class VirtualClock : public SchedClock {
+ public:
+  int64_t  epoch = 0;   // UTC seconds
+  uint32_t mono = 0;    // milliseconds
+  bool     valid = true;
+
+  void advance(uint32_t sec) {
+    epoch += sec;
+    mono += sec * 1000u;
+  }
+
+  bool timeValid() override { return valid; }
+  bool localNow(uint16_t& minOfDay, uint8_t& wday, uint16_t& dayNum) override {
+    time_t t = (time_t)epoch;
+    struct tm tm;
+    if (!localtime_r(&t, &tm)) return false;
+    minOfDay = (uint16_t)(tm.tm_hour * 60 + tm.tm_min);
+    wday = (uint8_t)tm.tm_wday;
+    dayNum = (uint16_t)civilDays(tm.tm_year + 1900, (unsigned)tm.tm_mon + 1, (unsigned)tm.tm_mday);
+    return true;
+  }
+  uint32_t epochNow() override { return (uint32_t)epoch; }
+  uint32_t monoMs() override { return mono; }
+};
+
+enum CmdOp { OP_CLOCK, OP_BUTTON, OP_MODE, OP_FAN, OP_TEMP, OP_RUNTIME };
+
+struct Cmd {
+  int64_t epoch;
+  CmdOp   op;
+  int     value;
+};
+
+// Records the command stream and models the BedJet's reported state from it.
+class RecordingActuator : public SchedActuator {
+ public:
+  explicit RecordingActuator(VirtualClock& clock) : m_clock(clock) {}
+
+  std::vector<Cmd> cmds;
+  bool connected = true;
+  bool reportStatus = false;   // getStatus() answers from the modelled state
+  bool verbose = false;
+  BedjetStatus status = {};
+
+  bool ensureConnected() override { return connected; }
+  bool isConnected() override { return connected; }
+  bool getStatus(BedjetStatus& out) override {
+    if (!reportStatus) return false;
+    out = status;
+    return true;
+  }
+  bool setClockNow() override { return rec(OP_CLOCK, 0); }
+  bool button(uint8_t btn) override {
+    status.modeButton = btn;
+    return rec(OP_BUTTON, btn);
+  }
+  bool setModeSmart(uint8_t btn) override {
+    status.modeButton = btn;
+    return rec(OP_MODE, btn);
+  }
+  bool setFan(uint8_t step) override {
+    status.fanStep = step;
+    return rec(OP_FAN, step);
+  }
+  bool setTempF(float tempF) override {
+    status.targetF = (int)lroundf(tempF);
+    return rec(OP_TEMP, status.targetF);
+  }
+  bool setRuntimeMinutes(uint16_t minutes) override {
+    status.remainingMin = minutes;
+    return rec(OP_RUNTIME, minutes);
+  }
+  void pauseMs(uint32_t) override {}
+  void log(const char* msg) override {
+    if (verbose) printf("    %s\n", msg);
+  }
+
+  size_t count(CmdOp op) const {
+    size_t n = 0;
+    for (const Cmd& c : cmds) n += (c.op == op);
+    return n;
+  }
+
+ private:
+  bool rec(CmdOp op, int value) {
+    cmds.push_back(Cmd{m_clock.epoch, op, value});
+    return connected;
+  }
+
+  VirtualClock& m_clock;
+};
+
+class MemPersist : public SchedPersist {
+ public:
+  bool        has = false;
+  SchedResume resume = {};
+  uint32_t    saves = 0;
+
+  bool loadResume(SchedResume& out) override {
+    if (!has) return false;
+    out = resume;
+    return true;
+  }
+  void saveResume(const SchedResume& r) override {
+    resume = r;
+    has = true;
+    saves++;
+  }
+};
+
+static inline ScheduleItem makeItem(uint16_t id, uint8_t btn, uint16_t startMin, uint16_t stopMin) {
+  ScheduleItem it = {};
+  it.id = id;
+  it.modeButton = btn;
+  it.fanStep = 10;
+  it.tempF = 88.0f;
+  it.startMin = startMin;
+  it.stopMin = stopMin;
+  it.enabled = true;
+  it.daysMask = DAYS_ALL;
+  it.rampToFan = RAMP_FAN_NONE;
+  return it;
+}
+
+static inline SchedParams defaultParams() {
+  SchedParams p = {};
+  p.rampStepMin = 5;
+  p.reconcileSec = 0;   // reconciler off unless a test turns it on
+  p.reconcileTolF = 1;
+  p.reconcileHyst = 2;
+  return p;
+}
@@ -0,0 +1,98 @@
+// Ramp command stream: a ramping block must emit exactly one temp/fan write per rampStepMin
+// step where the interpolated value changes, each within one tick after the step boundary
+// counted from the block start, and nothing once the ramp has finished.
+#include "sched_harness.h"
+#include <vector>
+
+struct Expected {
+  int stepIdx;
+  CmdOp op;
+  int value;
+};
+
+// Independent model of the ramp: linear from the block values to the targets over
+// rampMin, sampled at whole steps inside the block, rounded half away from zero.
+static std::vector<Expected> expectedStream(const ScheduleItem& it, int rampMin, int stepMin) {
+  int blockMin = schedDurationMinutes(it.startMin, it.stopMin);
+  std::vector<Expected> out;
+  int lastT = (int)lround(it.tempF), lastF = it.fanStep;
+  for (int k = 1; k * stepMin <= rampMin && k * stepMin < blockMin; k++) {
+    double frac = (double)(k * stepMin) / rampMin;
+    int t = it.rampToTempF ? (int)lround(it.tempF + (it.rampToTempF - it.tempF) * frac) : lastT;
+    int f = it.rampToFan != RAMP_FAN_NONE ? (int)lround(it.fanStep + (it.rampToFan - it.fanStep) * frac) : lastF;
+    if (t != lastT) out.push_back(Expected{k, OP_TEMP, t});
+    if (f != lastF) out.push_back(Expected{k, OP_FAN, f});
+    lastT = t;
+    lastF = f;
+  }
+  return out;
+}
+
+// Runs one block with ticks every tickSec (deliberately not a divisor of a minute) and
+// compares the post-apply command stream to the model.
+static void runRamp(const char* label, uint8_t stepMin, uint32_t tickSec, bool reportStatus, uint16_t rampMin) {
+  ScheduleItem it = makeItem(7, BTN_HEAT, 22 * 60, 23 * 60 + 30);
+  it.tempF = 80.0f;
+  it.rampToTempF = 90;
+  it.fanStep = 5;
+  it.rampToFan = 15;
+  it.rampMinutes = rampMin;
+
+  VirtualClock clock;
+  RecordingActuator act(clock);
+  act.reportStatus = reportStatus;
+  MemPersist persist;
+  SchedStats stats = {};
+  SchedulerCore core(clock, act, persist, stats);
+  SchedParams params = defaultParams();
+  params.rampStepMin = stepMin;
+  int active = -1;
+
+  int64_t blockStart = localEpoch(2026, 2, 3, 22, 0);
+  clock.epoch = blockStart - 5;
+  int64_t end = localEpoch(2026, 2, 3, 23, 29);
+  size_t applyCmds = 0;
+  for (; clock.epoch < end; clock.advance(tickSec)) {
+    core.tick(&it, 1, active, params);
+    if (active == 0 && applyCmds == 0) applyCmds = act.cmds.size();
+  }
+  CHECK(applyCmds > 0, "%s: block applied", label);
+
+  // Apply sends the initial setpoint
+  int applyTemp = -1, applyFan = -1;
+  for (size_t i = 0; i < applyCmds; i++) {
+    if (act.cmds[i].op == OP_TEMP) applyTemp = act.cmds[i].value;
+    if (act.cmds[i].op == OP_FAN) applyFan = act.cmds[i].value;
+  }
+  CHECK(applyTemp == 80 && applyFan == 5, "%s: apply sent %dF fan %d", label, applyTemp, applyFan);
+
+  std::vector<Expected> want = expectedStream(it, rampMin, stepMin);
+  std::vector<Cmd> got(act.cmds.begin() + (long)applyCmds, act.cmds.end());
+  CHECK(got.size() == want.size(), "%s: %zu ramp writes, want %zu", label, got.size(), want.size());
+
+  for (size_t i = 0; i < got.size() && i < want.size(); i++) {
+    const Cmd& g = got[i];
+    const Expected& w = want[i];
+    int64_t boundary = blockStart + (int64_t)w.stepIdx * stepMin * 60;
+    CHECK(g.op == w.op && g.value == w.value, "%s: write %zu is op %d = %d, want op %d = %d",
+          label, i, (int)g.op, g.value, (int)w.op, w.value);
+    // On the first tick at or after the step boundary, never before it and never drifting
+    CHECK(g.epoch >= boundary && g.epoch < boundary + (int64_t)tickSec,
+          "%s: write %zu at t+%llds, step %d boundary at t+%llds", label, i,
+          (long long)(g.epoch - blockStart), w.stepIdx, (long long)(boundary - blockStart));
+  }
+}
+
+int main() {
+  setTz("UTC0");
+  runRamp("5 min steps, 7 s ticks", 5, 7, false, 60);
+  runRamp("5 min steps, 13 s ticks, with status", 5, 13, true, 60);
+  runRamp("10 min steps, 2 s ticks", 10, 2, false, 90);
+  runRamp("1 min steps, 11 s ticks", 1, 11, true, 20);
+  if (g_failures) {
+    printf("sched_ramp: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("sched_ramp: OK\n");
+  return 0;
+}
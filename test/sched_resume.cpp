@@ -0,0 +1,132 @@
+// Resume after reboot for a block that wraps midnight (22:00-06:00): a reboot before or
+// after midnight inside the same occurrence adopts it without sending anything, a stale
+// record re-applies with the remaining runtime, and a reboot exactly at the stop minute
+// leaves the BedJet alone until the next start.
+#include "sched_harness.h"
+
+static const uint16_t START = 22 * 60;
+static const uint16_t STOP = 6 * 60;
+
+struct Boot {
+  VirtualClock clock;
+  RecordingActuator act{clock};
+  SchedStats stats = {};
+  SchedulerCore core;
+  int active = -1;
+
+  Boot(MemPersist& persist, int64_t epoch) : core(clock, act, persist, stats) {
+    clock.epoch = epoch;
+    clock.mono = 5000;   // a few seconds after power-up
+  }
+  void tick(const ScheduleItem& it) { core.tick(&it, 1, active, defaultParams()); }
+  int runtimeSent() const {
+    for (const Cmd& c : act.cmds) if (c.op == OP_RUNTIME) return c.value;
+    return -1;
+  }
+};
+
+static void testHelpers() {
+  CHECK(schedMinutesUntilStop(23 * 60 + 30, STOP) == 390, "%u", schedMinutesUntilStop(23 * 60 + 30, STOP));
+  CHECK(schedMinutesUntilStop(2 * 60, STOP) == 240, "%u", schedMinutesUntilStop(2 * 60, STOP));
+  CHECK(schedMinutesUntilStop(STOP - 1, STOP) == 1, "%u", schedMinutesUntilStop(STOP - 1, STOP));
+  CHECK(schedMinutesUntilStop(START, STOP) == 480, "%u", schedMinutesUntilStop(START, STOP));
+  // At the stop minute the block is over: nothing left, not a whole day
+  CHECK(schedMinutesUntilStop(STOP, STOP) == 0, "%u", schedMinutesUntilStop(STOP, STOP));
+  CHECK(!schedWithinBlock(STOP, START, STOP), "stop minute is outside the block");
+  CHECK(schedWithinBlock(STOP - 1, START, STOP), "last minute is inside the block");
+}
+
+// Applied on time at 22:00, then rebooted at `rebootMin` local (next day when < START).
+static void testResumeSameOccurrence(uint16_t rebootMin, const char* label) {
+  ScheduleItem it = makeItem(5, BTN_HEAT, START, STOP);
+  MemPersist persist;
+  int64_t applyAt = localEpoch(2026, 1, 10, 22, 0);
+  {
+    Boot b(persist, applyAt);
+    b.tick(it);
+    CHECK(b.active == 0, "%s: block applied at 22:00", label);
+    CHECK(b.runtimeSent() == 480, "%s: runtime at 22:00 = %d", label, b.runtimeSent());
+  }
+  int64_t rebootAt = rebootMin >= START ? localEpoch(2026, 1, 10, rebootMin / 60, rebootMin % 60)
+                                        : localEpoch(2026, 1, 11, rebootMin / 60, rebootMin % 60);
+  Boot b(persist, rebootAt);
+  b.tick(it);
+  CHECK(b.active == 0, "%s: resumed block is active", label);
+  CHECK(b.act.cmds.empty(), "%s: %zu command(s) sent on resume, want 0", label, b.act.cmds.size());
+  CHECK(b.stats.transitions == 1, "%s: transitions %u", label, b.stats.transitions);
+}
+
+// The stored apply belongs to the previous night: re-apply with the remaining runtime.
+static void testStaleRecord(uint16_t rebootMin, int wantRuntime, const char* label) {
+  ScheduleItem it = makeItem(5, BTN_HEAT, START, STOP);
+  MemPersist persist;
+  persist.has = true;
+  persist.resume.schedId = it.id;
+  persist.resume.itemHash = scheduleItemHash(it);
+  persist.resume.appliedEpoch = (uint32_t)localEpoch(2026, 1, 9, 22, 0);
+
+  int64_t rebootAt = rebootMin >= START ? localEpoch(2026, 1, 10, rebootMin / 60, rebootMin % 60)
+                                        : localEpoch(2026, 1, 11, rebootMin / 60, rebootMin % 60);
+  Boot b(persist, rebootAt);
+  b.tick(it);
+  CHECK(b.active == 0, "%s: block applied", label);
+  CHECK(b.act.count(OP_MODE) == 1, "%s: %zu mode command(s)", label, b.act.count(OP_MODE));
+  CHECK(b.runtimeSent() == wantRuntime, "%s: runtime %d, want %d", label, b.runtimeSent(), wantRuntime);
+  CHECK(persist.resume.appliedEpoch == (uint32_t)rebootAt, "%s: resume record refreshed", label);
+}
+
+// Reboot at 06:00 sharp after the block ran all night: nothing to resume or switch off,
+// and the next 22:00 start applies normally (the old record must not suppress it).
+static void testRebootAtStopMinute() {
+  ScheduleItem it = makeItem(5, BTN_HEAT, START, STOP);
+  MemPersist persist;
+  {
+    Boot b(persist, localEpoch(2026, 1, 10, 22, 0));
+    b.tick(it);
+  }
+  Boot b(persist, localEpoch(2026, 1, 11, 6, 0));
+  b.tick(it);
+  CHECK(b.active == -1, "stop minute: block not active");
+  CHECK(b.act.cmds.empty(), "stop minute: %zu command(s) sent", b.act.cmds.size());
+
+  for (int m = 0; m < 16 * 60; m++) {
+    b.clock.advance(60);
+    b.tick(it);
+  }
+  CHECK(b.active == 0, "next start: block active at 22:00");
+  CHECK(b.act.count(OP_MODE) == 1, "next start: %zu mode command(s)", b.act.count(OP_MODE));
+  CHECK(b.runtimeSent() == 480, "next start: runtime %d", b.runtimeSent());
+}
+
+// Resume record for a different item (or an edited one) must not be adopted.
+static void testEditedItem() {
+  ScheduleItem it = makeItem(5, BTN_HEAT, START, STOP);
+  MemPersist persist;
+  {
+    Boot b(persist, localEpoch(2026, 1, 10, 22, 0));
+    b.tick(it);
+  }
+  it.tempF = 91.0f;
+  Boot b(persist, localEpoch(2026, 1, 11, 1, 0));
+  b.tick(it);
+  CHECK(b.act.count(OP_MODE) == 1, "edited item: %zu mode command(s)", b.act.count(OP_MODE));
+  CHECK(b.runtimeSent() == 300, "edited item: runtime %d", b.runtimeSent());
+}
+
+int main() {
+  setTz("UTC0");
+  testHelpers();
+  testResumeSameOccurrence(23 * 60 + 30, "before midnight");
+  testResumeSameOccurrence(2 * 60, "after midnight");
+  testResumeSameOccurrence(STOP - 1, "last minute");
+  testStaleRecord(23 * 60 + 30, 390, "stale, before midnight");
+  testStaleRecord(2 * 60, 240, "stale, after midnight");
+  testRebootAtStopMinute();
+  testEditedItem();
+  if (g_failures) {
+    printf("sched_resume: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("sched_resume: OK\n");
+  return 0;
+}
@@ -0,0 +1,203 @@
+// Replays a whole year of scheduler ticks per POSIX TZ string against a virtual clock and
+// checks the recorded command stream day by day, including the DST spring-forward gap and
+// the repeated fall-back hour (m_doneId / m_doneDay guard). Prints the cost of a tick.
+// Also replays one reconciled block per mode-drift case (TURBO timing out to HEAT).
+#include "sched_harness.h"
+#include <chrono>
+#include <map>
+
+struct TzCase {
+  const char* name;
+  const char* tz;
+  uint16_t gapStart, gapStop;   // block inside the skipped spring-forward hour (0, 0 = none)
+  uint16_t repStart, repStop;   // block inside the repeated fall-back hour
+};
+
+static const TzCase kCases[] = {
+  {"UTC",         "UTC0",                                  0, 0,                      70, 110},
+  {"New York",    "EST5EDT,M3.2.0,M11.1.0",                130, 170,                  70, 110},
+  {"Berlin",      "CET-1CEST,M3.5.0,M10.5.0/3",            130, 170,                  130, 170},
+  {"Sydney",      "AEST-10AEDT,M10.1.0,M4.1.0/3",          130, 170,                  130, 170},
+  {"Lord Howe",   "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",  125, 145,                  95, 115},
+};
+
+static const int YEAR = 2026;
+static const uint32_t TICK_SEC = 30;
+
+struct DayLog {
+  int mode[8] = {};   // setModeSmart() per button
+  int off = 0;
+  int runtimeAt22 = -1;
+};
+
+static long localDay(int64_t epoch, int* minOfDay = nullptr) {
+  time_t t = (time_t)epoch;
+  struct tm tm;
+  localtime_r(&t, &tm);
+  if (minOfDay) *minOfDay = tm.tm_hour * 60 + tm.tm_min;
+  return civilDays(tm.tm_year + 1900, (unsigned)tm.tm_mon + 1, (unsigned)tm.tm_mday);
+}
+
+static long gmtOffAtNoon(int dayOfYear) {
+  time_t t = (time_t)localEpoch(YEAR, 1, 1 + dayOfYear, 12, 0);
+  struct tm tm;
+  localtime_r(&t, &tm);
+  return tm.tm_gmtoff;
+}
+
+static void runCase(const TzCase& c) {
+  setTz(c.tz);
+
+  // W wraps midnight; the overrides sit inside it so leaving them hands back to W.
+  ScheduleItem items[3];
+  int count = 0;
+  items[count++] = makeItem(1, BTN_HEAT, 22 * 60, 6 * 60);
+  ScheduleItem rep = makeItem(3, BTN_EXTHT, c.repStart, c.repStop);
+  rep.isOverride = true;
+  items[count++] = rep;
+  bool gapIsRep = (c.gapStart == c.repStart && c.gapStop == c.repStop);
+  if (c.gapStart && !gapIsRep) {
+    ScheduleItem gap = makeItem(2, BTN_COOL, c.gapStart, c.gapStop);
+    gap.isOverride = true;
+    items[count++] = gap;
+  }
+
+  VirtualClock clock;
+  RecordingActuator act(clock);
+  MemPersist persist;
+  SchedStats stats = {};
+  SchedulerCore core(clock, act, persist, stats);
+  SchedParams params = defaultParams();
+  int active = -1;
+
+  // Start the afternoon before so the first night's block is entered on time.
+  clock.epoch = localEpoch(YEAR - 1, 12, 31, 12, 0);
+  int64_t end = localEpoch(YEAR + 1, 1, 1, 12, 0);
+
+  uint64_t ticks = 0, totalNs = 0, maxNs = 0;
+  for (; clock.epoch < end; clock.advance(TICK_SEC)) {
+    auto t0 = std::chrono::steady_clock::now();
+    core.tick(items, count, active, params);
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    totalNs += ns;
+    if (ns > maxNs) maxNs = ns;
+    ticks++;
+  }
+
+  std::map<long, DayLog> days;
+  for (const Cmd& cmd : act.cmds) {
+    int minOfDay;
+    DayLog& d = days[localDay(cmd.epoch, &minOfDay)];
+    if (cmd.op == OP_MODE) d.mode[cmd.value & 7]++;
+    if (cmd.op == OP_BUTTON && cmd.value == BTN_OFF) d.off++;
+    if (cmd.op == OP_RUNTIME && minOfDay == 22 * 60) d.runtimeAt22 = cmd.value;
+  }
+
+  int springDays = 0, fallDays = 0;
+  long first = civilDays(YEAR, 1, 1);
+  long last = civilDays(YEAR, 12, 31);
+  for (long day = first; day <= last; day++) {
+    int doy = (int)(day - first);
+    long delta = gmtOffAtNoon(doy) - gmtOffAtNoon(doy - 1);
+    bool spring = delta > 0, fall = delta < 0;
+    springDays += spring;
+    fallDays += fall;
+
+    const DayLog& d = days[day];
+    int expRep = (spring && gapIsRep) ? 0 : 1;   // spring-forward skips the whole block
+    int expGap = (spring || !c.gapStart || gapIsRep) ? 0 : 1;
+    const char* kind = spring ? "spring-forward" : fall ? "fall-back" : "normal";
+
+    CHECK(d.mode[BTN_EXTHT] == expRep, "%s day %d (%s): repeat-hour block applied %d times, want %d",
+          c.name, doy + 1, kind, d.mode[BTN_EXTHT], expRep);
+    CHECK(d.mode[BTN_COOL] == expGap, "%s day %d (%s): gap block applied %d times, want %d",
+          c.name, doy + 1, kind, d.mode[BTN_COOL], expGap);
+    // W is applied at 22:00 and again each time an override inside it ends.
+    int expW = 1 + d.mode[BTN_EXTHT] + d.mode[BTN_COOL];
+    CHECK(d.mode[BTN_HEAT] == expW, "%s day %d (%s): night block applied %d times, want %d",
+          c.name, doy + 1, kind, d.mode[BTN_HEAT], expW);
+    CHECK(d.off == 1, "%s day %d (%s): %d OFF commands, want 1", c.name, doy + 1, kind, d.off);
+    CHECK(d.runtimeAt22 == 480, "%s day %d (%s): runtime at 22:00 = %d, want 480",
+          c.name, doy + 1, kind, d.runtimeAt22);
+  }
+
+  bool hasDst = (c.gapStart != 0);
+  CHECK(springDays == (hasDst ? 1 : 0), "%s: %d spring-forward days", c.name, springDays);
+  CHECK(fallDays == (hasDst ? 1 : 0), "%s: %d fall-back days", c.name, fallDays);
+
+  printf("%-10s %8llu ticks  %6zu commands  %5.0f ns/tick avg  %6.1f us max\n", c.name,
+         (unsigned long long)ticks, act.cmds.size(), (double)totalNs / (double)ticks, (double)maxNs / 1000.0);
+}
+
+// One reconciled block; 10 minutes in the BedJet starts reporting `reportedBtn` and a
+// setpoint `tempDriftF` off.
+struct ReconcileRun {
+  size_t   blockModes;   // setModeSmart(block mode) calls, including the initial apply
+  uint32_t reapplies;
+  uint32_t writes;
+  uint32_t checks;
+};
+
+static ReconcileRun runReconcile(uint8_t blockBtn, uint8_t reportedBtn, int tempDriftF) {
+  setTz("UTC0");
+  ScheduleItem it = makeItem(9, blockBtn, 22 * 60, 23 * 60);
+
+  VirtualClock clock;
+  RecordingActuator act(clock);
+  act.reportStatus = true;
+  MemPersist persist;
+  SchedStats stats = {};
+  SchedulerCore core(clock, act, persist, stats);
+  SchedParams params = defaultParams();
+  params.reconcileSec = 60;
+  params.reconcileHyst = 2;
+  int active = -1;
+
+  int64_t start = localEpoch(YEAR, 3, 2, 22, 0);
+  for (clock.epoch = start - TICK_SEC; clock.epoch < start + 50 * 60; clock.advance(TICK_SEC)) {
+    if (clock.epoch == start + 10 * 60) {
+      act.status.modeButton = reportedBtn;
+      act.status.targetF += tempDriftF;
+    }
+    core.tick(&it, 1, active, params);
+  }
+
+  ReconcileRun r = {};
+  for (const Cmd& c : act.cmds) r.blockModes += (c.op == OP_MODE && c.value == blockBtn);
+  r.reapplies = stats.reconcileReapplies;
+  r.writes = stats.reconcileWrites;
+  r.checks = stats.reconcileChecks;
+  return r;
+}
+
+static void runTurboReconcile() {
+  // Turbo timer ran out: HEAT is what a TURBO block turns into, nothing to re-apply
+  ReconcileRun r = runReconcile(BTN_TURBO, BTN_HEAT, 0);
+  CHECK(r.checks > 0 && r.blockModes == 1 && r.reapplies == 0 && r.writes == 0,
+        "TURBO -> HEAT: %zu turbo mode writes, %u re-applies, %u writes (%u checks); want 1, 0, 0",
+        r.blockModes, r.reapplies, r.writes, r.checks);
+
+  // ...but temp / fan drift in that HEAT phase is still corrected
+  r = runReconcile(BTN_TURBO, BTN_HEAT, 5);
+  CHECK(r.blockModes == 1 && r.reapplies == 0 && r.writes == 1,
+        "TURBO -> HEAT + 5F: %zu turbo mode writes, %u re-applies, %u writes; want 1, 0, 1",
+        r.blockModes, r.reapplies, r.writes);
+
+  // Any other mode change is still drift
+  r = runReconcile(BTN_TURBO, BTN_COOL, 0);
+  CHECK(r.reapplies >= 1 && r.blockModes >= 2, "TURBO -> COOL: %u re-applies, want >= 1", r.reapplies);
+  r = runReconcile(BTN_HEAT, BTN_TURBO, 0);
+  CHECK(r.reapplies >= 1 && r.blockModes >= 2, "HEAT -> TURBO: %u re-applies, want >= 1", r.reapplies);
+  printf("reconcile: TURBO timing out to HEAT left alone\n");
+}
+
+int main() {
+  for (const TzCase& c : kCases) runCase(c);
+  runTurboReconcile();
+  if (g_failures) {
+    printf("sched_sim: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("sched_sim: OK\n");
+  return 0;
+}
@@ -0,0 +1,286 @@
+// A/B records (AppStorage.cpp) on an in-memory NVS: a write torn at every byte offset must
+// leave the previous save readable, the next save must overwrite the torn slot,
+// loadSchedule() must fall back to the older slot when the newest one does not decode, and
+// a failed migration write must not delete the legacy schedule keys.
+#include "AppConfig.h"
+#include "AppStorage.h"
+#include "sched_harness.h"
+#include <vector>
+
+// Globals AppStorage.cpp links against (owned by AppState.cpp / AppConfig.cpp on the device)
+ScheduleItem g_sched[MAX_SCHEDULE];
+int g_schedCount = 0;
+uint16_t g_nextId = 1;
+AppMetrics g_metrics;
+RuntimeConfig g_cfg;
+bool saveConfigToNvs(const RuntimeConfig&, bool) { return true; }
+void saveConfigFlagsToNvs(const RuntimeConfig&) {}
+
+static const Preferences::Tear kTears[] = {
+  Preferences::TEAR_KEEP_OLD_TAIL, Preferences::TEAR_ERASED_TAIL, Preferences::TEAR_TRUNCATED
+};
+static const size_t AB_HDR = 8;   // seq + CRC in front of each slot
+
+static std::vector<uint8_t> payload(uint8_t tag, size_t len) {
+  std::vector<uint8_t> v(len);
+  for (size_t i = 0; i < len; i++) v[i] = (uint8_t)(tag * 31 + i * 7);
+  return v;
+}
+
+static std::vector<uint8_t> readNewest(AbState& st) {
+  Preferences p;
+  p.begin("t", true);
+  uint8_t buf[800];
+  size_t n = abReadNewest(p, "rec", buf, sizeof(buf), st);
+  p.end();
+  return std::vector<uint8_t>(buf, buf + n);
+}
+
+static bool write(AbState& st, const std::vector<uint8_t>& v) {
+  Preferences p;
+  p.begin("t", false);
+  bool ok = abWrite(p, "rec", v.data(), v.size(), st);
+  p.end();
+  return ok;
+}
+
+// Two good saves, then a third torn at `keep` bytes; "reboot" and read back.
+static void tornAt(size_t keep, Preferences::Tear mode, size_t oldLen, size_t newLen) {
+  Preferences::reset();
+  AbState st = {};
+  std::vector<uint8_t> p1 = payload(1, oldLen), p2 = payload(2, oldLen), p3 = payload(3, newLen);
+  write(st, p1);
+  write(st, p2);
+
+  Preferences::tearNextPut(keep, mode);
+  write(st, p3);
+  CHECK(!Preferences::tearPending(), "tear not consumed");
+
+  AbState boot = {};
+  std::vector<uint8_t> got = readNewest(boot);
+  bool complete = keep >= AB_HDR + newLen;
+  if (complete) {
+    CHECK(got == p3 && boot.seq == 3, "keep=%zu mode=%d: complete write not read back", keep, (int)mode);
+    return;
+  }
+  CHECK(got == p2 && boot.seq == 2, "keep=%zu mode=%d old=%zu new=%zu: read %zu bytes seq %u, want the previous save",
+        keep, (int)mode, oldLen, newLen, got.size(), boot.seq);
+
+  // The next save must land on the torn slot and keep the good one; tear that one too.
+  std::vector<uint8_t> p4 = payload(4, newLen);
+  CHECK(write(boot, p4), "save after recovery");
+  AbState again = {};
+  CHECK(readNewest(again) == p4, "keep=%zu mode=%d: save after recovery not read back", keep, (int)mode);
+
+  Preferences::tearNextPut(keep, mode);
+  write(boot, payload(5, newLen));
+  AbState last = {};
+  CHECK(readNewest(last) == p4, "keep=%zu mode=%d: second torn save lost the recovered one", keep, (int)mode);
+}
+
+static void testTornWrites() {
+  int cases = 0;
+  for (size_t oldLen : {40, 120}) {
+    for (size_t newLen : {40, 80, 120}) {
+      for (Preferences::Tear mode : kTears) {
+        for (size_t keep = 0; keep <= AB_HDR + newLen; keep++) {
+          tornAt(keep, mode, oldLen, newLen);
+          cases++;
+        }
+      }
+    }
+  }
+  printf("torn writes: %d cases\n", cases);
+}
+
+// Nothing saved yet and the first save torn: nothing to read (caller keeps defaults).
+static void testTornFirstWrite() {
+  for (Preferences::Tear mode : kTears) {
+    for (size_t keep = 0; keep < AB_HDR + 60; keep++) {
+      Preferences::reset();
+      AbState st = {};
+      Preferences::tearNextPut(keep, mode);
+      write(st, payload(1, 60));
+      AbState boot = {};
+      CHECK(readNewest(boot).empty() && boot.slot == 0, "keep=%zu mode=%d: torn first write read as valid", keep, (int)mode);
+    }
+  }
+}
+
+// Sequence numbers keep ordering the slots across the 32-bit wrap.
+static void testSeqWrap() {
+  Preferences::reset();
+  AbState st = {0xFFFFFFFEu, 'B'};
+  write(st, payload(1, 30));   // A = 0xFFFFFFFF
+  write(st, payload(2, 30));   // B = 0
+  AbState boot = {};
+  CHECK(readNewest(boot) == payload(2, 30) && boot.seq == 0 && boot.slot == 'B', "seq wrap: slot %c seq %u", boot.slot, boot.seq);
+}
+
+// --------------------------- loadSchedule() ---------------------------
+static void setSchedule(uint16_t firstId, int count) {
+  g_schedCount = count;
+  for (int i = 0; i < count; i++) g_sched[i] = makeItem((uint16_t)(firstId + i), BTN_HEAT, 60 * i, 60 * i + 30);
+  g_nextId = (uint16_t)(firstId + count);
+}
+
+static bool scheduleIs(uint16_t firstId, int count) {
+  if (g_schedCount != count) return false;
+  for (int i = 0; i < count; i++) if (g_sched[i].id != firstId + i) return false;
+  return true;
+}
+
+static void readSlot(char slot, ScheduleItem* items, int& count) {
+  Preferences p;
+  p.begin("bedjet", true);
+  uint8_t buf[AB_HDR + SCHED_BLOB_MAX];
+  char key[8] = {'s', 'c', 'h', 'e', 'd', slot, 0};
+  size_t n = p.getBytes(key, buf, sizeof(buf));
+  p.end();
+  uint16_t nextId;
+  count = -1;
+  if (n > AB_HDR) decodeScheduleBlob(buf + AB_HDR, n - AB_HDR, items, count, nextId);
+}
+
+// Newest slot passes the CRC but carries a record version this firmware cannot decode:
+// load the older slot, not the legacy keys, and overwrite the bad slot on the next save.
+static void testScheduleFallsBackToOlderSlot() {
+  Preferences::reset();
+  setSchedule(10, 3);
+  saveSchedule();
+
+  uint8_t blob[SCHED_BLOB_MAX];
+  size_t len = encodeScheduleBlob(g_sched, g_schedCount, g_nextId, blob);
+  blob[4] = 99;   // future record version; abWrite adds a valid slot CRC
+  {
+    Preferences p;
+    p.begin("bedjet", false);
+    AbState st = {};
+    uint8_t tmp[SCHED_BLOB_MAX];
+    abReadNewest(p, "sched", tmp, sizeof(tmp), st);
+    CHECK(abWrite(p, "sched", blob, len, st), "write future-version slot");
+    // Legacy per-item layout with different contents must not win over the older slot
+    p.putUInt("count", 1);
+    p.end();
+  }
+
+  setSchedule(50, 1);
+  loadSchedule();
+  CHECK(scheduleIs(10, 3), "loaded %d item(s) starting at id %u, want the older slot (3 from id 10)",
+        g_schedCount, g_schedCount ? g_sched[0].id : 0);
+
+  setSchedule(20, 2);
+  saveSchedule();
+  ScheduleItem items[MAX_SCHEDULE];
+  int a, b;
+  readSlot('A', items, a);
+  readSlot('B', items, b);
+  CHECK(a == 3 && b == 2, "after save: slot A %d item(s), slot B %d item(s); want A kept, B overwritten", a, b);
+
+  loadSchedule();
+  CHECK(scheduleIs(20, 2), "reload after save: %d item(s)", g_schedCount);
+}
+
+// saveSchedule() torn at every byte: boot loads either the previous or the new schedule.
+static void testScheduleTornSave() {
+  int cases = 0;
+  setSchedule(1, 4);
+  uint8_t blob[SCHED_BLOB_MAX];
+  size_t newLen = AB_HDR + encodeScheduleBlob(g_sched, 5, g_nextId, blob);
+  for (Preferences::Tear mode : kTears) {
+    for (size_t keep = 0; keep <= newLen; keep++) {
+      Preferences::reset();
+      setSchedule(1, 4);
+      saveSchedule();
+      setSchedule(100, 4);
+      saveSchedule();
+      loadSchedule();   // fresh boot state for the slot bookkeeping
+
+      setSchedule(200, 5);
+      Preferences::tearNextPut(keep, mode);
+      saveSchedule();
+
+      setSchedule(0, 0);
+      loadSchedule();
+      bool complete = keep >= newLen;
+      CHECK(complete ? scheduleIs(200, 5) : scheduleIs(100, 4), "keep=%zu mode=%d: loaded %d item(s) from id %u",
+            keep, (int)mode, g_schedCount, g_schedCount ? g_sched[0].id : 0);
+      cases++;
+    }
+  }
+  printf("torn schedule saves: %d cases\n", cases);
+}
+
+// --------------------------- Legacy migration ---------------------------
+static bool nvsHas(const char* key) {
+  Preferences p;
+  p.begin("bedjet", true);
+  bool has = p.isKey(key);
+  p.end();
+  return has;
+}
+
+// Pre-A/B layouts: one unslotted "sched" blob, or "count" / "nextId" / "s00".. per item.
+static void writeLegacySchedule(bool perItem) {
+  setSchedule(30, 3);
+  uint8_t blob[SCHED_BLOB_MAX];
+  size_t len = encodeScheduleBlob(g_sched, g_schedCount, g_nextId, blob);
+  Preferences p;
+  p.begin("bedjet", false);
+  if (perItem) {
+    size_t rec = blob[5];
+    p.putUInt("count", (uint32_t)g_schedCount);
+    p.putUInt("nextId", g_nextId);
+    for (int i = 0; i < g_schedCount; i++) {
+      char key[16];
+      snprintf(key, sizeof(key), "s%02d", i);
+      p.putBytes(key, blob + 16 + i * rec, rec);
+    }
+  } else {
+    p.putBytes("sched", blob, len);
+  }
+  p.end();
+}
+
+// The first boot's A/B write fails (NVS full): the legacy keys are the only copy and must stay;
+// the next boot migrates again and only then removes them.
+static void testMigrationWriteFails() {
+  for (bool perItem : {false, true}) {
+    const char* legacyKey = perItem ? "s00" : "sched";
+    Preferences::reset();
+    writeLegacySchedule(perItem);
+
+    setSchedule(0, 0);
+    Preferences::failNextPut();
+    loadSchedule();
+    CHECK(!Preferences::failPending(), "%s: migration did not write", legacyKey);
+    CHECK(scheduleIs(30, 3), "%s: failed migration still loads the legacy schedule (%d item(s))", legacyKey, g_schedCount);
+    CHECK(nvsHas(legacyKey) && (!perItem || nvsHas("count")), "%s: legacy keys deleted after a failed write", legacyKey);
+    CHECK(!nvsHas("schedA") && !nvsHas("schedB"), "%s: failed write left an A/B slot", legacyKey);
+
+    setSchedule(0, 0);
+    loadSchedule();
+    CHECK(scheduleIs(30, 3), "%s: retry on next boot loads %d item(s)", legacyKey, g_schedCount);
+    CHECK(!nvsHas(legacyKey) && !nvsHas("count") && nvsHas("schedA"), "%s: legacy keys not replaced after a good write", legacyKey);
+
+    setSchedule(0, 0);
+    loadSchedule();
+    CHECK(scheduleIs(30, 3), "%s: A/B record after migration loads %d item(s)", legacyKey, g_schedCount);
+  }
+}
+
+int main() {
+  Serial.quiet = true;
+  testTornWrites();
+  testTornFirstWrite();
+  testSeqWrap();
+  testScheduleFallsBackToOlderSlot();
+  testScheduleTornSave();
+  testMigrationWriteFails();
+  if (g_failures) {
+    printf("storage_ab: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("storage_ab: OK\n");
+  return 0;
+}
@@ -0,0 +1,59 @@
+// parseDateYmd(): day-of-month limits including leap years, round trip through fmtDateYmd().
+#include "AppTime.h"
+#include "sched_harness.h"
+
+static void expectDate(const char* s, bool ok, long dayNum = -1) {
+  uint16_t out = 0xBEEF;
+  bool got = parseDateYmd(String(s), out);
+  CHECK(got == ok, "\"%s\": parse %d, want %d", s, (int)got, (int)ok);
+  if (!ok) {
+    CHECK(out == 0xBEEF, "\"%s\": output written on failure", s);
+    return;
+  }
+  if (dayNum >= 0) CHECK(out == dayNum, "\"%s\": day %u, want %ld", s, out, dayNum);
+  String back = fmtDateYmd(out);
+  CHECK(back == s, "\"%s\": formats back as \"%s\"", s, back.c_str());
+}
+
+int main() {
+  Serial.quiet = true;
+
+  expectDate("1970-01-02", true, 1);
+  expectDate("2026-01-31", true, civilDays(2026, 1, 31));
+  expectDate("2026-04-30", true);
+  expectDate("2026-04-31", false);
+  expectDate("2026-06-31", false);
+  expectDate("2026-09-31", false);
+  expectDate("2026-11-31", false);
+  expectDate("2026-12-31", true);
+  expectDate("2026-02-28", true);
+  expectDate("2026-02-29", false);   // not a leap year
+  expectDate("2026-02-30", false);
+  expectDate("2028-02-29", true, civilDays(2028, 2, 29));
+  expectDate("2000-02-29", true);    // divisible by 400
+  expectDate("2100-02-29", false);   // divisible by 100 only
+  expectDate("2026-00-10", false);
+  expectDate("2026-13-01", false);
+  expectDate("2026-05-00", false);
+  expectDate("1969-12-31", false);
+  expectDate("2149-06-06", true, 65535);
+  expectDate("2149-06-07", false);   // past the uint16 day range
+  expectDate("2026/05/01", false);
+  expectDate("", false);
+
+  // Every day of a leap and a common year round-trips
+  for (int y : {2027, 2028}) {
+    for (long d = civilDays(y, 1, 1); d < civilDays(y + 1, 1, 1); d++) {
+      String s = fmtDateYmd((uint16_t)d);
+      uint16_t out = 0;
+      CHECK(parseDateYmd(s, out) && out == d, "day %ld (\"%s\") round trip", d, s.c_str());
+    }
+  }
+
+  if (g_failures) {
+    printf("time_date: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("time_date: OK\n");
+  return 0;
+}
@@ -0,0 +1,157 @@
+// Cached POSIX TZ clock (AppTime.cpp) against libc localtime_r: every hour of 2020-2040,
+// each DST transition found by libc (one second before / at / after, and half an hour
+// either side), and a spread of instants up to 2148, walked forwards and then shuffled so
+// the cached window is recomputed from both directions.
+#include "AppTime.h"
+#include "sched_harness.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const char* kZones[] = {
+  "UTC0",
+  "EST5EDT,M3.2.0,M11.1.0",
+  "CST6CDT,M3.2.0/2:00:00,M11.1.0/2:00:00",
+  "MST7",
+  "PST8PDT,M3.2.0,M11.1.0",
+  "AKST9AKDT,M3.2.0,M11.1.0",
+  "HST10",
+  "GMT0BST,M3.5.0/1,M10.5.0",
+  "CET-1CEST,M3.5.0,M10.5.0/3",
+  "EET-2EEST,M3.5.0/3,M10.5.0/4",
+  "IST-1GMT0,M10.5.0,M3.5.0/1",                       // Ireland: "DST" in winter
+  "<+0330>-3:30",
+  "IST-5:30",
+  "<+0545>-5:45",
+  "AEST-10AEDT,M10.1.0,M4.1.0/3",
+  "ACST-9:30ACDT,M10.1.0,M4.1.0/3",
+  "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",             // Lord Howe: 30 min DST
+  "NZST-12NZDT,M9.5.0,M4.1.0/3",
+  "<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45",
+  "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",                 // negative transition times
+  "<-04>4<-03>,M9.1.6/24,M4.1.6/24",                  // transition at 24:00
+  "<+13>-13",
+  "<-12>12",
+  "XXX3YYY,J60/2,J300/2",                             // Julian days without Feb 29
+  "XXX3YYY,59,299",                                   // zero-based days
+  "EST5EDT",                                          // no rules: libc fallback path
+};
+
+static int64_t epochUtc(int y, int m, int d) { return (int64_t)civilDays(y, (unsigned)m, (unsigned)d) * 86400; }
+
+static long libcOffset(int64_t t) {
+  time_t tt = (time_t)t;
+  struct tm tm;
+  localtime_r(&tt, &tm);
+  return tm.tm_gmtoff;
+}
+
+static bool compareAt(const char* tz, int64_t t, int& reported) {
+  time_t tt = (time_t)t;
+  struct tm tm;
+  localtime_r(&tt, &tm);
+  LocalClock c;
+  localClockAt(tt, c);
+
+  long dayNum = civilDays(tm.tm_year + 1900, (unsigned)tm.tm_mon + 1, (unsigned)tm.tm_mday);
+  bool ok = c.epoch == t && c.offsetSec == tm.tm_gmtoff && c.isDst == (tm.tm_isdst > 0) &&
+            c.year == tm.tm_year + 1900 && c.month == tm.tm_mon + 1 && c.day == tm.tm_mday &&
+            c.minOfDay == tm.tm_hour * 60 + tm.tm_min && c.sec == tm.tm_sec &&
+            c.wday == tm.tm_wday && c.dayNum == dayNum;
+  if (!ok && reported++ < 5) {
+    CHECK(ok, "%s t=%lld: cached %04u-%02u-%02u %02u:%02u:%02u off=%d dst=%d wday=%u | libc %04d-%02d-%02d %02d:%02d:%02d off=%ld dst=%d wday=%d",
+          tz, (long long)t, c.year, c.month, c.day, c.minOfDay / 60, c.minOfDay % 60, c.sec, (int)c.offsetSec,
+          (int)c.isDst, c.wday, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+          tm.tm_sec, (long)tm.tm_gmtoff, tm.tm_isdst, tm.tm_wday);
+  } else if (!ok) {
+    g_failures++;
+  }
+  return ok;
+}
+
+static void runZone(const char* tz) {
+  setTz(tz);
+  timeSetTz(String(tz));
+
+  std::vector<int64_t> instants;
+  int transitions = 0;
+  int64_t from = epochUtc(2020, 1, 1), to = epochUtc(2041, 1, 1);
+  for (int64_t t = from; t < to; t += 3600) {
+    instants.push_back(t);
+    if (libcOffset(t) == libcOffset(t + 3600)) continue;
+    // Offset changes in (t, t + 3600]: find the first second of the new offset
+    int64_t lo = t, hi = t + 3600;
+    while (hi - lo > 1) {
+      int64_t mid = lo + (hi - lo) / 2;
+      (libcOffset(mid) == libcOffset(t) ? lo : hi) = mid;
+    }
+    for (int64_t d : {-1800, -1, 0, 1, 1800}) instants.push_back(hi + d);
+    transitions++;
+  }
+  // Sparse coverage of the rest of the uint16 day range (ends 2149-06-06), including year ends
+  for (int y = 1971; y < 2149; y++) {
+    int64_t jan1 = epochUtc(y, 1, 1);
+    for (int64_t d : {-50400, -1, 0, 1, 50400, 86400 * 59 + 43200, 86400 * 200 + 7200}) instants.push_back(jan1 + d);
+  }
+
+  int reported = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int64_t t : instants) compareAt(tz, t, reported);
+  double seqNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count() / (double)instants.size();
+
+  std::mt19937_64 rng(12345);
+  std::shuffle(instants.begin(), instants.end(), rng);
+  for (int64_t t : instants) compareAt(tz, t, reported);
+
+  printf("%-48s %7zu instants  %3d transitions  %6.0f ns/compare\n", tz, instants.size(), transitions, seqNs);
+}
+
+static void testOffsetNow() {
+  setTz("CET-1CEST,M3.5.0,M10.5.0/3");
+  timeSetTz(String("CET-1CEST,M3.5.0,M10.5.0/3"));
+  int isDst = -1;
+  int32_t off = tzOffsetSecondsNowPortable(&isDst);
+  time_t now = time(nullptr);
+  struct tm tm;
+  localtime_r(&now, &tm);
+  CHECK(off == tm.tm_gmtoff && isDst == (tm.tm_isdst > 0), "offset now %d/%d vs libc %ld/%d",
+        (int)off, isDst, (long)tm.tm_gmtoff, tm.tm_isdst);
+}
+
+// loop() and the control task share the cached window: two threads alternating between
+// summer and winter instants keep replacing it, and each must still see its own offset.
+static void testConcurrentReaders() {
+  const char* tz = "CET-1CEST,M3.5.0,M10.5.0/3";
+  setTz(tz);
+  timeSetTz(String(tz));
+  const int64_t summer = epochUtc(2026, 7, 1), winter = epochUtc(2026, 1, 15);
+  std::atomic<int> bad{0};
+  auto reader = [&](int64_t a, int64_t b) {
+    for (int i = 0; i < 200000; i++) {
+      LocalClock c;
+      int64_t t = (i & 1) ? a : b;
+      localClockAt((time_t)t, c);
+      int32_t want = (t == summer) ? 7200 : 3600;
+      if (c.offsetSec != want || c.isDst != (t == summer)) bad++;
+    }
+  };
+  std::thread t1(reader, summer, winter), t2(reader, winter, summer);
+  t1.join();
+  t2.join();
+  CHECK(bad == 0, "%d reads saw another thread's window", bad.load());
+}
+
+int main() {
+  Serial.quiet = true;
+  for (const char* tz : kZones) runZone(tz);
+  testOffsetNow();
+  testConcurrentReaders();
+  if (g_failures) {
+    printf("time_tz: %d failure(s)\n", g_failures);
+    return 1;
+  }
+  printf("time_tz: OK\n");
+  return 0;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Web latency under load on a real device (not part of ctest).
+
+Several clients poll /api/state back to back while another thread keeps dropping the
+BedJet link (/api/ble/disconnect) and asking for it again (/api/ble/connect), so the
+control task is busy reconnecting for most of the run. Prints p50 / p99 / max per
+endpoint, the time until each queued command settles, and the device's own counters
+(web_loop_us_max, ctl_*) from /api/metrics.
+
+    python3 test/web_latency.py 192.168.1.50 --seconds 120 --clients 4 --cycle 10
+"""
+import argparse
+import json
+import threading
+import time
+import urllib.error
+import urllib.request
+
+
+class Recorder:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.samples = {}
+        self.errors = {}
+
+    def add(self, name, ms):
+        with self.lock:
+            self.samples.setdefault(name, []).append(ms)
+
+    def error(self, name):
+        with self.lock:
+            self.errors[name] = self.errors.get(name, 0) + 1
+
+
+def request(base, path, method="GET", timeout=30.0):
+    req = urllib.request.Request(base + path, method=method, data=b"" if method == "POST" else None)
+    t0 = time.monotonic()
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as r:
+            code, body = r.status, r.read()
+    except urllib.error.HTTPError as e:
+        code, body = e.code, e.read()
+    ms = (time.monotonic() - t0) * 1000.0
+    try:
+        return code, json.loads(body or b"{}"), ms
+    except ValueError:
+        return code, {}, ms
+
+
+def poller(base, rec, stop):
+    while not stop.is_set():
+        try:
+            code, _, ms = request(base, "/api/state")
+            if code == 200:
+                rec.add("GET /api/state", ms)
+            else:
+                rec.error("GET /api/state")
+        except OSError:
+            rec.error("GET /api/state")
+
+
+# POST a BLE command; on 202 poll /api/cmd/result like the UI does. Returns the final state.
+def ble_command(base, rec, path):
+    name = "POST " + path
+    t0 = time.monotonic()
+    try:
+        code, j, ms = request(base, path, "POST")
+    except OSError:
+        rec.error(name)
+        return "error"
+    rec.add(name, ms)
+    state = "ok" if j.get("ok") else ("busy" if j.get("busy") else "failed")
+    if code == 202 and j.get("req"):
+        state = "pending"
+        while state == "pending" and time.monotonic() - t0 < 60:
+            time.sleep(0.4)
+            try:
+                _, r, ms = request(base, "/api/cmd/result?req=%d" % j["req"])
+            except OSError:
+                rec.error("GET /api/cmd/result")
+                continue
+            rec.add("GET /api/cmd/result", ms)
+            state = r.get("state", "unknown")
+    rec.add(path + " settled", (time.monotonic() - t0) * 1000.0)
+    if state != "ok":
+        rec.error(path + " " + state)
+    return state
+
+
+def link_flapper(base, rec, stop, cycle):
+    while not stop.is_set():
+        ble_command(base, rec, "/api/ble/disconnect")
+        ble_command(base, rec, "/api/ble/connect")
+        stop.wait(cycle)
+
+
+def pct(values, p):
+    s = sorted(values)
+    return s[min(len(s) - 1, int(round(p / 100.0 * (len(s) - 1))))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("host", help="device address, e.g. 192.168.1.50 or bedjet.local")
+    ap.add_argument("--seconds", type=float, default=60)
+    ap.add_argument("--clients", type=int, default=4, help="concurrent /api/state pollers")
+    ap.add_argument("--cycle", type=float, default=10, help="seconds between disconnect/connect rounds")
+    a = ap.parse_args()
+    base = a.host if a.host.startswith("http") else "http://" + a.host
+
+    rec = Recorder()
+    stop = threading.Event()
+    threads = [threading.Thread(target=poller, args=(base, rec, stop)) for _ in range(a.clients)]
+    threads.append(threading.Thread(target=link_flapper, args=(base, rec, stop, a.cycle)))
+    for t in threads:
+        t.start()
+    time.sleep(a.seconds)
+    stop.set()
+    for t in threads:
+        t.join()
+
+    print("%-28s %7s %9s %9s %9s" % ("", "n", "p50 ms", "p99 ms", "max ms"))
+    for name, v in sorted(rec.samples.items()):
+        print("%-28s %7d %9.1f %9.1f %9.1f" % (name, len(v), pct(v, 50), pct(v, 99), max(v)))
+    for name, n in sorted(rec.errors.items()):
+        print("errors: %-20s %d" % (name, n))
+
+    try:
+        _, m, _ = request(base, "/api/metrics")
+        keys = ["web_loop_us_max", "ctl_commands", "ctl_cmd_ms_max", "ctl_pending", "ctl_busy", "ctl_stack_free"]
+        print("device: " + "  ".join("%s=%s" % (k, m.get(k)) for k in keys))
+    except OSError:
+        print("device: /api/metrics unreachable")
+
+
+if __name__ == "__main__":
+    main()